@@ -0,0 +1,509 @@
+/*
+ * HTTP load generator
+ *
+ * Drives one request shape at the server over c concurrent connections
+ * and prints the result as one JSON object on stdout:
+ *
+ *   make bench                                   # builds it and runs bench/run_bench.sh
+ *   ./bin/load_gen -p 8080 -c 32 -d 10 -u /index.html
+ *   ./bin/load_gen -p 8080 -c 32 -d 10 -u /index.html -P 8          # pipelined
+ *   ./bin/load_gen -p 8443 -t -c 32 -d 10 -u /api/status            # TLS
+ *   ./bin/load_gen -p 8080 -c 16 -d 10 -r 5000 -u /index.html       # open loop
+ *
+ * Closed loop (default): every connection sends its next request (or batch
+ * of -P pipelined requests) as soon as the previous response arrives, so
+ * throughput is what the server sustains. Open loop (-r): requests are
+ * sent on a fixed schedule regardless of how the server keeps up, and
+ * latency is measured from the scheduled send time, so queueing delay is
+ * not hidden by a stalled client ("coordinated omission").
+ *
+ * Latencies go into the server's own HDR histogram (src/core/hdr_histogram.c).
+ */
+#define _GNU_SOURCE     // memmem()
+#include "hdr_histogram.h"
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RESPONSE_BUFFER (64 * 1024)
+#define MAX_HEADERS     8
+
+typedef struct {
+    int      fd;
+    SSL*     ssl;
+    char     buf[RESPONSE_BUFFER];
+    size_t   len;               // Bytes received but not yet consumed
+} Conn;
+
+typedef struct {
+    pthread_t    thread;
+    int          id;
+    uint64_t     limit;         // Requests to send (0 = until the deadline)
+    uint64_t     requests;
+    uint64_t     errors;
+    uint64_t     connects;
+    uint64_t     bytes;
+    uint64_t     status[600];
+    SSL_SESSION* session;       // Reused across reconnects
+    HdrHistogram latency;
+} Worker;
+
+static const char* g_host = "127.0.0.1";
+static const char* g_port = "8080";
+static const char* g_method = "GET";
+static const char* g_path = "/";
+static const char* g_body = NULL;
+static const char* g_content_type = "application/x-www-form-urlencoded";
+static const char* g_headers[MAX_HEADERS];
+static int         g_header_count = 0;
+static const char* g_scenario = "custom";
+static int         g_connections = 16;
+static int         g_tls = 0;
+static int         g_keepalive = 1;
+static int         g_pipeline = 1;
+static int         g_revalidate = 0;
+static double      g_rate = 0;          // Requests/s over all connections (0 = closed loop)
+static uint64_t    g_deadline_us = 0;
+
+static SSL_CTX*         g_ctx = NULL;
+static struct addrinfo* g_addr = NULL;
+static char*            g_request = NULL;   // One request, pre-rendered
+static size_t           g_request_len = 0;
+static char*            g_batch = NULL;     // g_pipeline copies of it
+static size_t           g_batch_len = 0;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static void sleep_until(uint64_t when_us) {
+    uint64_t now = now_us();
+    if (when_us <= now) return;
+
+    struct timespec ts = {
+        .tv_sec  = (time_t)((when_us - now) / 1000000),
+        .tv_nsec = (long)((when_us - now) % 1000000) * 1000
+    };
+    while (nanosleep(&ts, &ts) < 0 && errno == EINTR) { }
+}
+
+static void conn_close(Conn* c) {
+    if (c->ssl) {
+        SSL_shutdown(c->ssl);
+        SSL_free(c->ssl);
+        c->ssl = NULL;
+    }
+    if (c->fd >= 0) close(c->fd);
+    c->fd = -1;
+    c->len = 0;
+}
+
+static int conn_open(Conn* c, SSL_SESSION** session) {
+    c->fd = socket(g_addr->ai_family, SOCK_STREAM, 0);
+    c->len = 0;
+    if (c->fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(c->fd, g_addr->ai_addr, g_addr->ai_addrlen) < 0) {
+        conn_close(c);
+        return -1;
+    }
+
+    if (g_tls) {
+        c->ssl = SSL_new(g_ctx);
+        SSL_set_fd(c->ssl, c->fd);
+        SSL_set_tlsext_host_name(c->ssl, g_host);
+        if (session && *session) SSL_set_session(c->ssl, *session);
+        if (SSL_connect(c->ssl) != 1) {
+            ERR_clear_error();
+            conn_close(c);
+            return -1;
+        }
+        if (session && !*session) *session = SSL_get1_session(c->ssl);
+    }
+    return 0;
+}
+
+static int conn_send(Conn* c, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t n = c->ssl ? SSL_write(c->ssl, data, (int)len) : send(c->fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            if (!c->ssl && n < 0 && errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/* Appends whatever arrives to c->buf. Returns bytes read, 0 on close, -1 on error. */
+static ssize_t conn_recv(Conn* c) {
+    for (;;) {
+        ssize_t n = c->ssl ? SSL_read(c->ssl, c->buf + c->len, (int)(sizeof(c->buf) - c->len))
+                           : recv(c->fd, c->buf + c->len, sizeof(c->buf) - c->len, 0);
+        if (n < 0 && !c->ssl && errno == EINTR) continue;
+        if (n > 0) c->len += (size_t)n;
+        return n < 0 ? -1 : n;
+    }
+}
+
+/* Finds a header value (case-insensitive name) within the header block. */
+static const char* find_header(const char* headers, size_t len, const char* name) {
+    size_t name_len = strlen(name);
+    for (const char* p = headers; p && p < headers + len; ) {
+        const char* line = memchr(p, '\n', (size_t)(headers + len - p));
+        if (!line) return NULL;
+        line++;
+        if ((size_t)(headers + len - line) > name_len &&
+            strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char* value = line + name_len + 1;
+            while (*value == ' ') value++;
+            return value;
+        }
+        p = line;
+    }
+    return NULL;
+}
+
+/**
+ * Reads one complete response, discarding its body
+ *
+ * @param status Set to the status code
+ * @param bytes Incremented by the response size
+ * @param closing Set if the server will close the connection afterwards
+ * @param etag If not NULL, receives the ETag header value (up to 127 chars)
+ *
+ * @return 0 on success, -1 on a malformed response or connection error
+ */
+static int read_response(Conn* c, int* status, uint64_t* bytes, int* closing, char* etag) {
+    char* end;
+    while (!(end = memmem(c->buf, c->len, "\r\n\r\n", 4))) {
+        if (c->len == sizeof(c->buf) || conn_recv(c) <= 0) return -1;
+    }
+    size_t header_len = (size_t)(end - c->buf) + 4;
+
+    if (c->len < 12 || strncmp(c->buf, "HTTP/1.", 7) != 0) return -1;
+    *status = atoi(c->buf + 9);
+
+    const char* value = find_header(c->buf, header_len, "Content-Length");
+    uint64_t body = value ? strtoull(value, NULL, 10) : 0;
+    value = find_header(c->buf, header_len, "Connection");
+    *closing = value && strncasecmp(value, "close", 5) == 0;
+
+    if (etag && (value = find_header(c->buf, header_len, "ETag"))) {
+        size_t n = strcspn(value, "\r\n");
+        if (n > 127) n = 127;
+        memcpy(etag, value, n);
+        etag[n] = '\0';
+    }
+
+    // No body on these, whatever Content-Length says
+    if (*status == 304 || *status == 204 || *status < 200 || strcmp(g_method, "HEAD") == 0) {
+        body = 0;
+    }
+    *bytes += header_len + body;
+
+    // Drop the header, then the body as it arrives
+    memmove(c->buf, c->buf + header_len, c->len - header_len);
+    c->len -= header_len;
+    while (body > 0) {
+        if (c->len == 0 && conn_recv(c) <= 0) return -1;
+        size_t take = c->len < body ? c->len : (size_t)body;
+        memmove(c->buf, c->buf + take, c->len - take);
+        c->len -= take;
+        body -= take;
+    }
+    return 0;
+}
+
+static void count_response(Worker* w, int status, uint64_t latency_us) {
+    w->requests++;
+    if (status >= 0 && status < 600) w->status[status]++;
+    hdr_record(&w->latency, latency_us);
+}
+
+static void* closed_loop(void* arg) {
+    Worker* w = arg;
+    Conn* c = calloc(1, sizeof(Conn));
+    if (!c) return NULL;
+    c->fd = -1;
+
+    while (now_us() < g_deadline_us && (!w->limit || w->requests < w->limit)) {
+        if (c->fd < 0) {
+            if (conn_open(c, &w->session) < 0) {
+                w->errors++;
+                sleep_until(now_us() + 10000);
+                continue;
+            }
+            w->connects++;
+        }
+
+        int batch = g_pipeline;
+        if (w->limit && w->limit - w->requests < (uint64_t)batch) batch = (int)(w->limit - w->requests);
+
+        uint64_t start = now_us();
+        if (conn_send(c, g_batch, g_request_len * (size_t)batch) < 0) {
+            w->errors++;
+            conn_close(c);
+            continue;
+        }
+
+        int closing = 0;
+        for (int i = 0; i < batch; i++) {
+            int status;
+            if (read_response(c, &status, &w->bytes, &closing, NULL) < 0) {
+                w->errors += (uint64_t)(batch - i);
+                closing = 1;
+                break;
+            }
+            count_response(w, status, now_us() - start);
+            if (closing) break;
+        }
+        if (closing || !g_keepalive) conn_close(c);
+    }
+
+    conn_close(c);
+    free(c);
+    return NULL;
+}
+
+static void* open_loop(void* arg) {
+    Worker* w = arg;
+    Conn* c = calloc(1, sizeof(Conn));
+    if (!c) return NULL;
+    c->fd = -1;
+
+    // Each connection carries an equal share of the rate, staggered
+    uint64_t interval = (uint64_t)(1e6 * g_connections / g_rate);
+    uint64_t next = now_us() + interval * (uint64_t)w->id / (uint64_t)g_connections;
+
+    while (next < g_deadline_us && (!w->limit || w->requests < w->limit)) {
+        sleep_until(next);
+
+        if (c->fd < 0) {
+            if (conn_open(c, &w->session) < 0) {
+                w->errors++;
+                next += interval;
+                continue;
+            }
+            w->connects++;
+        }
+
+        int status, closing = 0;
+        if (conn_send(c, g_request, g_request_len) < 0 ||
+            read_response(c, &status, &w->bytes, &closing, NULL) < 0) {
+            w->errors++;
+            conn_close(c);
+        } else {
+            // From the scheduled time: a late send counts as server delay
+            count_response(w, status, now_us() - next);
+            if (closing || !g_keepalive) conn_close(c);
+        }
+        next += interval;
+    }
+
+    conn_close(c);
+    free(c);
+    return NULL;
+}
+
+static char* render_request(const char* etag) {
+    size_t size = 1024 + strlen(g_path) + (g_body ? strlen(g_body) : 0);
+    for (int i = 0; i < g_header_count; i++) size += strlen(g_headers[i]) + 2;
+
+    char* req = malloc(size);
+    if (!req) return NULL;
+
+    int len = snprintf(req, size, "%s %s HTTP/1.1\r\nHost: %s\r\nUser-Agent: snap-load-gen\r\n",
+                       g_method, g_path, g_host);
+    if (!g_keepalive) len += snprintf(req + len, size - (size_t)len, "Connection: close\r\n");
+    if (etag) len += snprintf(req + len, size - (size_t)len, "If-None-Match: %s\r\n", etag);
+    for (int i = 0; i < g_header_count; i++) {
+        len += snprintf(req + len, size - (size_t)len, "%s\r\n", g_headers[i]);
+    }
+    if (g_body) {
+        len += snprintf(req + len, size - (size_t)len, "Content-Type: %s\r\nContent-Length: %zu\r\n\r\n%s",
+                        g_content_type, strlen(g_body), g_body);
+    } else {
+        len += snprintf(req + len, size - (size_t)len, "\r\n");
+    }
+    return req;
+}
+
+/* One plain request to learn the resource's ETag for -E. */
+static int prime_etag(char* etag) {
+    Conn* c = calloc(1, sizeof(Conn));
+    if (!c) return -1;
+    c->fd = -1;
+    etag[0] = '\0';
+
+    int status, closing;
+    uint64_t bytes = 0;
+    int ok = conn_open(c, NULL) == 0 &&
+             conn_send(c, g_request, g_request_len) == 0 &&
+             read_response(c, &status, &bytes, &closing, etag) == 0 &&
+             etag[0] != '\0';
+    conn_close(c);
+    free(c);
+    return ok ? 0 : -1;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "Usage: %s [-h host] [-p port] [-t] [-c connections] [-d seconds] [-n requests]\n"
+        "          [-P depth] [-r rate] [-K] [-m method] [-u path] [-H header]...\n"
+        "          [-b body] [-T content-type] [-E] [-s scenario]\n"
+        "  -t  TLS                      -P  pipeline depth (closed loop)\n"
+        "  -r  open loop at this many requests/s in total\n"
+        "  -K  no keep-alive (one request per connection)\n"
+        "  -E  send If-None-Match with the ETag of a first plain GET\n"
+        "  -s  scenario name copied into the JSON output\n", prog);
+}
+
+int main(int argc, char** argv) {
+    double duration = 10;
+    uint64_t total = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "h:p:tc:d:n:P:r:Km:u:H:b:T:Es:")) != -1) {
+        switch (opt) {
+            case 'h': g_host = optarg; break;
+            case 'p': g_port = optarg; break;
+            case 't': g_tls = 1; break;
+            case 'c': g_connections = atoi(optarg); break;
+            case 'd': duration = atof(optarg); break;
+            case 'n': total = strtoull(optarg, NULL, 10); break;
+            case 'P': g_pipeline = atoi(optarg); break;
+            case 'r': g_rate = atof(optarg); break;
+            case 'K': g_keepalive = 0; break;
+            case 'm': g_method = optarg; break;
+            case 'u': g_path = optarg; break;
+            case 'H':
+                if (g_header_count == MAX_HEADERS) { usage(argv[0]); return 1; }
+                g_headers[g_header_count++] = optarg;
+                break;
+            case 'b': g_body = optarg; break;
+            case 'T': g_content_type = optarg; break;
+            case 'E': g_revalidate = 1; break;
+            case 's': g_scenario = optarg; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (g_connections <= 0 || g_pipeline <= 0 || duration <= 0 || g_rate < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    if (g_rate > 0) g_pipeline = 1;     // Open loop paces single requests
+
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    if (getaddrinfo(g_host, g_port, &hints, &g_addr) != 0) {
+        fprintf(stderr, "Cannot resolve %s:%s\n", g_host, g_port);
+        return 1;
+    }
+    if (g_tls) {
+        g_ctx = SSL_CTX_new(TLS_client_method());
+        SSL_CTX_set_verify(g_ctx, SSL_VERIFY_NONE, NULL);
+        SSL_CTX_set_session_cache_mode(g_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL);
+    }
+
+    g_request = render_request(NULL);
+    if (!g_request) return 1;
+    g_request_len = strlen(g_request);
+
+    if (g_revalidate) {
+        char etag[128];
+        if (prime_etag(etag) < 0) {
+            fprintf(stderr, "No ETag for %s; cannot revalidate\n", g_path);
+            return 1;
+        }
+        free(g_request);
+        g_request = render_request(etag);
+        g_request_len = strlen(g_request);
+    }
+
+    g_batch_len = g_request_len * (size_t)g_pipeline;
+    g_batch = malloc(g_batch_len);
+    if (!g_batch) return 1;
+    for (int i = 0; i < g_pipeline; i++) memcpy(g_batch + (size_t)i * g_request_len, g_request, g_request_len);
+
+    Worker* workers = calloc((size_t)g_connections, sizeof(Worker));
+    if (!workers) return 1;
+
+    uint64_t start = now_us();
+    g_deadline_us = start + (uint64_t)(duration * 1e6);
+    for (int i = 0; i < g_connections; i++) {
+        workers[i].id = i;
+        if (total) workers[i].limit = total / (uint64_t)g_connections + ((uint64_t)i < total % (uint64_t)g_connections);
+        if (total && !workers[i].limit) continue;
+        pthread_create(&workers[i].thread, NULL, g_rate > 0 ? open_loop : closed_loop, &workers[i]);
+    }
+
+    HdrHistogram* latency = calloc(1, sizeof(HdrHistogram));
+    uint64_t requests = 0, errors = 0, connects = 0, bytes = 0;
+    uint64_t status[600] = {0};
+    for (int i = 0; i < g_connections; i++) {
+        if (total && !workers[i].limit) continue;
+        pthread_join(workers[i].thread, NULL);
+        requests += workers[i].requests;
+        errors   += workers[i].errors;
+        connects += workers[i].connects;
+        bytes    += workers[i].bytes;
+        for (int s = 0; s < 600; s++) status[s] += workers[i].status[s];
+        if (latency) hdr_merge(latency, &workers[i].latency);
+        if (workers[i].session) SSL_SESSION_free(workers[i].session);
+    }
+    double elapsed = (double)(now_us() - start) / 1e6;
+
+    printf("{\"scenario\": \"%s\", \"method\": \"%s\", \"path\": \"%s\", \"tls\": %s, "
+           "\"keepalive\": %s, \"connections\": %d, \"pipeline\": %d, \"mode\": \"%s\", "
+           "\"rate\": %.0f, \"elapsed_s\": %.3f, \"requests\": %llu, \"errors\": %llu, "
+           "\"connects\": %llu, \"bytes\": %llu, \"throughput_rps\": %.1f, \"status\": {",
+           g_scenario, g_method, g_path, g_tls ? "true" : "false", g_keepalive ? "true" : "false",
+           g_connections, g_pipeline, g_rate > 0 ? "open" : "closed", g_rate, elapsed,
+           (unsigned long long)requests, (unsigned long long)errors,
+           (unsigned long long)connects, (unsigned long long)bytes, (double)requests / elapsed);
+    int first = 1;
+    for (int s = 0; s < 600; s++) {
+        if (!status[s]) continue;
+        printf("%s\"%d\": %llu", first ? "" : ", ", s, (unsigned long long)status[s]);
+        first = 0;
+    }
+    if (latency) {
+        printf("}, \"latency_us\": {\"mean\": %.1f, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, "
+               "\"p999\": %llu, \"max\": %llu}}\n",
+               hdr_mean(latency),
+               (unsigned long long)hdr_percentile(latency, 50.0),
+               (unsigned long long)hdr_percentile(latency, 90.0),
+               (unsigned long long)hdr_percentile(latency, 99.0),
+               (unsigned long long)hdr_percentile(latency, 99.9),
+               (unsigned long long)latency->max);
+    } else {
+        printf("}}\n");
+    }
+
+    free(latency);
+    free(workers);
+    free(g_batch);
+    free(g_request);
+    if (g_ctx) SSL_CTX_free(g_ctx);
+    freeaddrinfo(g_addr);
+    return requests == 0 ? 2 : 0;
+}
@@ -0,0 +1,179 @@
+/*
+ * Microbenchmarks for the components every request goes through
+ *
+ * Linked against the server's objects (everything but main.o), so the
+ * measured code is exactly what the server runs. Inputs mirror a typical
+ * request: paths under public/, the shipped mime.types, a browser-sized
+ * request header block.
+ */
+#include "microbench.h"
+
+#include "cache.h"
+#include "hash_table.h"
+#include "logger.h"
+#include "mime.h"
+#include "node.h"
+#include "request.h"
+#include "response.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <sqlite3.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Globals that main.c defines for the rest of the server
+ht* mime_table;
+sqlite3* g_database = NULL;
+pthread_mutex_t g_db_mutex = PTHREAD_MUTEX_INITIALIZER;
+time_t g_server_start = 0;
+
+#define PUBLIC_DIR SERVER_PATH "/public"
+
+// Paths requested in the benchmarks: hits of assorted depths plus a miss
+static const char* const request_paths[] = {
+    PUBLIC_DIR "/index.html",
+    PUBLIC_DIR "/cat.jpeg",
+    PUBLIC_DIR "/tictactoe/bulma.css",
+    PUBLIC_DIR "/tictactoe/tictactoe.js",
+    PUBLIC_DIR "/videos/reset.mp4",
+    PUBLIC_DIR "/favicon.ico",
+    PUBLIC_DIR "/error_pages/404.html",
+    PUBLIC_DIR "/does/not/exist.html",
+};
+#define PATH_COUNT (sizeof(request_paths) / sizeof(request_paths[0]))
+
+static const char* const filenames[] = {
+    "index.html", "bulma.css", "tictactoe.js", "cat.jpeg", "reset.mp4",
+    "favicon.ico", "archive.tar.gz", "README", "data.unknownext",
+};
+#define FILENAME_COUNT (sizeof(filenames) / sizeof(filenames[0]))
+
+static const char* const extensions[] = {
+    "html", "css", "js", "jpeg", "mp4", "ico", "gz", "json", "unknownext",
+};
+#define EXTENSION_COUNT (sizeof(extensions) / sizeof(extensions[0]))
+
+static const char raw_request[] =
+    "GET /tictactoe/index.html HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:128.0) Gecko/20100101 Firefox/128.0\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: en-US,en;q=0.5\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Referer: http://localhost:8080/index.html\r\n"
+    "Connection: keep-alive\r\n"
+    "If-Modified-Since: Wed, 21 Oct 2026 07:28:00 GMT\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "Priority: u=0, i\r\n"
+    "\r\n";
+
+static const char encoded_path[] =
+    "/videos/My%20Summer%20Vacation%20%282026%29/day%2001%20-%20beach%20%26%20sunset.mp4";
+
+static struct Node* tree;
+static unsigned int path_hashes[PATH_COUNT];
+
+static void quiet_logs(void) {
+    log_set_level(LOG_WARN);
+}
+
+static void tree_setup(void) {
+    quiet_logs();
+    if (tree) return;
+    size_t used = 0;
+    tree = init_tree(SERVER_PATH, 0, &used);     // Indexes SERVER_PATH/public
+    if (!tree) {
+        fprintf(stderr, "microbench: cannot index %s\n", PUBLIC_DIR);
+        exit(1);
+    }
+    for (size_t i = 0; i < PATH_COUNT; i++) {
+        path_hashes[i] = (unsigned int)hashPath(request_paths[i]);
+    }
+}
+
+static void mime_setup(void) {
+    quiet_logs();
+    if (mime_table) return;
+    mime_table = mime_init(SERVER_PATH "/etc/mime.types");
+    if (!mime_table) {
+        fprintf(stderr, "microbench: cannot load %s/etc/mime.types\n", SERVER_PATH);
+        exit(1);
+    }
+}
+
+static void bench_hash_path(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        MICRO_KEEP(hashPath(request_paths[i % PATH_COUNT]));
+    }
+}
+
+static void bench_lookup_node(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        MICRO_KEEP(lookupNode(tree, path_hashes[i % PATH_COUNT]));
+    }
+}
+
+static void bench_cache_lookup(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        MICRO_KEEP(cache_lookup(tree, request_paths[i % PATH_COUNT]));
+    }
+}
+
+static void bench_ht_get(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        MICRO_KEEP(ht_get(mime_table, extensions[i % EXTENSION_COUNT]));
+    }
+}
+
+static void bench_mime_from_filename(uint64_t n) {
+    for (uint64_t i = 0; i < n; i++) {
+        MICRO_KEEP(mime_get_type_from_filename(mime_table, filenames[i % FILENAME_COUNT]));
+    }
+}
+
+// The parser tokenizes in place, so each iteration parses a fresh copy
+static void bench_parse_request(uint64_t n) {
+    char buf[sizeof(raw_request)];
+    Client client;
+    memset(&client, 0, sizeof(client));
+
+    for (uint64_t i = 0; i < n; i++) {
+        memcpy(buf, raw_request, sizeof(raw_request));
+        if (parse_http_request_into(&client, buf, -1, NULL) == 0) {
+            MICRO_KEEP(client.connection_status);
+            client_reset(&client);
+        }
+    }
+}
+
+static void bench_url_decode(uint64_t n) {
+    char dst[sizeof(encoded_path)];
+    for (uint64_t i = 0; i < n; i++) {
+        url_decode(dst, encoded_path, sizeof(dst));
+        MICRO_KEEP(dst[0]);
+    }
+}
+
+static void bench_format_http_date(uint64_t n) {
+    time_t base = 1790000000;
+    for (uint64_t i = 0; i < n; i++) {
+        char* date = format_http_date(base + (time_t)i);
+        MICRO_KEEP(date ? date[0] : 0);
+        free(date);
+    }
+}
+
+const MicroBench micro_benches[] = {
+    { "hash_path",         "hashPath() over request paths",             quiet_logs, bench_hash_path,         NULL },
+    { "lookup_node",       "lookupNode() on the public/ index",         tree_setup, bench_lookup_node,       NULL },
+    { "cache_lookup",      "hashPath() + lookupNode(), hits and a miss", tree_setup, bench_cache_lookup,      NULL },
+    { "ht_get",            "ht_get() on the mime table",                mime_setup, bench_ht_get,            NULL },
+    { "mime_from_filename","mime_get_type_from_filename()",             mime_setup, bench_mime_from_filename,NULL },
+    { "parse_request",     "parse_http_request_into() + client_reset()", quiet_logs, bench_parse_request,     NULL },
+    { "url_decode",        "url_decode() of a percent-encoded path",    NULL,       bench_url_decode,        NULL },
+    { "format_http_date",  "format_http_date() incl. free()",           NULL,       bench_format_http_date,  NULL },
+    { NULL, NULL, NULL, NULL, NULL }
+};
@@ -0,0 +1,289 @@
+/*
+ * Microbenchmark runner
+ *
+ *   make bench-tools
+ *   ./bin/microbench                     # every benchmark, table on stdout
+ *   ./bin/microbench -j > micro.json     # JSON, for comparing commits
+ *   ./bin/microbench -r 500 parse        # only names containing "parse"
+ *
+ * Each repetition times one batch of operations; the batch size is chosen
+ * so a batch takes about -b microseconds. Percentiles are over the
+ * per-operation time of the repetitions. Cycles, instructions, LLC misses
+ * and branch misses come from perf_event_open() and are reported per
+ * operation (median over repetitions); they are omitted when the kernel
+ * refuses access (see /proc/sys/kernel/perf_event_paranoid).
+ *
+ * Pin the process for stable numbers: taskset -c 2 ./bin/microbench
+ */
+#include "microbench.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+volatile uintptr_t micro_sink = 0;
+
+enum { CTR_CYCLES, CTR_INSTRUCTIONS, CTR_CACHE_MISSES, CTR_BRANCH_MISSES, CTR_COUNT };
+
+static const char* const counter_names[CTR_COUNT] = {
+    "cycles", "instructions", "llc_misses", "branch_misses"
+};
+
+typedef struct {
+    int fds[CTR_COUNT];
+    int count;                  // Counters actually opened (group members)
+    int index[CTR_COUNT];       // Position of each counter in the group read, -1 if missing
+} Counters;
+
+typedef struct {
+    uint64_t batch;
+    double   ns[5];                     // min, p50, p90, p99, max per operation
+    double   mean_ns;
+    double   per_op[CTR_COUNT];         // Median counter value per operation, <0 if unavailable
+} Result;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int perf_open(uint32_t type, uint64_t config, int group) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = group < 0;          // The leader starts the group
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+static void counters_open(Counters* c) {
+    static const struct { uint32_t type; uint64_t config; } events[CTR_COUNT] = {
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+        { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+    };
+
+    c->count = 0;
+    int leader = -1;
+    for (int i = 0; i < CTR_COUNT; i++) {
+        c->fds[i] = perf_open(events[i].type, events[i].config, leader);
+        c->index[i] = -1;
+        if (c->fds[i] < 0) continue;
+        if (leader < 0) leader = c->fds[i];
+        c->index[i] = c->count++;
+    }
+}
+
+static void counters_close(Counters* c) {
+    for (int i = 0; i < CTR_COUNT; i++) {
+        if (c->fds[i] >= 0) close(c->fds[i]);
+    }
+}
+
+static int counters_leader(const Counters* c) {
+    for (int i = 0; i < CTR_COUNT; i++) {
+        if (c->fds[i] >= 0) return c->fds[i];
+    }
+    return -1;
+}
+
+/* Reads the group: values[i] for each opened counter. Returns 0 on success. */
+static int counters_read(const Counters* c, uint64_t values[CTR_COUNT]) {
+    uint64_t buf[1 + CTR_COUNT];
+    int leader = counters_leader(c);
+    if (leader < 0 || read(leader, buf, sizeof(buf)) < (ssize_t)sizeof(uint64_t)) return -1;
+
+    for (int i = 0; i < CTR_COUNT; i++) {
+        values[i] = c->index[i] >= 0 ? buf[1 + c->index[i]] : 0;
+    }
+    return 0;
+}
+
+static int compare_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return x < y ? -1 : x > y;
+}
+
+static double percentile(const double* sorted, int n, double p) {
+    int i = (int)(p / 100.0 * (n - 1) + 0.5);
+    return sorted[i < n ? i : n - 1];
+}
+
+/* Doubles the batch until it runs for at least target_ns. */
+static uint64_t calibrate(const MicroBench* b, uint64_t target_ns) {
+    uint64_t batch = 1;
+    for (;;) {
+        uint64_t start = now_ns();
+        b->run(batch);
+        uint64_t elapsed = now_ns() - start;
+        if (elapsed >= target_ns || batch >= (1ULL << 32)) {
+            return batch;
+        }
+        batch = elapsed < target_ns / 16 ? batch * 8 : batch * 2;
+    }
+}
+
+static void run_bench(const MicroBench* b, int reps, uint64_t warmup_ns, uint64_t batch_ns,
+                      Counters* ctr, Result* out) {
+    if (b->setup) b->setup();
+
+    out->batch = calibrate(b, batch_ns);
+
+    uint64_t until = now_ns() + warmup_ns;
+    while (now_ns() < until) b->run(out->batch);
+
+    double* ns = malloc((size_t)reps * sizeof(double));
+    double* per_op[CTR_COUNT];
+    for (int i = 0; i < CTR_COUNT; i++) per_op[i] = malloc((size_t)reps * sizeof(double));
+
+    int leader = counters_leader(ctr);
+    int have_counters = leader >= 0;
+    double total = 0;
+
+    for (int r = 0; r < reps; r++) {
+        uint64_t before[CTR_COUNT], after[CTR_COUNT];
+        if (have_counters) {
+            ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+            ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+            counters_read(ctr, before);
+        }
+
+        uint64_t start = now_ns();
+        b->run(out->batch);
+        uint64_t elapsed = now_ns() - start;
+
+        if (have_counters) {
+            counters_read(ctr, after);
+            ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+            for (int i = 0; i < CTR_COUNT; i++) {
+                per_op[i][r] = (double)(after[i] - before[i]) / (double)out->batch;
+            }
+        }
+
+        ns[r] = (double)elapsed / (double)out->batch;
+        total += ns[r];
+    }
+
+    qsort(ns, (size_t)reps, sizeof(double), compare_double);
+    out->ns[0] = ns[0];
+    out->ns[1] = percentile(ns, reps, 50);
+    out->ns[2] = percentile(ns, reps, 90);
+    out->ns[3] = percentile(ns, reps, 99);
+    out->ns[4] = ns[reps - 1];
+    out->mean_ns = total / reps;
+
+    for (int i = 0; i < CTR_COUNT; i++) {
+        if (have_counters && ctr->index[i] >= 0) {
+            qsort(per_op[i], (size_t)reps, sizeof(double), compare_double);
+            out->per_op[i] = percentile(per_op[i], reps, 50);
+        } else {
+            out->per_op[i] = -1;
+        }
+        free(per_op[i]);
+    }
+    free(ns);
+
+    if (b->teardown) b->teardown();
+}
+
+static int selected(const char* name, int argc, char** argv, int first) {
+    if (first >= argc) return 1;
+    for (int i = first; i < argc; i++) {
+        if (strstr(name, argv[i])) return 1;
+    }
+    return 0;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "Usage: %s [-r repetitions] [-w warmup_ms] [-b batch_us] [-j] [-l] [filter...]\n"
+        "  -j  JSON output        -l  list benchmarks\n", prog);
+}
+
+int main(int argc, char** argv) {
+    int reps = 200, json = 0, list = 0;
+    uint64_t warmup_ns = 200ULL * 1000000, batch_ns = 1000ULL * 1000;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "r:w:b:jl")) != -1) {
+        switch (opt) {
+            case 'r': reps = atoi(optarg); break;
+            case 'w': warmup_ns = strtoull(optarg, NULL, 10) * 1000000; break;
+            case 'b': batch_ns = strtoull(optarg, NULL, 10) * 1000; break;
+            case 'j': json = 1; break;
+            case 'l': list = 1; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (reps < 1 || batch_ns == 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (list) {
+        for (const MicroBench* b = micro_benches; b->name; b++) {
+            printf("%-24s %s\n", b->name, b->description);
+        }
+        return 0;
+    }
+
+    Counters ctr;
+    counters_open(&ctr);
+    if (ctr.count == 0) {
+        fprintf(stderr, "perf_event_open unavailable (%s); timing only\n", strerror(errno));
+    }
+
+    if (json) {
+        printf("{\"repetitions\": %d, \"benchmarks\": [", reps);
+    } else {
+        printf("%-24s %10s %9s %9s %9s %9s %9s", "benchmark", "batch", "min ns", "p50 ns",
+               "p90 ns", "p99 ns", "max ns");
+        if (ctr.count) printf(" %9s %9s %9s %9s", "cycles", "instr", "llc-miss", "br-miss");
+        printf("\n");
+    }
+
+    int first = 1;
+    for (const MicroBench* b = micro_benches; b->name; b++) {
+        if (!selected(b->name, argc, argv, optind)) continue;
+
+        Result r;
+        run_bench(b, reps, warmup_ns, batch_ns, &ctr, &r);
+
+        if (json) {
+            printf("%s\n  {\"name\": \"%s\", \"batch\": %llu, \"mean_ns\": %.2f, \"min_ns\": %.2f, "
+                   "\"p50_ns\": %.2f, \"p90_ns\": %.2f, \"p99_ns\": %.2f, \"max_ns\": %.2f",
+                   first ? "" : ",", b->name, (unsigned long long)r.batch, r.mean_ns,
+                   r.ns[0], r.ns[1], r.ns[2], r.ns[3], r.ns[4]);
+            for (int i = 0; i < CTR_COUNT; i++) {
+                if (r.per_op[i] >= 0) printf(", \"%s_per_op\": %.2f", counter_names[i], r.per_op[i]);
+            }
+            printf("}");
+        } else {
+            printf("%-24s %10llu %9.1f %9.1f %9.1f %9.1f %9.1f", b->name,
+                   (unsigned long long)r.batch, r.ns[0], r.ns[1], r.ns[2], r.ns[3], r.ns[4]);
+            for (int i = 0; i < CTR_COUNT && ctr.count; i++) {
+                if (r.per_op[i] >= 0) printf(" %9.1f", r.per_op[i]);
+                else printf(" %9s", "-");
+            }
+            printf("\n");
+        }
+        fflush(stdout);
+        first = 0;
+    }
+    if (json) printf("\n]}\n");
+
+    counters_close(&ctr);
+    return 0;
+}
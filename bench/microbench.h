@@ -0,0 +1,31 @@
+#ifndef MICROBENCH_H
+#define MICROBENCH_H
+
+#include <stdint.h>
+
+/*
+ * Microbenchmark harness for the server's per-request components.
+ *
+ * A benchmark is a function that performs its operation `iterations`
+ * times. The harness calibrates a batch size that runs for about the
+ * target batch time, warms up, then times many batches and reports the
+ * per-operation distribution, with hardware counters when the kernel
+ * allows perf_event_open().
+ */
+typedef struct {
+    const char* name;
+    const char* description;
+    void (*setup)(void);                // Optional, runs once before warmup
+    void (*run)(uint64_t iterations);
+    void (*teardown)(void);             // Optional
+} MicroBench;
+
+// Defined by the benchmark file: the table of benchmarks, NULL-terminated
+extern const MicroBench micro_benches[];
+
+// Keeps results alive so the compiler cannot drop the measured work
+extern volatile uintptr_t micro_sink;
+
+#define MICRO_KEEP(value) (micro_sink += (uintptr_t)(value))
+
+#endif // MICROBENCH_H
@@ -0,0 +1,93 @@
+#!/bin/sh
+#
+# Standard load scenarios against a locally launched server (make bench).
+#
+# Starts bin/server on spare ports, runs bin/load_gen once per scenario and
+# writes every result, one JSON object per scenario, to
+# bench/results/<commit>.json so runs on different commits can be diffed.
+#
+# Tunables (environment): BENCH_DURATION (seconds per scenario, default 5),
+# BENCH_CONNECTIONS (default 32), BENCH_HTTP_PORT / BENCH_HTTPS_PORT
+# (default 18080 / 18443), BENCH_RATE (open-loop requests/s, default 2000).
+#
+set -u
+
+cd "$(dirname "$0")/.." || exit 1
+
+DURATION=${BENCH_DURATION:-5}
+CONNS=${BENCH_CONNECTIONS:-32}
+HTTP_PORT=${BENCH_HTTP_PORT:-18080}
+HTTPS_PORT=${BENCH_HTTPS_PORT:-18443}
+RATE=${BENCH_RATE:-2000}
+
+COMMIT=$(git rev-parse --short HEAD 2>/dev/null || echo unknown)
+if [ -n "$(git status --porcelain --untracked-files=no 2>/dev/null)" ]; then
+    COMMIT="$COMMIT-dirty"
+fi
+RESULTS=bench/results/$COMMIT.json
+
+WORK=$(mktemp -d)
+CONF=$WORK/bench.conf
+cat > "$CONF" <<CONF
+log_level = warn
+access_log = $WORK/access.bin
+db_path = $WORK/users.db
+CONF
+
+./bin/server -c "$CONF" -p "$HTTP_PORT" -s "$HTTPS_PORT" > "$WORK/server.out" 2>&1 &
+SERVER=$!
+trap 'kill -INT $SERVER 2>/dev/null; wait $SERVER 2>/dev/null; rm -rf "$WORK"' EXIT INT TERM
+
+# Wait for the listener
+i=0
+until ./bin/load_gen -p "$HTTP_PORT" -c 1 -n 1 -d 1 -u /api/status > /dev/null 2>&1; do
+    i=$((i + 1))
+    if [ $i -ge 50 ] || ! kill -0 $SERVER 2>/dev/null; then
+        echo "Server did not start:" >&2
+        cat "$WORK/server.out" >&2
+        exit 1
+    fi
+    sleep 0.1
+done
+
+# A user for the login scenario, in the throwaway database above
+./bin/load_gen -p "$HTTP_PORT" -c 1 -n 1 -m POST -u /register \
+    -b "username=benchuser&password=bench-password" > /dev/null 2>&1
+
+mkdir -p bench/results
+: > "$WORK/results"
+
+run() {
+    name=$1
+    shift
+    printf '%-24s' "$name" >&2
+    if ./bin/load_gen -s "$name" -d "$DURATION" "$@" >> "$WORK/results"; then
+        tail -n 1 "$WORK/results" | sed 's/.*"throughput_rps": \([0-9.]*\).*"p99": \([0-9]*\).*/\1 req\/s, p99 \2 us/' >&2
+    else
+        echo "failed" >&2
+    fi
+}
+
+HTTP="-p $HTTP_PORT"
+HTTPS="-p $HTTPS_PORT -t"
+
+run static_small          $HTTP  -c "$CONNS" -u /index.html
+run static_small_pipeline $HTTP  -c "$CONNS" -u /index.html -P 8
+run static_small_tls      $HTTPS -c "$CONNS" -u /index.html
+run static_small_close    $HTTP  -c "$CONNS" -u /index.html -K
+run static_small_open     $HTTP  -c "$CONNS" -u /index.html -r "$RATE"
+run range_mp4             $HTTP  -c "$CONNS" -u /videos/reset.mp4 -H "Range: bytes=0-65535"
+run range_mp4_tls         $HTTPS -c "$CONNS" -u /videos/reset.mp4 -H "Range: bytes=0-65535"
+run api_status            $HTTP  -c "$CONNS" -u /api/status
+run revalidate_304        $HTTP  -c "$CONNS" -u /index.html -E
+run login_post            $HTTP  -c 8 -m POST -u /login \
+                                 -b "username=benchuser&password=bench-password"
+
+{
+    printf '{"commit": "%s", "date": "%s", "duration_s": %s, "results": [\n' \
+        "$COMMIT" "$(date -u +%Y-%m-%dT%H:%M:%SZ)" "$DURATION"
+    sed '$!s/$/,/' "$WORK/results"
+    printf ']}\n'
+} > "$RESULTS"
+
+echo "Results: $RESULTS" >&2
@@ -0,0 +1,255 @@
+/*
+ * TLS handshake throughput benchmark
+ *
+ * Opens connections to the HTTPS port as fast as possible and reports
+ * handshakes per second and handshake latency. Restricting the client's
+ * signature algorithms forces the server to use its ECDSA or RSA
+ * certificate, so one server running with both can be compared directly:
+ *
+ *   make bench
+ *   ./bin/tls_handshake_bench -p 443 -c 8 -n 4000 -s rsa
+ *   ./bin/tls_handshake_bench -p 443 -c 8 -n 4000 -s ecdsa
+ *   ./bin/tls_handshake_bench -p 443 -c 8 -n 4000 -s ecdsa -r    # resumed
+ *
+ * Run it on a different machine (or pinned to different cores) than the
+ * server, otherwise client-side crypto is measured as well.
+ */
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    pthread_t thread;
+    int       count;            // Handshakes to perform
+    int       done;
+    int       failed;
+    uint64_t* latency_us;
+} Worker;
+
+static const char* g_host = "127.0.0.1";
+static const char* g_port = "443";
+static const char* g_sigalgs = NULL;
+static int         g_version = 0;
+static int         g_resume = 0;
+static SSL_CTX*    g_ctx = NULL;
+static struct addrinfo* g_addr = NULL;
+
+static uint64_t now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static int connect_tcp(void) {
+    int fd = socket(g_addr->ai_family, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(fd, g_addr->ai_addr, g_addr->ai_addrlen) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* One connection + handshake. Returns the SSL (for inspection) or NULL. */
+static SSL* handshake(SSL_SESSION* session) {
+    int fd = connect_tcp();
+    if (fd < 0) return NULL;
+
+    SSL* ssl = SSL_new(g_ctx);
+    SSL_set_fd(ssl, fd);
+    if (session) SSL_set_session(ssl, session);
+
+    if (SSL_connect(ssl) != 1) {
+        ERR_clear_error();
+        SSL_free(ssl);
+        close(fd);
+        return NULL;
+    }
+    return ssl;
+}
+
+static void finish(SSL* ssl) {
+    int fd = SSL_get_fd(ssl);
+    SSL_shutdown(ssl);
+    SSL_free(ssl);
+    close(fd);
+}
+
+static void* worker_main(void* arg) {
+    Worker* w = (Worker*)arg;
+    SSL_SESSION* session = NULL;
+
+    for (int i = 0; i < w->count; i++) {
+        uint64_t start = now_us();
+        SSL* ssl = handshake(session);
+        if (!ssl) {
+            w->failed++;
+            continue;
+        }
+        w->latency_us[w->done++] = now_us() - start;
+
+        if (g_resume && !session) {
+            // TLS 1.3 tickets arrive after the handshake: do one request so
+            // they are read before the session is saved
+            static const char req[] = "HEAD / HTTP/1.1\r\nHost: bench\r\nConnection: close\r\n\r\n";
+            char buf[4096];
+            SSL_write(ssl, req, sizeof(req) - 1);
+            while (SSL_read(ssl, buf, sizeof(buf)) > 0) { }
+            session = SSL_get1_session(ssl);
+        }
+        finish(ssl);
+    }
+
+    SSL_SESSION_free(session);
+    return NULL;
+}
+
+static int compare_u64(const void* a, const void* b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return x < y ? -1 : x > y;
+}
+
+static const char* key_type_name(SSL* ssl) {
+    X509* cert = SSL_get1_peer_certificate(ssl);
+    if (!cert) return "none";
+
+    const char* name = "other";
+    switch (EVP_PKEY_get_base_id(X509_get0_pubkey(cert))) {
+        case EVP_PKEY_RSA: name = "RSA";   break;
+        case EVP_PKEY_EC:  name = "ECDSA"; break;
+        case EVP_PKEY_ED25519: name = "Ed25519"; break;
+    }
+    X509_free(cert);
+    return name;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+        "Usage: %s [-h host] [-p port] [-n handshakes] [-c threads]\n"
+        "          [-s rsa|ecdsa] [-v 1.2|1.3] [-r]\n"
+        "  -s  restrict signature algorithms to pick the server certificate\n"
+        "  -v  pin the protocol version\n"
+        "  -r  resume sessions after the first handshake of each thread\n", prog);
+}
+
+int main(int argc, char** argv) {
+    int total = 2000;
+    int threads = 4;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "h:p:n:c:s:v:r")) != -1) {
+        switch (opt) {
+            case 'h': g_host = optarg; break;
+            case 'p': g_port = optarg; break;
+            case 'n': total = atoi(optarg); break;
+            case 'c': threads = atoi(optarg); break;
+            case 's':
+                if (strcmp(optarg, "rsa") == 0)
+                    g_sigalgs = "rsa_pss_rsae_sha256:rsa_pss_rsae_sha384:rsa_pkcs1_sha256";
+                else if (strcmp(optarg, "ecdsa") == 0)
+                    g_sigalgs = "ECDSA+SHA256:ECDSA+SHA384";
+                else { usage(argv[0]); return 1; }
+                break;
+            case 'v':
+                g_version = strcmp(optarg, "1.2") == 0 ? TLS1_2_VERSION : TLS1_3_VERSION;
+                break;
+            case 'r': g_resume = 1; break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if (total <= 0 || threads <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    if (getaddrinfo(g_host, g_port, &hints, &g_addr) != 0) {
+        fprintf(stderr, "Cannot resolve %s:%s\n", g_host, g_port);
+        return 1;
+    }
+
+    g_ctx = SSL_CTX_new(TLS_client_method());
+    SSL_CTX_set_verify(g_ctx, SSL_VERIFY_NONE, NULL);
+    SSL_CTX_set_session_cache_mode(g_ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL);
+    if (g_version) {
+        SSL_CTX_set_min_proto_version(g_ctx, g_version);
+        SSL_CTX_set_max_proto_version(g_ctx, g_version);
+    }
+    if (g_sigalgs && SSL_CTX_set1_sigalgs_list(g_ctx, g_sigalgs) != 1) {
+        fprintf(stderr, "Signature algorithms rejected: %s\n", g_sigalgs);
+        return 1;
+    }
+
+    // Probe once to report what was negotiated
+    SSL* probe = handshake(NULL);
+    if (!probe) {
+        fprintf(stderr, "Handshake with %s:%s failed\n", g_host, g_port);
+        ERR_print_errors_fp(stderr);
+        return 1;
+    }
+    int group = SSL_get_negotiated_group(probe);
+    printf("Negotiated: %s, %s, %s certificate, group %s\n",
+           SSL_get_version(probe), SSL_get_cipher_name(probe), key_type_name(probe),
+           group ? SSL_group_to_name(probe, group) : "n/a");
+    finish(probe);
+
+    Worker* workers = calloc((size_t)threads, sizeof(Worker));
+    uint64_t* latencies = calloc((size_t)total, sizeof(uint64_t));
+
+    int offset = 0;
+    for (int i = 0; i < threads; i++) {
+        workers[i].count = total / threads + (i < total % threads);
+        workers[i].latency_us = latencies + offset;
+        offset += workers[i].count;
+    }
+
+    uint64_t start = now_us();
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]);
+    }
+
+    int done = 0, failed = 0;
+    for (int i = 0; i < threads; i++) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    double elapsed = (double)(now_us() - start) / 1e6;
+
+    // Compact the per-thread latency slices before sorting
+    for (int i = 0; i < threads; i++) {
+        memmove(latencies + done, workers[i].latency_us, (size_t)workers[i].done * sizeof(uint64_t));
+        done += workers[i].done;
+        failed += workers[i].failed;
+    }
+    qsort(latencies, (size_t)done, sizeof(uint64_t), compare_u64);
+
+    printf("%d handshakes (%d failed) in %.2f s with %d threads%s\n",
+           done, failed, elapsed, threads, g_resume ? ", resumed" : "");
+    printf("Throughput: %.0f handshakes/s\n", done / elapsed);
+    if (done > 0) {
+        printf("Latency: p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+               latencies[done / 2] / 1000.0,
+               latencies[(size_t)(done * 0.99)] / 1000.0,
+               latencies[done - 1] / 1000.0);
+    }
+
+    free(latencies);
+    free(workers);
+    SSL_CTX_free(g_ctx);
+    freeaddrinfo(g_addr);
+    return failed ? 2 : 0;
+}
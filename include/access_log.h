@@ -0,0 +1,90 @@
+#ifndef ACCESS_LOG_H
+#define ACCESS_LOG_H
+
+#include <stdint.h>
+
+/*
+ * Binary access log: a header slot followed by fixed 64-byte slots, each a
+ * request record or the start of a path definition. Paths are stored once
+ * per file as definitions and referenced from request records by id, a
+ * 64-bit hash of the path; a definition longer than fits in its first slot
+ * continues in raw slots immediately after it. Slots of type 0 are unused
+ * (file tail after a crash) and are skipped. All fields are little-endian.
+ *
+ * Decode with: ./bin/access_log_decode [-f json|csv] <file>
+ */
+#define ACCESS_LOG_MAGIC   "SNAPACC1"
+#define ACCESS_LOG_VERSION 2
+#define ACCESS_LOG_SLOT    64
+
+enum {
+    ACCESS_REC_EMPTY   = 0,
+    ACCESS_REC_REQUEST = 1,
+    ACCESS_REC_PATH    = 2
+};
+
+enum {
+    ACCESS_METHOD_OTHER = 0,
+    ACCESS_METHOD_GET,
+    ACCESS_METHOD_HEAD,
+    ACCESS_METHOD_POST,
+    ACCESS_METHOD_PUT,
+    ACCESS_METHOD_DELETE,
+    ACCESS_METHOD_OPTIONS
+};
+
+#define ACCESS_FLAG_TLS        0x01
+#define ACCESS_FLAG_EARLY_DATA 0x02    // Served from TLS 1.3 0-RTT data
+#define ACCESS_FLAG_KEEP_ALIVE 0x04
+#define ACCESS_FLAG_IPV6       0x08    // client_ip holds 16 bytes, else the first 4
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t slot_size;
+    uint64_t created_us;        // Wall clock, microseconds since the epoch
+    uint8_t  reserved[40];
+} AccessLogHeader;
+
+typedef struct {
+    uint8_t  type;              // ACCESS_REC_REQUEST
+    uint8_t  method;
+    uint8_t  flags;
+    uint8_t  reserved;
+    uint16_t status;
+    uint16_t client_port;
+    uint32_t latency_us;        // Request parsed to response sent
+    uint64_t path_id;
+    uint64_t timestamp_us;      // Wall clock at completion
+    uint64_t bytes;             // Bytes sent for this request
+    uint8_t  client_ip[16];
+    uint8_t  pad[8];
+} AccessRecord;
+
+#define ACCESS_PATH_INLINE 48
+
+typedef struct {
+    uint8_t  type;              // ACCESS_REC_PATH
+    uint8_t  reserved;
+    uint16_t length;            // Total path length (may span further slots)
+    uint8_t  pad[4];
+    uint64_t path_id;           // 64-bit FNV-1a, so distinct paths in a file do not collide
+    char     path[ACCESS_PATH_INLINE];
+} AccessPathRecord;
+
+_Static_assert(sizeof(AccessLogHeader)  == ACCESS_LOG_SLOT, "header must fill one slot");
+_Static_assert(sizeof(AccessRecord)     == ACCESS_LOG_SLOT, "record must fill one slot");
+_Static_assert(sizeof(AccessPathRecord) == ACCESS_LOG_SLOT, "path record must fill one slot");
+
+#ifndef ACCESS_LOG_NO_WRITER
+#include "types.h"
+
+int  access_log_init(const char* path, int size_mb);
+void access_log_close(void);
+
+// Appends one record for a completed request; a no-op if the log is off
+void access_log_request(const Client* client, const Connection* conn, uint64_t latency_us,
+                        uint64_t bytes);
+#endif
+
+#endif // ACCESS_LOG_H
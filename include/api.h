@@ -28,9 +28,20 @@ void handle_api_request(Client* client);
 void handle_api_status(Client* client);
 void handle_api_info(Client* client);
 void handle_api_files(Client* client);
+void handle_api_videos(Client* client);
 void handle_api_config(Client* client);
 void handle_api_time(Client* client);
 void handle_api_logout(Client* client);
+void handle_api_tls(Client* client);
+void handle_api_metrics(Client* client);
+void handle_api_latency(Client* client);
+
+// Loopback-only administration
+int  api_require_admin(Client* client);
+void handle_api_admin_log_level(Client* client);
+void handle_api_admin_trace(Client* client);
+void handle_api_admin_connections(Client* client);
+void handle_api_admin_workers(Client* client);
 
 void send_api_error(Client* client, int status_code, const char* error_code, const char* message);
 
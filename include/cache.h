@@ -9,8 +9,8 @@ struct Node* cache_lookup(struct Node* tree_head, const char* path);
 unsigned int cache_hash_path(const char* path);
 
 // Cache tree management
-struct Node* cache_tree_init(const char* root_dir);
+struct Node* cache_tree_init(const char* root_dir, size_t budget, size_t* used);
 void cache_tree_free(struct Node* tree_head);
-void cache_tree_refresh(struct Node** tree_head, const char* root_dir);
+void cache_tree_refresh(struct Node** tree_head, const char* root_dir, size_t budget, size_t* used);
 
 #endif
\ No newline at end of file
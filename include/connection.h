@@ -0,0 +1,49 @@
+#ifndef CONNECTION_H
+#define CONNECTION_H
+
+#include "types.h"
+
+// Per-slot read buffer: headers plus the largest accepted body, plus a NUL
+#define CONNECTION_BUFFER_SIZE (MAX_REQUEST_SIZE + MAX_BODY_SIZE + 1)
+
+// Copy of a live connection's public state, for introspection
+typedef struct ConnectionInfo {
+    int       fd;
+    char      client_ip[INET6_ADDRSTRLEN];
+    int       client_port;
+    int       is_ssl;
+    ConnState state;
+    uint64_t  age_us;
+    uint64_t  bytes_in;
+    uint64_t  bytes_out;
+    uint32_t  requests;
+    int       worker_tid;               // Serving thread, 0 while queued
+    char      request_line[96];         // Current (or last) "<method> <path>"
+    uint64_t  request_age_us;           // Since the current request was read (0 = between requests)
+    uint64_t  response_sent;            // Bytes of the current response written so far
+    uint64_t  response_total;           // Its full size, 0 if not known up front
+} ConnectionInfo;
+
+// Connection table, indexed by socket fd
+int  connection_table_init(int max_connections);
+void connection_table_destroy(void);
+
+// Claims the slot for a freshly accepted fd; NULL if fd is beyond the table
+Connection* connection_acquire(int client_fd);
+
+// Returns the slot to the pool; call before close(fd)
+void connection_release(Connection* conn);
+
+// Ensures the slot's read buffer exists (allocated on first use, then kept)
+int connection_alloc_buffer(Connection* conn);
+
+int connection_count(void);
+int connection_snapshot(ConnectionInfo* out, int max);
+
+// Fills info for one slot (e.g. a worker's current argument); -1 if conn is
+// not a live slot of the table
+int connection_describe(const Connection* conn, ConnectionInfo* info);
+
+const char* connection_state_name(ConnState state);
+
+#endif // CONNECTION_H
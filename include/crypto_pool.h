@@ -0,0 +1,19 @@
+#ifndef CRYPTO_POOL_H
+#define CRYPTO_POOL_H
+
+#include "thread_pool.h"
+
+// Returned when the crypto queue is saturated; callers answer 503
+#define CRYPTO_BUSY (-2)
+
+// Dedicated, bounded pool for password hashing (Argon2id)
+int  crypto_pool_init(int num_threads, int max_queue_size);
+void crypto_pool_destroy(void);
+
+// Runs func(arg) on a crypto worker and blocks until it finishes.
+// Returns func's int result, or CRYPTO_BUSY if the job was not admitted.
+int crypto_pool_run(int (*func)(void* arg), void* arg);
+
+void crypto_pool_get_stats(struct ThreadPoolStats* stats);
+
+#endif // CRYPTO_POOL_H
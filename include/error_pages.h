@@ -3,28 +3,34 @@
 
 #include <stddef.h>
 
+// Custom error pages of one webroot (each virtual host has its own set)
+typedef struct ErrorPages ErrorPages;
+
 /**
- * Loads HTML error pages from public/error_pages/ into memory.
- * Call once at server startup.
+ * Loads HTML error pages from <webroot>/public/error_pages/ into memory.
+ * Call once per webroot at server startup.
+ *
+ * @param webroot Server or virtual host webroot (e.g. SERVER_PATH)
  *
- * @param webroot Server webroot (e.g. SERVER_PATH)
+ * @return Page set (possibly empty), or NULL on allocation failure
  */
-void error_pages_init(const char* webroot);
+ErrorPages* error_pages_init(const char* webroot);
 
 /**
  * Returns the in-memory content for the given HTTP status code, or NULL
  * if no custom page was loaded for that code.
  *
+ * @param pages   Page set from error_pages_init() (NULL = none)
  * @param code    HTTP status code (e.g. 404)
  * @param out_len Set to the byte length of the returned content
  *
  * @return Pointer to null-terminated HTML string, or NULL
  */
-const char* error_pages_get(int code, size_t* out_len);
+const char* error_pages_get(const ErrorPages* pages, int code, size_t* out_len);
 
 /**
  * Frees all loaded error page content. Call at server shutdown.
  */
-void error_pages_free(void);
+void error_pages_free(ErrorPages* pages);
 
 #endif /* ERROR_PAGES_H */
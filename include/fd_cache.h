@@ -0,0 +1,79 @@
+#ifndef FD_CACHE_H
+#define FD_CACHE_H
+
+#include <stdint.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/*
+ * Open file descriptor cache for static files.
+ *
+ * Keeps up to fd_cache_size files open, keyed on their resolved path,
+ * together with their stat data, so a hit costs no open(), fstat() or
+ * stat(). Entries are shared by all workers and reference counted: a
+ * sender keeps its entry (and so its fd) open even if the entry is
+ * evicted or invalidated meanwhile. Senders read with positioned I/O
+ * (pread, io_uring reads at an offset), since the file offset is shared.
+ *
+ * Entries are dropped on every cache refresh (SIGUSR1) and re-checked with
+ * one stat() of the path once they are fd_cache_valid seconds old, so a
+ * file replaced on disk is picked up within that time.
+ */
+typedef struct FdCacheEntry {
+    char*       path;
+    uint32_t    hash;
+    int         fd;
+    struct stat st;             // fstat() at open time
+    time_t      validated;      // Monotonic seconds of the last open or stat check
+    int         refs;           // The cache's reference (while cached) plus one per user
+    int         cached;         // Still reachable from the table
+
+    struct FdCacheEntry* chain;         // Next in the hash bucket
+    struct FdCacheEntry* lru_prev;      // Towards most recently used
+    struct FdCacheEntry* lru_next;
+} FdCacheEntry;
+
+/**
+ * Sets up the cache
+ *
+ * @param capacity Files kept open (0 = no caching, every call opens)
+ * @param connections Descriptors to leave for client sockets
+ * @param valid_seconds Age after which a hit is re-checked with stat() (0 = never)
+ *
+ * @return 0 on success, -1 on allocation failure
+ *
+ * @note capacity is lowered to fit RLIMIT_NOFILE beside the connections,
+ *       after raising the soft limit as far as the hard one allows
+ */
+int  fd_cache_init(int capacity, int connections, int valid_seconds);
+void fd_cache_shutdown(void);
+
+/**
+ * Returns an open, stat'ed file for path
+ *
+ * @param path Resolved filesystem path
+ *
+ * @return Entry with a reference for the caller, or NULL with errno set
+ *         by open() (ENOENT, EACCES, ...)
+ *
+ * @warning Release with fd_cache_release(); never close entry->fd
+ */
+FdCacheEntry* fd_cache_open(const char* path);
+void          fd_cache_release(FdCacheEntry* entry);
+
+// Takes another reference, for handing the open file to another thread
+void          fd_cache_retain(FdCacheEntry* entry);
+
+// Drops every entry; files still being sent close when released. Also
+// frees descriptors when accept() runs out of them.
+void fd_cache_invalidate(void);
+
+struct FdCacheStats {
+    uint64_t hits;
+    uint64_t misses;            // Opened a file (not cached, changed, or first use)
+    int      entries;
+};
+
+void fd_cache_get_stats(struct FdCacheStats* stats);
+
+#endif // FD_CACHE_H
@@ -0,0 +1,49 @@
+#ifndef FILE_MAP_H
+#define FILE_MAP_H
+
+#include <stddef.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+struct Node;
+
+/*
+ * Read-only mappings of static files, shared through their cache node.
+ *
+ * The first sender of a file maps it and hangs the mapping on the node;
+ * later senders on any worker take a reference to the same mapping. A
+ * mapping whose file has changed (inode, size or mtime differ from the
+ * sender's fstat) is replaced, and the old one is unmapped once its last
+ * sender releases it.
+ *
+ * Files must be replaced by rename, not rewritten in place: truncating a
+ * file while it is mapped makes senders fault (SIGBUS). That is why
+ * tls_mmap is off unless the configuration turns it on.
+ */
+typedef struct FileMap {
+    const unsigned char* data;
+    size_t size;
+    dev_t  dev;
+    ino_t  ino;
+    struct timespec mtime;
+    int    refs;                // Node's reference plus one per sender
+} FileMap;
+
+/**
+ * Returns the node's mapping of the open file, mapping it if needed
+ *
+ * @param node Cache node of the file; holds a reference to the mapping
+ * @param fd Open descriptor of the file being sent
+ * @param st fstat() of fd
+ *
+ * @return Mapping with a reference for the caller, or NULL if the file is
+ *         empty or cannot be mapped (send it with read() instead)
+ *
+ * @warning Release with file_map_release()
+ */
+FileMap* file_map_acquire(struct Node* node, int fd, const struct stat* st);
+
+// Drops a reference; the last one unmaps the file
+void file_map_release(FileMap* map);
+
+#endif // FILE_MAP_H
@@ -0,0 +1,36 @@
+#ifndef HDR_HISTOGRAM_H
+#define HDR_HISTOGRAM_H
+
+#include <stdint.h>
+
+/*
+ * Log-linear ("HDR") histogram of microsecond values.
+ *
+ * Values below 2^HDR_SUB_BITS are counted exactly; above that every power
+ * of two is split into 2^(HDR_SUB_BITS-1) equal buckets, so any recorded
+ * value is known to within about 3%. Recording is an index computation and
+ * one counter increment, with no search and no allocation.
+ *
+ * A histogram has a single writer (the owning thread); readers merge
+ * copies with hdr_merge() and may see counts a few records stale.
+ */
+#define HDR_SUB_BITS  6
+#define HDR_MAX_BITS  32            // Values are clamped to 2^32-1 us (~71 minutes)
+#define HDR_BUCKETS   (((HDR_MAX_BITS - HDR_SUB_BITS + 1) << (HDR_SUB_BITS - 1)) + (1 << (HDR_SUB_BITS - 1)))
+
+typedef struct {
+    uint64_t counts[HDR_BUCKETS];
+    uint64_t total;
+    uint64_t sum;
+    uint64_t max;
+} HdrHistogram;
+
+void     hdr_record(HdrHistogram* h, uint64_t value);
+void     hdr_merge(HdrHistogram* dst, const HdrHistogram* src);
+
+// Smallest value v such that at least percentile% of records are <= v
+// (to bucket precision). 0 for an empty histogram.
+uint64_t hdr_percentile(const HdrHistogram* h, double percentile);
+double   hdr_mean(const HdrHistogram* h);
+
+#endif // HDR_HISTOGRAM_H
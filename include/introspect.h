@@ -0,0 +1,30 @@
+#ifndef INTROSPECT_H
+#define INTROSPECT_H
+
+struct ThreadPool;
+
+/*
+ * Live views of the server for the admin API: every open connection
+ * (GET /api/admin/connections) and what each request worker is doing
+ * (GET /api/admin/workers). Both are unsynchronized snapshots; a request
+ * may move on while it is being described.
+ */
+
+// Request worker pool described by introspect_render_workers()
+void introspect_init(struct ThreadPool* pool);
+
+/**
+ * Renders every live connection as JSON
+ *
+ * @return Heap-allocated JSON (caller frees), or NULL if memory ran out
+ */
+char* introspect_render_connections(void);
+
+/**
+ * Renders each request worker and the connection it is serving as JSON
+ *
+ * @return Heap-allocated JSON (caller frees), or NULL if memory ran out
+ */
+char* introspect_render_workers(void);
+
+#endif // INTROSPECT_H
@@ -0,0 +1,54 @@
+#ifndef IO_ENGINE_H
+#define IO_ENGINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+// Largest chunk io_file_to_socket() moves per call (size of the registered buffer)
+#define IO_ENGINE_CHUNK 65536
+
+typedef enum {
+    IO_ENGINE_BLOCKING,     // One blocking syscall per operation
+    IO_ENGINE_URING         // io_uring, raw syscalls (no liburing)
+} IoEngineKind;
+
+// One connection delivered by the multishot accept
+typedef struct {
+    int listener;   // Index into the array passed to io_accept_start()
+    int fd;         // Accepted socket, or -EMFILE / -ENFILE when out of descriptors
+} IoAcceptEvent;
+
+struct IoEngineStats {
+    uint64_t ops;       // Operations submitted to io_uring
+    uint64_t enters;    // io_uring_enter() calls that submitted or waited
+};
+
+// Selects the engine by name ("blocking" or "io_uring"). Falls back to
+// blocking, with a warning, if io_uring is unavailable.
+IoEngineKind io_engine_init(const char* name);
+IoEngineKind io_engine_kind(void);
+const char*  io_engine_name(void);
+void         io_engine_shutdown(void);
+void         io_engine_get_stats(struct IoEngineStats* stats);
+
+// Plaintext socket I/O with blocking semantics, whichever engine is active
+ssize_t io_recv(int fd, void* buf, size_t len);
+ssize_t io_send(int fd, const void* buf, size_t len);
+
+// Nonzero if the calling thread can use io_file_to_socket()
+int io_uring_ready(void);
+
+// Reads up to len (<= IO_ENGINE_CHUNK) bytes at offset and sends them, as
+// one linked read->send submission. Returns bytes sent, 0 at EOF or on read
+// error, -1 on send error (errno set).
+ssize_t io_file_to_socket(int file_fd, int sock_fd, off_t offset, size_t len);
+
+// Multishot accept on the listening sockets (main thread only).
+// io_accept_wait() returns the number of events, or -1 if multishot accept
+// is not supported and the caller should fall back to select().
+int  io_accept_start(const int* listen_fds, int count);
+int  io_accept_wait(IoAcceptEvent* events, int max, int timeout_ms);
+void io_accept_stop(void);
+
+#endif // IO_ENGINE_H
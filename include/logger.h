@@ -17,8 +17,23 @@ typedef enum {
     LOG_ERROR
 } LogLevel;
 
+// Lowest level written. Read with a relaxed load on every log call.
+extern int g_log_level;
+
+#define log_enabled(level) ((int)(level) >= __atomic_load_n(&g_log_level, __ATOMIC_RELAXED))
+
+// The level is checked before the arguments are evaluated, so a disabled
+// line costs one branch: no formatting, no calls in the argument list.
+#define log_message(level, ...) \
+    do { if (log_enabled(level)) log_write((level), __VA_ARGS__); } while (0)
+
 void log_init(const char* log_file);
-void log_message(LogLevel level, const char* format, ...);
+void log_write(LogLevel level, const char* format, ...) __attribute__((format(printf, 2, 3)));
+void log_reopen(void);
 void log_close(void);
 
+void        log_set_level(LogLevel level);
+int         log_level_parse(const char* name);     // -1 if unknown
+const char* log_level_name(LogLevel level);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,70 @@
+#ifndef MEDIA_INDEX_H
+#define MEDIA_INDEX_H
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "utils.h"
+
+struct Node;
+struct Mp4Faststart;
+
+/*
+ * Catalog of the audio and video files under public/videos (/api/videos).
+ *
+ * Built from a host's cache index whenever that index is built or
+ * refreshed, and swapped together with it under the host's cache lock.
+ * Each entry is stat'ed and probed once at build time; requests only read
+ * the catalog. MP4 files whose moov comes after their media data also get
+ * a faststart view (mp4.h), which the file sender serves in their place.
+ */
+typedef struct MediaEntry {
+    char*        url;           // "/videos/trips/beach.mp4"
+    const char*  mime;          // From the MIME table
+    off_t        size;
+    time_t       mtime;
+    unsigned int etag;          // Same value as the file's ETag header
+    double       duration;      // Seconds, < 0 if unknown
+    char*        poster;        // URL of a same-named image next to it, or NULL
+    int          moov_first;    // MP4 whose moov already precedes its media data
+    struct Mp4Faststart* faststart;     // moov-first view of the file, or NULL
+} MediaEntry;
+
+typedef struct MediaIndex {
+    MediaEntry* entries;        // Sorted by url
+    size_t      count;
+    char*       public_dir;     // webroot/public; url = path minus this
+} MediaIndex;
+
+/**
+ * Builds the catalog of a host
+ *
+ * @param webroot Host webroot; entries are the indexed files under
+ *                webroot/public/videos with an audio/ or video/ MIME type
+ * @param tree The host's cache index
+ *
+ * @return Catalog (possibly empty), or NULL if memory ran out
+ */
+MediaIndex* media_index_build(const char* webroot, const struct Node* tree);
+void        media_index_free(MediaIndex* index);
+
+/**
+ * Finds the faststart view of a file
+ *
+ * @param full_path Resolved filesystem path of the request
+ *
+ * @return View, or NULL if the file has none; valid while the host's
+ *         cache lock is held
+ */
+const struct Mp4Faststart* media_index_faststart(const MediaIndex* index, const char* full_path);
+
+/**
+ * Appends one page of the catalog as a JSON object
+ *
+ * @param page 1-based page number
+ * @param per_page Entries per page
+ */
+void media_index_render(const MediaIndex* index, TextBuffer* buf, size_t page, size_t per_page);
+
+#endif // MEDIA_INDEX_H
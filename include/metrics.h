@@ -0,0 +1,73 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct ThreadPool;
+
+/*
+ * Server metrics in the Prometheus text format (GET /api/metrics).
+ *
+ * Every thread that records a metric owns a cache-line-aligned shard of
+ * plain counters that only it writes. A scrape sums the shards, so the
+ * request path never touches a cache line another thread writes to.
+ */
+
+typedef enum {
+    METRICS_HANDSHAKE_FULL,
+    METRICS_HANDSHAKE_RESUMED,
+    METRICS_HANDSHAKE_FAILED,
+    METRICS_HANDSHAKE_KINDS
+} MetricsHandshake;
+
+// Latency phases, recorded per route class into HDR histograms
+typedef enum {
+    METRICS_ROUTE_STATIC,
+    METRICS_ROUTE_API,
+    METRICS_ROUTE_POST,
+    METRICS_ROUTES
+} MetricsRoute;
+
+typedef enum {
+    METRICS_PHASE_QUEUE,        // Accepted -> picked up by a worker (first request)
+    METRICS_PHASE_HANDSHAKE,    // Picked up -> TLS handshake done (first request)
+    METRICS_PHASE_PARSE,        // Request read -> parsed
+    METRICS_PHASE_ROUTE,        // Parsed -> handler chosen, file opened
+    METRICS_PHASE_FIRST_BYTE,   // Routed (or parsed) -> first bytes written
+    METRICS_PHASE_SEND,         // First bytes -> last bytes written
+    METRICS_PHASE_TOTAL,        // Request read -> last bytes written
+    METRICS_PHASES
+} MetricsPhase;
+
+// Gauges read at scrape time come from the worker pool
+void metrics_init(struct ThreadPool* pool);
+
+void metrics_record_request(const char* method, int status, uint64_t bytes, uint64_t latency_us);
+void metrics_record_cache(int hit);
+void metrics_record_handshake(MetricsHandshake kind, uint64_t duration_us);
+void metrics_record_phase(MetricsRoute route, MetricsPhase phase, uint64_t duration_us);
+
+// Sums of the handshake counters over all threads
+void metrics_handshake_totals(unsigned long totals[METRICS_HANDSHAKE_KINDS]);
+
+/**
+ * Renders every metric in the Prometheus text exposition format
+ *
+ * @param len Set to the length of the returned text
+ *
+ * @return Heap-allocated, NUL-terminated text (caller frees), or NULL
+ */
+char* metrics_render(size_t* len);
+
+/**
+ * Renders count, mean, percentiles and max of every latency phase as JSON
+ *
+ * @param route Route class name ("static", "api", "post") or NULL for all
+ *
+ * @return Heap-allocated JSON (caller frees), or NULL if the route is
+ *         unknown or memory ran out
+ */
+char* metrics_render_latency(const char* route);
+
+#endif // METRICS_H
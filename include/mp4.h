@@ -0,0 +1,93 @@
+#ifndef MP4_H
+#define MP4_H
+
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/*
+ * Minimal ISO base media (MP4/MOV) box reader for the media index.
+ *
+ * Only box headers and the movie header are read, never sample data, so
+ * probing costs a few small pread() calls however large the file is.
+ */
+typedef struct {
+    double   duration;          // Seconds (mvhd duration / timescale), < 0 if unknown
+    off_t    moov_offset;       // Start of the moov box, -1 if absent
+    uint64_t moov_size;
+    off_t    mdat_offset;       // Start of the first mdat box, -1 if absent
+} Mp4Info;
+
+/**
+ * Reads the top-level box layout and the movie header of an MP4 file
+ *
+ * @param fd Open file (read with pread; the file offset is not used)
+ * @param size File size in bytes
+ * @param info Filled in; fields that could not be found keep their
+ *             "unknown" values
+ *
+ * @return 0 if the file looks like MP4 (has a moov box), -1 otherwise
+ */
+int mp4_probe(int fd, off_t size, Mp4Info* info);
+
+/*
+ * Virtual "faststart" view of a file whose moov box follows its media
+ * data. The view has the same size as the file, with the moov moved in
+ * front of the first mdat and its chunk offsets (stco/co64) shifted to
+ * match:
+ *
+ *   file:  [head][mdat ...][moov][tail]
+ *   view:  [head][moov'][mdat ...][tail]
+ *
+ * Only the patched moov is held in memory; every other byte of the view
+ * is read from the file. A player can then start from the first bytes
+ * instead of fetching the end of the file first.
+ */
+typedef struct Mp4Faststart {
+    unsigned char* moov;        // Patched moov box
+    uint64_t       moov_size;
+    off_t          moov_offset; // Where the moov sits in the file
+    off_t          mdat_offset; // Where it goes in the view
+    off_t          size;        // File size (== view size)
+
+    // The file the view was built from; a changed file is served as is
+    dev_t           dev;
+    ino_t           ino;
+    struct timespec mtime;
+} Mp4Faststart;
+
+// One piece of a view range: memory (data != NULL) or file bytes
+typedef struct {
+    const unsigned char* data;
+    off_t file_offset;
+    off_t length;
+} Mp4Segment;
+
+#define MP4_MAX_SEGMENTS 4
+
+/**
+ * Builds the faststart view of a probed file
+ *
+ * @param fd Open file
+ * @param st fstat() of fd
+ * @param info Result of mp4_probe() on fd
+ * @param max_moov Largest moov (bytes) worth holding in memory
+ *
+ * @return View, or NULL if the moov already comes first, is too large,
+ *         or its chunk offsets cannot be rewritten in place
+ */
+Mp4Faststart* mp4_faststart_build(int fd, const struct stat* st, const Mp4Info* info, uint64_t max_moov);
+void          mp4_faststart_free(Mp4Faststart* view);
+
+// Nonzero if st still describes the file the view was built from
+int mp4_faststart_matches(const Mp4Faststart* view, const struct stat* st);
+
+/**
+ * Splits [start, start + length) of the view into segments
+ *
+ * @return Number of segments written to out (at most MP4_MAX_SEGMENTS)
+ */
+int mp4_faststart_segments(const Mp4Faststart* view, off_t start, off_t length,
+                           Mp4Segment out[MP4_MAX_SEGMENTS]);
+
+#endif // MP4_H
@@ -14,11 +14,13 @@ struct Node {
 
     char* last_modified;
 
+    struct FileMap* map;        // Shared mapping of the file (file_map.h), NULL until sent over TLS
+
     struct Node* left;
     struct Node* right;
 };
 
-struct Node* init_tree();
+struct Node* init_tree(const char* root_dir, size_t budget, size_t* used);
 struct Node* add_node(struct Node*, char*);
 int hashFile(char* filename);
 int hashPath(const char* filename);
@@ -27,5 +29,6 @@ int insert_node(struct Node*, struct Node*);
 struct Node* lookupNode(struct Node*, unsigned int);
 void printTree(struct Node*, int);
 void free_tree(struct Node*);
+void walk_tree(const struct Node*, void (*visit)(const struct Node*, void*), void* arg);
 
 #endif  
@@ -0,0 +1,30 @@
+#ifndef OVERLOAD_H
+#define OVERLOAD_H
+
+#include "thread_pool.h"
+
+// Counters for connections refused under overload
+struct OverloadStats {
+    unsigned long accept_shed;   // Refused at accept() because the queue was full
+    unsigned long codel_shed;    // Dropped by CoDel after waiting in the queue
+};
+
+// Builds the preformatted 503 response; call once after load_config()
+void overload_init(int retry_after);
+
+// Answers a plaintext connection with the canned 503 and closes it.
+// Never blocks: safe to call from the accept thread.
+void overload_reject(int client_fd);
+
+// Closes a TLS connection before any handshake work is done
+void overload_reject_tls(int client_fd);
+
+// Records a connection shed by CoDel (called from the pool's shed callback)
+void overload_note_codel_shed(void);
+
+// Called from the main loop: logs overload state and shed counts, at most once a second
+void overload_monitor(struct ThreadPool* pool);
+
+void overload_get_stats(struct OverloadStats* stats);
+
+#endif // OVERLOAD_H
@@ -0,0 +1,58 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+struct FdCacheEntry;
+
+/*
+ * Background read-ahead for large files.
+ *
+ * Long sends (video seeks above all) ask for the next window of the file
+ * while the current one goes out. A single prefetch thread turns each
+ * request into posix_fadvise(WILLNEED), so a worker never stalls issuing
+ * the read-ahead itself and, once the send reaches that window, pread()
+ * or the mapping finds the pages already in the page cache.
+ *
+ * The same thread can pre-warm the start of every video (files with a
+ * video/ MIME type) at startup and after each cache refresh, so the first
+ * frames of any video are served without touching the disk.
+ */
+
+/**
+ * Starts the prefetch thread
+ *
+ * @param window_kb Read-ahead window for long sends (0 = prefetcher off)
+ * @param warm_mb Leading megabytes of each video to pre-warm (0 = none)
+ *
+ * @return 0 on success (or when disabled), -1 if the thread could not start
+ */
+int  prefetch_init(int window_kb, int warm_mb);
+void prefetch_shutdown(void);
+
+// Read-ahead window in bytes; 0 when the prefetcher is off
+size_t prefetch_window(void);
+
+/**
+ * Queues read-ahead of [offset, offset + len) of an open file
+ *
+ * Takes its own reference on the file, so the caller may release it
+ * right away. Dropped (not blocking) if the queue is full.
+ */
+void prefetch_file(struct FdCacheEntry* file, off_t offset, size_t len);
+
+// Queues the leading warm_mb of every video in every host's cache index
+void prefetch_warm_videos(void);
+
+struct PrefetchStats {
+    uint64_t requests;          // Windows advised
+    uint64_t bytes;             // Bytes covered by those windows
+    uint64_t dropped;           // Requests refused because the queue was full
+    uint64_t warmed;            // Files pre-warmed
+};
+
+void prefetch_get_stats(struct PrefetchStats* stats);
+
+#endif // PREFETCH_H
@@ -6,6 +6,8 @@
 // Main request parsing function
 // Returns NULL on error (sends error response internally)
 Client* parse_http_request(char* raw_request, int client_fd, SSL* ssl);
+// Same, filling a caller-owned Client. Returns 0 on success, -1 on error.
+int parse_http_request_into(Client* client, char* raw_request, int client_fd, SSL* ssl);
 
 // Request validation
 int validate_http_method(const char* method);
@@ -16,7 +18,8 @@ int validate_path(const char* path);
 char* resolve_request_path(const char* request_path, const char* webroot);
 
 // Request cleanup
-void free_client(Client* client);
+void client_reset(Client* client);   // free fields, keep the struct
+void free_client(Client* client);    // free fields and the struct
 
 // Helper: print request for debugging
 void print_client_info(const Client* client);
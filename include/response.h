@@ -10,6 +10,8 @@ struct Node;
 // Main response functions
 int send_file_response(Client* client, struct Node* cache_node);
 int send_error_response(int status_code, Client* client);
+int send_unavailable_response(int retry_after, Client* client);
+int send_too_early_response(Client* client);
 int send_not_modified_response(Client* client, struct Node* cache_node);
 int send_redirect_response(const char* location, Client* client);
 int send_login_redirect(const char* location, const char* token, int max_age, Client* client);
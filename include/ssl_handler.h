@@ -6,10 +6,51 @@
 #include <openssl/ssl.h>
 #include <openssl/err.h>
 
+// Session resumption counters
+struct TlsStats {
+    unsigned long full_handshakes;
+    unsigned long resumed_handshakes;   // Session ID or ticket
+    unsigned long failed_handshakes;
+    long cache_entries;
+    long cache_hits;                    // Session ID found in the cache
+    long cache_misses;                  // Session ID offered but not found
+    long cache_timeouts;                // Session ID found but expired
+    long cache_full;                    // Evictions because the cache was full
+    unsigned long tickets_issued;
+    unsigned long tickets_accepted;     // Decrypted with the current key
+    unsigned long tickets_renewed;      // Decrypted with the previous key
+    unsigned long tickets_rejected;     // Unknown key (rotated out)
+    unsigned long key_rotations;
+    unsigned long early_served;         // Requests served from 0-RTT data
+    unsigned long early_too_early;      // Early requests answered 425
+    unsigned long reloads;              // Contexts swapped in by ssl_reload_start()
+    unsigned long reload_failures;      // Reloads rejected by validation
+};
+
 void init_openssl(void);
 void cleanup_openssl(void);
 SSL_CTX* create_ssl_context(void);
-void configure_ssl_context(SSL_CTX *ctx);
-SSL* accept_ssl_connection(SSL_CTX* ctx, int client_fd);
+int configure_ssl_context(SSL_CTX *ctx);
+
+// The context handed to new connections. Built and installed once at startup,
+// then replaced by ssl_reload_start(); connections keep the context they
+// were created with until they close.
+SSL_CTX* ssl_context_build(void);
+void ssl_context_install(SSL_CTX* ctx);
+SSL* ssl_context_new_connection(void);
+void ssl_context_shutdown(void);
+
+// Rebuilds the context from the configured certificate files on a
+// background thread. Returns -1 if a reload is already in progress.
+int ssl_reload_start(void);
+
+// Application data I/O that understands the TLS 1.3 early-data phase
+int ssl_read_data(SSL* ssl, int* in_early, void* buf, int len);
+int ssl_write_data(SSL* ssl, const void* buf, int len);
+
+void ssl_handshake_begin(SSL* ssl);
+void ssl_record_handshake(SSL* ssl, int ok);
+void ssl_record_early_request(int served);
+void ssl_get_stats(struct TlsStats* stats);
 
 #endif
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <pthread.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 // Forward declarations
 struct ThreadPool;
@@ -15,11 +16,20 @@ typedef void* (*work_func_t)(void* arg);
 struct ThreadPoolConfig {
     int num_threads;        // Number of worker threads
     int max_queue_size;     // Max pending work items (0 = unlimited)
+
+    // CoDel queue management (0 = disabled). Items that waited longer than
+    // target for a full interval start being shed at dequeue time.
+    uint32_t codel_target_us;
+    uint32_t codel_interval_us;
 };
 
 // Thread pool operations
 struct ThreadPool* threadpool_create(struct ThreadPoolConfig config);
 int threadpool_add_work(struct ThreadPool* pool, work_func_t func, void* arg);
+// Like threadpool_add_work(), but if CoDel sheds the item, shed(arg) runs
+// instead of func(arg) so the caller can answer cheaply and free arg.
+int threadpool_add_work_sheddable(struct ThreadPool* pool, work_func_t func,
+                                  work_func_t shed, void* arg);
 void threadpool_wait(struct ThreadPool* pool);
 void threadpool_destroy(struct ThreadPool* pool);
 
@@ -29,8 +39,21 @@ struct ThreadPoolStats {
     int queued_work;
     int completed_work;
     int rejected_work;
+    int shed_work;          // Items dropped by CoDel at dequeue
+    uint64_t avg_wait_us;   // EWMA of time spent queued
+    bool dropping;          // CoDel currently in dropping state
 };
 
 void threadpool_get_stats(struct ThreadPool* pool, struct ThreadPoolStats* stats);
 
+// Per-worker activity, for introspection
+struct ThreadPoolWorker {
+    int tid;                // Kernel thread id
+    bool busy;              // Running a work item
+    void* arg;              // Its argument while busy, else NULL
+    uint64_t since_us;      // Monotonic time it became busy or idle
+};
+
+int threadpool_worker_snapshot(struct ThreadPool* pool, struct ThreadPoolWorker* out, int max);
+
 #endif
\ No newline at end of file
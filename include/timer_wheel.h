@@ -0,0 +1,41 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stdint.h>
+
+// Which connection deadline a timer represents
+typedef enum {
+    TIMER_NONE = 0,
+    TIMER_IDLE,      // Keep-alive wait for the next request
+    TIMER_HEADER,    // Handshake + request line and headers
+    TIMER_BODY,      // Request body (POST)
+    TIMER_WRITE      // No send progress (write stall)
+} TimerKind;
+
+// Per-connection timer, embedded in the connection's own state.
+// All fields are owned by the wheel; use the functions below.
+typedef struct TimerEntry {
+    struct TimerEntry*  next;
+    struct TimerEntry** pprev;      // Slot link pointing at us, NULL if unarmed
+    uint64_t            expires;    // Absolute tick
+    TimerKind           kind;
+    TimerKind           fired;      // Kind that expired, TIMER_NONE otherwise
+    int                 fd;         // Socket shut down on expiry
+} TimerEntry;
+
+// Starts the wheel and its tick thread. tick_ms is the timer resolution.
+int  timer_wheel_init(unsigned tick_ms);
+void timer_wheel_shutdown(void);
+
+void timer_init(TimerEntry* timer, int fd);
+
+// (Re)arms the timer; O(1). Replaces any deadline already armed.
+void timer_arm(TimerEntry* timer, TimerKind kind, unsigned timeout_ms);
+
+// Disarms the timer; O(1). Returns the kind that already fired, if any,
+// and clears it so the entry can be reused.
+TimerKind timer_cancel(TimerEntry* timer);
+
+const char* timer_kind_name(TimerKind kind);
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,67 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Sampled request tracing (GET /api/admin/trace).
+ *
+ * On average one request in trace_sample_rate, plus any request sent
+ * with "X-Trace: 1", gets a trace id. Its spans go into a fixed ring
+ * shared by all workers, which the admin endpoint renders in the Chrome
+ * trace-event format (load it in chrome://tracing or ui.perfetto.dev).
+ * Requests that are not sampled pay one draw from a thread-local xorshift
+ * generator while trace_sample_rate is set, and a single branch otherwise.
+ */
+
+typedef enum {
+    TRACE_SPAN_REQUEST,         // Request read -> last bytes written (carries method/path/status)
+    TRACE_SPAN_QUEUE,           // Accepted -> picked up by a worker (first request)
+    TRACE_SPAN_HANDSHAKE,       // Picked up -> TLS handshake done (first request)
+    TRACE_SPAN_PARSE,           // Request read -> parsed
+    TRACE_SPAN_CACHE_LOOKUP,    // Cache index lookup
+    TRACE_SPAN_FILE_OPEN,       // open() of the requested file
+    TRACE_SPAN_FIRST_BYTE,      // Routed -> first response bytes written (handler time)
+    TRACE_SPAN_SEND,            // First bytes -> last bytes written
+    TRACE_SPAN_KINDS
+} TraceSpanKind;
+
+/**
+ * Allocates the span ring
+ *
+ * @param capacity Spans kept (oldest are overwritten); 0 disables tracing
+ * @param sample_rate Trace one request in this many (0 = only on request)
+ *
+ * @return 0 on success, -1 if the ring could not be allocated
+ */
+int  trace_init(int capacity, int sample_rate);
+void trace_shutdown(void);
+
+/**
+ * Decides whether the request about to be served is traced
+ *
+ * @param requested Nonzero if the client asked for a trace (X-Trace: 1)
+ *
+ * @return A new trace id, or 0 if the request is not traced
+ */
+uint64_t trace_sample(int requested);
+
+// Records one span of a traced request (times are monotonic_us())
+void trace_span(uint64_t trace_id, TraceSpanKind kind, uint64_t start_us, uint64_t end_us);
+
+// Records the request's root span, labelled "<method> <path>"
+void trace_request(uint64_t trace_id, uint64_t start_us, uint64_t end_us,
+                   const char* method, const char* path, int status);
+
+/**
+ * Renders the ring, oldest span first, as Chrome trace-event JSON
+ *
+ * @return Heap-allocated JSON (caller frees), or NULL if memory ran out
+ */
+char* trace_render(void);
+
+// Empties the ring
+void trace_clear(void);
+
+#endif // TRACE_H
@@ -6,10 +6,12 @@
 #include <arpa/inet.h>
 #include <openssl/ssl.h>
 
+#include "timer_wheel.h"
+
 // Server constants
 #define HTTP_PORT 80
 #define HTTPS_PORT 443
-#define BACKLOG 20
+#define BACKLOG 511   // default listen() backlog; see listen_backlog in server.conf
 /* SERVER_PATH is injected at compile time via -DSERVER_PATH=... in the Makefile */
 #ifndef SERVER_PATH
 #error "SERVER_PATH must be defined by the build system (see Makefile)"
@@ -23,6 +25,8 @@
 
 // Forward declarations
 struct Node;
+struct Connection;
+struct FdCacheEntry;
 
 // Client request structure
 typedef struct Client {
@@ -33,6 +37,7 @@ typedef struct Client {
     
     // File handling
     int fd;                  // File descriptor for requested file
+    struct FdCacheEntry* file;   // Open-file cache entry owning fd (NULL if opened directly)
     char* full_path;         // Full path to file
     
     // HTTP request line
@@ -42,6 +47,7 @@ typedef struct Client {
     
     // HTTP headers
     char* host;
+    struct VirtualHost* vhost;   // Selected from host (NULL until parsed)
     char* user_agent;
     char* referer;
     char* accept;
@@ -55,6 +61,7 @@ typedef struct Client {
     
     // Connection management
     int connection_status;   // 0=close, 1=keep-alive
+    int status;              // Status code of the response sent (0 = none yet)
     
     // Range requests
     int range;               // 0=no range, 1=range request
@@ -70,29 +77,160 @@ typedef struct Client {
     char* body;              // Body of Client Request
     long  content_length;    // Value of Content-Length header (-1 = not set)
     char* session_token;     // Value of "session" cookie (if present)
+    int   trace_requested;   // "X-Trace: 1" asks for this request to be traced
 
     // SSL
     int is_ssl;
     SSL* ssl;
+
+    // Owning connection (deadline timer, byte counters); NULL if standalone
+    struct Connection* conn;
 } Client;
 
-// Thread arguments for worker threads
-typedef struct ThreadArgs {
+// What a connection is doing right now (for introspection)
+typedef enum {
+    CONN_FREE = 0,
+    CONN_QUEUED,         // Accepted, waiting for a worker
+    CONN_HANDSHAKE,      // TLS handshake in progress
+    CONN_IDLE,           // Keep-alive, waiting for the next request
+    CONN_READING,        // Receiving request headers/body
+    CONN_PROCESSING,     // Routing, file lookup, API handlers
+    CONN_HASHING,        // Waiting on the crypto pool for a password hash
+    CONN_WRITING         // Sending the response
+} ConnState;
+
+// Per-connection state, one slot per fd in the connection table.
+// Slots (and their read buffers) are reused for the life of the process.
+typedef struct Connection {
     int client_fd;
     SSL* ssl;
     char client_ip[INET6_ADDRSTRLEN];  // resolved at accept() for both IPv4 and IPv6
     int  client_port;
-} ThreadArgs;
+    TimerEntry timer;                  // idle/header/body/write deadline
+
+    // Request parsing
+    char*  read_buf;                   // MAX_REQUEST_SIZE + MAX_BODY_SIZE + 1, allocated once
+    size_t buffered;                   // Bytes held in read_buf (pipelined carry-over)
+    Client client;                     // Current request, reset between requests
+
+    // Statistics
+    int tls_early;                     // Handshake pending, reading 0-RTT data
+
+    ConnState state;
+    uint64_t  accepted_us;             // Monotonic accept time
+    uint64_t  bytes_in;
+    uint64_t  bytes_out;
+    uint32_t  requests;
+    uint64_t  request_start_us;        // Monotonic time the current request was read
+    uint64_t  request_bytes_out;       // bytes_out when it was read
+    uint64_t  response_total;          // Bytes the response will take (0 = unknown)
+    int       worker_tid;              // Thread serving the connection (0 = queued)
+    char      request_line[96];        // "<method> <path>" of the current/last request
+
+    // Phase timestamps for the latency histograms (monotonic us, 0 = not
+    // reached). dequeued/handshake belong to the first request only.
+    uint64_t  dequeued_us;             // A worker picked the connection up
+    uint64_t  handshake_us;            // TLS handshake completed
+    uint64_t  parsed_us;               // Request parsed, virtual host selected
+    uint64_t  routed_us;               // Handler chosen and its file opened
+    uint64_t  first_byte_us;           // First response bytes written
+
+    uint64_t  trace_id;                // Nonzero while the current request is traced
+} Connection;
+
+// Extra virtual hosts ("vhost" lines in the config file)
+#define MAX_VHOSTS 16
+
+typedef struct {
+    char* name;                  // Host header / SNI name, matched case-insensitively
+    char* webroot;               // Files served from <webroot>/public
+    char* cert_path;             // Certificate for SNI (NULL = default certificate)
+    char* key_path;
+    int   cache_budget_kb;       // Cache index budget (0 = unlimited)
+} VhostConfig;
 
 // Server configuration
 typedef struct ServerConfig {
     char* webroot;
     int http_port;
     int https_port;
-    char* cert_path;
+    char* cert_path;             // RSA certificate (empty = none)
     char* key_path;
+    char* ecdsa_cert_path;       // Optional ECDSA certificate, served when supported
+    char* ecdsa_key_path;
+    char* db_path;               // SQLite user database
     int thread_pool_size;
     int max_queue_size;
+
+    // Password hashing pool (Argon2id runs here, never on request workers)
+    int crypto_pool_size;
+    int crypto_queue_size;
+
+    // Seconds advertised in Retry-After when a request is shed with 503
+    int retry_after;
+
+    // Overload control
+    int listen_backlog;
+    int codel_target_ms;     // 0 disables CoDel shedding
+    int codel_interval_ms;
+
+    // Connection deadlines in seconds (enforced by the timer wheel)
+    int keepalive_timeout;       // Idle wait between keep-alive requests
+    int keepalive_timeout_busy;  // Idle wait while connections are queued
+    int header_timeout;          // Handshake + full request headers
+    int body_timeout;            // Full request body
+    int write_timeout;           // Longest time without send progress
+
+    // Slots in the fd-indexed connection table (capped by RLIMIT_NOFILE)
+    int max_connections;
+
+    // "blocking" or "io_uring" (falls back to blocking if unavailable)
+    char* io_engine;
+
+    // TLS session resumption
+    int tls_session_cache_size;  // Sessions in the server-side cache (0 = off)
+    int tls_session_timeout;     // Session/ticket lifetime in seconds
+    int tls_ticket_rotation;     // Ticket key rotation period in seconds (0 = no tickets)
+    int tls_early_data;          // Max TLS 1.3 0-RTT bytes (0 = off)
+    int tls_mmap;                // Send cached files over TLS from shared mappings
+
+    // Cipher/group preference overrides (NULL = built-in defaults)
+    char* tls_ciphers;           // TLS 1.2 cipher list
+    char* tls_ciphersuites;      // TLS 1.3 suites
+    char* tls_groups;            // Key exchange groups
+
+    // Binary access log (empty path = off)
+    char* access_log;
+    int   access_log_size_mb;    // Rotated at this size
+
+    // Asynchronous logging
+    int   log_ring_size;         // Lines buffered per thread (rounded up to a power of two)
+    char* log_overflow;          // "drop" (default) or "block" when a thread's buffer is full
+    char* log_level;             // debug, info (default), warn or error
+    int   log_max_size_mb;       // Rotate server.log at this size (0 = never)
+    int   log_rotate_hours;      // Rotate at least this often (0 = never)
+    int   log_keep;              // Rotated files kept (0 = all)
+    int   log_compress;          // gzip rotated files in the background
+
+    // Sampled request tracing
+    int   trace_buffer;          // Spans kept for /api/admin/trace (0 = tracing off)
+    int   trace_sample_rate;     // Trace one request in this many (0 = X-Trace header only)
+
+    // Open file descriptor cache
+    int   fd_cache_size;         // Files kept open (0 = open per request)
+    int   fd_cache_valid;        // Seconds before a cached file is re-checked with stat()
+
+    // Background read-ahead
+    int   prefetch_window_kb;    // Read-ahead window for sends of 1 MB or more (0 = off)
+    int   prefetch_warm_mb;      // Leading MB of each video pre-warmed at startup/refresh
+
+    // MP4 faststart views
+    int   mp4_faststart_max_kb;  // Largest moov held in memory per file (0 = serve files as is)
+
+    // Virtual hosting. Requests for unknown hosts go to webroot above.
+    int cache_budget_kb;         // Cache index budget of the default host (0 = unlimited)
+    VhostConfig vhosts[MAX_VHOSTS];
+    int vhost_count;
 } ServerConfig;
 
 #endif // TYPES_H
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <time.h>
 #include <stddef.h>
+#include <stdint.h>
 
 #include "types.h"
 
@@ -22,4 +23,35 @@ char* get_query_param(Client* client, const char* key);
  */
 void url_decode(char* dst, const char* src, size_t dst_size);
 
+/**
+ * Current CLOCK_MONOTONIC time in microseconds.
+ * Use for durations and ages; never for wall-clock dates.
+ */
+uint64_t monotonic_us(void);
+
+/**
+ * Kernel thread id of the calling thread (as shown by top -H and perf),
+ * cached after the first call.
+ */
+int current_tid(void);
+
+// Growable text buffer for rendering API responses
+typedef struct {
+    char*  data;
+    size_t len;
+    size_t cap;
+    int    failed;              // An allocation or format error happened; data is incomplete
+} TextBuffer;
+
+/**
+ * Appends printf-formatted text, growing the buffer as needed.
+ * After a failure, further appends are ignored and buf->failed stays set.
+ */
+void text_append(TextBuffer* buf, const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * Appends s as the contents of a JSON string (no surrounding quotes).
+ */
+void text_append_json(TextBuffer* buf, const char* s);
+
 #endif 
\ No newline at end of file
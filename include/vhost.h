@@ -0,0 +1,40 @@
+#ifndef VHOST_H
+#define VHOST_H
+
+#include "types.h"
+#include "error_pages.h"
+
+#include <pthread.h>
+
+struct MediaIndex;
+
+// A site served by this process: the default host (g_config.webroot) plus
+// one per "vhost" line. Each has its own cache index and error pages.
+typedef struct VirtualHost {
+    const char*      name;          // NULL for the default host
+    const char*      webroot;
+    size_t           cache_budget;  // Bytes, 0 = unlimited
+    size_t           cache_used;
+    struct Node*     cache_tree;
+    struct MediaIndex* media;       // /api/videos catalog, rebuilt with cache_tree
+    pthread_rwlock_t cache_lock;    // Readers = workers, writer = refresh
+    ErrorPages*      error_pages;
+} VirtualHost;
+
+// Builds the default host and every configured virtual host
+int  vhost_init(void);
+void vhost_shutdown(void);
+
+// Host for a Host header or SNI name (port and trailing dot ignored).
+// Falls back to the default host, so the result is never NULL.
+VirtualHost* vhost_lookup(const char* host);
+VirtualHost* vhost_default(void);
+
+// Rebuilds every host's cache index (SIGUSR1)
+void vhost_refresh_caches(void);
+
+// Calls visit on every file in every host's cache index, under that
+// host's read lock
+void vhost_walk_files(void (*visit)(const struct Node*, void*), void* arg);
+
+#endif // VHOST_H
@@ -1,13 +1,28 @@
 #include "api.h"
 #include "session.h"
+#include "ssl_handler.h"
+#include "vhost.h"
+#include "logger.h"
+#include "metrics.h"
+#include "trace.h"
+#include "introspect.h"
+#include "media_index.h"
 
 ApiRoute api_routes[] = {
     { "/api/status", handle_api_status },
     { "/api/info", handle_api_info },
     { "/api/files",  handle_api_files },
+    { "/api/videos", handle_api_videos },
     { "/api/config", handle_api_config },
     { "/api/time", handle_api_time },
     { "/api/logout", handle_api_logout },
+    { "/api/tls", handle_api_tls },
+    { "/api/metrics", handle_api_metrics },
+    { "/api/latency", handle_api_latency },
+    { "/api/admin/log-level", handle_api_admin_log_level },
+    { "/api/admin/trace", handle_api_admin_trace },
+    { "/api/admin/connections", handle_api_admin_connections },
+    { "/api/admin/workers", handle_api_admin_workers },
     { NULL, NULL }
 };
 
@@ -69,8 +84,7 @@ void handle_api_files(Client* client) {
     const char* effective_path = path ? path : "/";
 
     char full_path[512];
-    extern ServerConfig g_config;
-    snprintf(full_path, sizeof(full_path), "%s/public/%s", g_config.webroot, effective_path);
+    snprintf(full_path, sizeof(full_path), "%s/public/%s", client->vhost->webroot, effective_path);
 
     DIR* dir = opendir(full_path);
     if (!dir) {
@@ -190,6 +204,234 @@ void handle_api_logout(Client* client)
     send_login_redirect("/login.html", "", 0, client);
 }
 
+void handle_api_tls(Client* client)
+{
+    struct TlsStats stats;
+    ssl_get_stats(&stats);
+
+    unsigned long handshakes = stats.full_handshakes + stats.resumed_handshakes;
+    double resumption_rate = handshakes ? (double)stats.resumed_handshakes / handshakes : 0.0;
+
+    char response[1024];
+    snprintf(response, sizeof(response),
+        "{\n"
+        "  \"success\": true,\n"
+        "  \"data\": {\n"
+        "    \"handshakes\": {\"full\": %lu, \"resumed\": %lu, \"failed\": %lu, "
+        "\"resumption_rate\": %.3f},\n"
+        "    \"session_cache\": {\"entries\": %ld, \"hits\": %ld, \"misses\": %ld, "
+        "\"timeouts\": %ld, \"evictions\": %ld},\n"
+        "    \"tickets\": {\"issued\": %lu, \"accepted\": %lu, \"renewed\": %lu, "
+        "\"rejected\": %lu, \"key_rotations\": %lu},\n"
+        "    \"early_data\": {\"served\": %lu, \"too_early\": %lu},\n"
+        "    \"reloads\": {\"completed\": %lu, \"failed\": %lu}\n"
+        "  }\n"
+        "}",
+        stats.full_handshakes, stats.resumed_handshakes, stats.failed_handshakes,
+        resumption_rate,
+        stats.cache_entries, stats.cache_hits, stats.cache_misses,
+        stats.cache_timeouts, stats.cache_full,
+        stats.tickets_issued, stats.tickets_accepted, stats.tickets_renewed,
+        stats.tickets_rejected, stats.key_rotations,
+        stats.early_served, stats.early_too_early,
+        stats.reloads, stats.reload_failures
+    );
+
+    send_api_response(client, 200, "application/json", response);
+}
+
+/**
+ * Exports the server metrics in the Prometheus text format
+ *
+ * Scrape with a job whose metrics_path is /api/metrics.
+ */
+void handle_api_metrics(Client* client)
+{
+    char* text = metrics_render(NULL);
+    if (!text) {
+        send_api_error(client, 500, "INTERNAL_ERROR", "Could not render metrics");
+        return;
+    }
+
+    send_api_response(client, 200, "text/plain; version=0.0.4; charset=utf-8", text);
+    free(text);
+}
+
+/**
+ * Reports latency percentiles per route class and request phase
+ *
+ * ?route=static|api|post limits the output to one route class.
+ */
+void handle_api_latency(Client* client)
+{
+    char* route = get_query_param(client, "route");
+    char* json = metrics_render_latency(route);
+    free(route);
+
+    if (!json) {
+        send_api_error(client, 400, "BAD_ROUTE", "route must be static, api or post");
+        return;
+    }
+
+    send_api_response(client, 200, "application/json", json);
+    free(json);
+}
+
+/**
+ * Admin endpoints are reachable from the local machine only
+ *
+ * @param client Requesting client
+ *
+ * @return 1 if the request may proceed, 0 if a 403 was sent
+ */
+int api_require_admin(Client* client)
+{
+    const char* ip = client->client_ip ? client->client_ip : "";
+    if (strncmp(ip, "127.", 4) == 0 || strcmp(ip, "::1") == 0) return 1;
+
+    log_message(LOG_WARN, "Admin request from %s refused", ip);
+    send_api_error(client, 403, "FORBIDDEN", "Admin API is only available from localhost");
+    return 0;
+}
+
+/**
+ * Reports the log level, or changes it with ?level=debug|info|warn|error
+ *
+ * The change applies to all threads immediately.
+ */
+void handle_api_admin_log_level(Client* client)
+{
+    if (!api_require_admin(client)) return;
+
+    char* level = get_query_param(client, "level");
+    if (level) {
+        int parsed = log_level_parse(level);
+        if (parsed < 0) {
+            free(level);
+            send_api_error(client, 400, "BAD_LEVEL", "level must be debug, info, warn or error");
+            return;
+        }
+        log_set_level((LogLevel)parsed);
+        log_message(LOG_WARN, "Log level set to %s from %s", log_level_name((LogLevel)parsed),
+                    client->client_ip);
+        free(level);
+    }
+
+    char response[128];
+    snprintf(response, sizeof(response),
+        "{\"success\": true, \"data\": {\"level\": \"%s\"}}",
+        log_level_name((LogLevel)__atomic_load_n(&g_log_level, __ATOMIC_RELAXED)));
+    send_api_response(client, 200, "application/json", response);
+}
+
+/**
+ * Dumps the sampled request spans as Chrome trace-event JSON
+ *
+ * ?clear=1 empties the ring once it has been rendered.
+ */
+void handle_api_admin_trace(Client* client)
+{
+    if (!api_require_admin(client)) return;
+
+    char* json = trace_render();
+    if (!json) {
+        send_api_error(client, 500, "INTERNAL_ERROR", "Could not render trace");
+        return;
+    }
+
+    char* clear = get_query_param(client, "clear");
+    if (clear && strcmp(clear, "1") == 0) trace_clear();
+    free(clear);
+
+    send_api_response(client, 200, "application/json", json);
+    free(json);
+}
+
+/**
+ * Lists every open connection: peer, TLS, age, requests served, state,
+ * bytes in/out, and the progress of the response being sent
+ */
+void handle_api_admin_connections(Client* client)
+{
+    if (!api_require_admin(client)) return;
+
+    char* json = introspect_render_connections();
+    if (!json) {
+        send_api_error(client, 500, "INTERNAL_ERROR", "Could not list connections");
+        return;
+    }
+
+    send_api_response(client, 200, "application/json", json);
+    free(json);
+}
+
+/**
+ * Shows what each request worker is doing and for how long, with the
+ * connection it is serving
+ */
+void handle_api_admin_workers(Client* client)
+{
+    if (!api_require_admin(client)) return;
+
+    char* json = introspect_render_workers();
+    if (!json) {
+        send_api_error(client, 500, "INTERNAL_ERROR", "Could not list workers");
+        return;
+    }
+
+    send_api_response(client, 200, "application/json", json);
+    free(json);
+}
+
+// Parses a positive integer query parameter, clamped to [1, max]
+static size_t query_count(Client* client, const char* key, size_t fallback, size_t max)
+{
+    char* value = get_query_param(client, key);
+    size_t n = fallback;
+    if (value) {
+        long parsed = strtol(value, NULL, 10);
+        n = parsed > 0 ? (size_t)parsed : 1;
+        free(value);
+    }
+    return n > max ? max : n;
+}
+
+/**
+ * Pages through the media under public/videos: path, size, duration,
+ * MIME type, ETag and poster of each file
+ *
+ * Query: page (1-based, default 1) and per_page (default 50, at most 500).
+ * Served from the host's media catalog, which is rebuilt together with the
+ * cache index, so a request costs no filesystem access.
+ */
+void handle_api_videos(Client* client)
+{
+    size_t per_page = query_count(client, "per_page", 50, 500);
+    size_t page = query_count(client, "page", 1, 1000000);
+
+    TextBuffer buf = { .data = malloc(4096), .len = 0, .cap = 4096 };
+    if (!buf.data) {
+        send_api_error(client, 500, "INTERNAL_ERROR", "Could not render the video catalog");
+        return;
+    }
+    text_append(&buf, "{\"success\": true, \"data\": ");
+
+    VirtualHost* vh = client->vhost;
+    pthread_rwlock_rdlock(&vh->cache_lock);
+    media_index_render(vh->media, &buf, page, per_page);
+    pthread_rwlock_unlock(&vh->cache_lock);
+
+    text_append(&buf, "}\n");
+    if (buf.failed) {
+        free(buf.data);
+        send_api_error(client, 500, "INTERNAL_ERROR", "Could not render the video catalog");
+        return;
+    }
+
+    send_api_response(client, 200, "application/json", buf.data);
+    free(buf.data);
+}
+
 void send_api_error(Client* client, int status_code, const char* error_code, const char* message) {
     char response[512];
     snprintf(response, sizeof(response),
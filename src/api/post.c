@@ -1,6 +1,8 @@
 #include "post.h"
 #include "session.h"
 #include "utils.h"
+#include "crypto_pool.h"
+#include "config.h"
 #include <pthread.h>
 
 // External reference to the global database connection (defined in main.c)
@@ -13,7 +15,8 @@ int init_database(sqlite3** db)
     int rc;
     char* err_msg = 0;
     
-    rc = sqlite3_open(SERVER_PATH "/var/db/users.db", db);
+    extern struct ServerConfig g_config;
+    rc = sqlite3_open(g_config.db_path, db);
     
     if (rc != SQLITE_OK) {
         fprintf(stderr, "Cannot open database: %s\n", sqlite3_errmsg(*db));
@@ -73,15 +76,38 @@ int verify_password(const char* hashed, const char* password)
     return 0;
 }
 
+// Arguments for a password job executed on the crypto pool
+typedef struct PasswordJob {
+    const char* password;
+    const char* hashed;      // stored hash to verify against
+    char* hashed_output;     // destination for a new hash
+} PasswordJob;
+
+static int hash_password_job(void* arg)
+{
+    PasswordJob* job = (PasswordJob*)arg;
+    return hash_password(job->password, job->hashed_output);
+}
+
+static int verify_password_job(void* arg)
+{
+    PasswordJob* job = (PasswordJob*)arg;
+    return verify_password(job->hashed, job->password);
+}
+
 // Function to check if username and password match a record in database
+// Returns: 1 on match, 0 otherwise, CRYPTO_BUSY if the crypto pool is saturated
 int verify_user(sqlite3* db, const char* username, const char* password)
 {
     sqlite3_stmt* stmt;
     int rc;
-    int result = 0;
-    
+    int found = 0;
+    char stored_hash[crypto_pwhash_STRBYTES];
+
     const char* sql = "SELECT password_hash FROM users WHERE username = ?;";
 
+    /* Only the lookup runs under g_db_mutex; the hash check below takes
+     * tens of milliseconds and must not serialize every other login. */
     pthread_mutex_lock(&g_db_mutex);
     rc = sqlite3_prepare_v2(db, sql, -1, &stmt, 0);
 
@@ -96,16 +122,25 @@ int verify_user(sqlite3* db, const char* username, const char* password)
     rc = sqlite3_step(stmt);
 
     if (rc == SQLITE_ROW) {
-        const unsigned char* stored_hash = sqlite3_column_text(stmt, 0);
-        result = verify_password((const char*)stored_hash, password);
+        const unsigned char* hash = sqlite3_column_text(stmt, 0);
+        if (hash) {
+            strncpy(stored_hash, (const char*)hash, sizeof(stored_hash) - 1);
+            stored_hash[sizeof(stored_hash) - 1] = '\0';
+            found = 1;
+        }
     }
 
     sqlite3_finalize(stmt);
     pthread_mutex_unlock(&g_db_mutex);
-    return result;
+
+    if (!found) return 0;
+
+    PasswordJob job = { .password = password, .hashed = stored_hash };
+    return crypto_pool_run(verify_password_job, &job);
 }
 
 // Function to add a new user to the database
+// Returns: SQLITE_OK, an SQLite error code, -1 on hash failure, or CRYPTO_BUSY
 int add_user(sqlite3* db, const char* username, const char* password)
 {
     sqlite3_stmt* stmt;
@@ -113,7 +148,12 @@ int add_user(sqlite3* db, const char* username, const char* password)
     
     char hashed_password[crypto_pwhash_STRBYTES];
     
-    if (hash_password(password, hashed_password) != 0) {
+    PasswordJob job = { .password = password, .hashed_output = hashed_password };
+    rc = crypto_pool_run(hash_password_job, &job);
+    if (rc == CRYPTO_BUSY) {
+        return CRYPTO_BUSY;
+    }
+    if (rc != 0) {
         fprintf(stderr, "Failed to hash password\n");
         return -1;
     }
@@ -245,7 +285,18 @@ void handle_registration(sqlite3* db, Client* client)
         return;
     }
     
+    if (client->conn) client->conn->state = CONN_HASHING;
     int result = add_user(db, creds->username, creds->password);
+    if (client->conn) client->conn->state = CONN_PROCESSING;
+
+    if (result == CRYPTO_BUSY) {
+        log_message(LOG_WARN, "Registration shed, crypto pool saturated: %s", creds->username);
+        send_unavailable_response(g_config.retry_after, client);
+        free(creds->username);
+        free(creds->password);
+        free(creds);
+        return;
+    }
 
     log_message(LOG_INFO, "New user created: %s", creds->username);
     
@@ -282,7 +333,14 @@ void handle_login(sqlite3* db, Client* client)
         return;
     }
     
-    if (verify_user(db, creds->username, creds->password)) {
+    if (client->conn) client->conn->state = CONN_HASHING;
+    int verified = verify_user(db, creds->username, creds->password);
+    if (client->conn) client->conn->state = CONN_PROCESSING;
+
+    if (verified == CRYPTO_BUSY) {
+        log_message(LOG_WARN, "Login shed, crypto pool saturated: %s", creds->username);
+        send_unavailable_response(g_config.retry_after, client);
+    } else if (verified) {
         log_message(LOG_INFO, "Successful user login: %s", creds->username);
 
         char* token = session_create(creds->username);
@@ -43,12 +43,14 @@ unsigned int cache_hash_path(const char* path) {
  * Calls the init_tree() in the node file.
  *
  * @param root_dir root directory of all files returned by the server.
+ * @param budget Bytes the index may use (0 = unlimited)
+ * @param used Set to the bytes the index uses (may be NULL)
  *
  * @return Head of the new tree contructed.
  */
-struct Node* cache_tree_init(const char* root_dir) {
+struct Node* cache_tree_init(const char* root_dir, size_t budget, size_t* used) {
     log_message(LOG_INFO, "Initializing cache tree for: %s", root_dir);
-    return init_tree();
+    return init_tree(root_dir, budget, used);
 }
 
 /**
@@ -66,12 +68,14 @@ void cache_tree_free(struct Node* tree_head) {
  * If a file updates, refreshing the tree updates cache info.
  *
  * @param tree_head Tree head of the BST.
- * @param tree_head root directory of all files returned by the server.
+ * @param root_dir root directory of all files returned by the server.
+ * @param budget Bytes the index may use (0 = unlimited)
+ * @param used Set to the bytes the index uses (may be NULL)
  */
-void cache_tree_refresh(struct Node** tree_head, const char* root_dir) {
+void cache_tree_refresh(struct Node** tree_head, const char* root_dir, size_t budget, size_t* used) {
     if (!tree_head) return;
     
     log_message(LOG_INFO, "Refreshing cache tree");
     cache_tree_free(*tree_head);
-    *tree_head = cache_tree_init(root_dir);
+    *tree_head = cache_tree_init(root_dir, budget, used);
 }
\ No newline at end of file
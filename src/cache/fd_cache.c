@@ -0,0 +1,308 @@
+#include "fd_cache.h"
+#include "logger.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+// Descriptors kept free for listeners, logs, eventfds and the like
+#define FD_CACHE_HEADROOM 64
+
+/* One lock covers the table, the LRU list and the refcounts. It is held
+ * for a bucket walk and a few pointer updates; open(), fstat() and close()
+ * always happen outside it. */
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static FdCacheEntry**  g_buckets = NULL;
+static uint32_t        g_bucket_mask = 0;
+static int             g_capacity = 0;
+static int             g_count = 0;
+static int             g_valid_seconds = 0;
+static FdCacheEntry*   g_lru_head = NULL;   // Most recently used
+static FdCacheEntry*   g_lru_tail = NULL;
+
+static uint64_t g_hits = 0;
+static uint64_t g_misses = 0;
+
+static uint32_t hash_path(const char* path) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*)path; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static time_t now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+static int same_file(const struct stat* a, const struct stat* b) {
+    return a->st_dev == b->st_dev && a->st_ino == b->st_ino && a->st_size == b->st_size &&
+           a->st_mtim.tv_sec == b->st_mtim.tv_sec && a->st_mtim.tv_nsec == b->st_mtim.tv_nsec;
+}
+
+static void entry_destroy(FdCacheEntry* entry) {
+    close(entry->fd);
+    free(entry->path);
+    free(entry);
+}
+
+static void lru_unlink(FdCacheEntry* entry) {
+    if (entry->lru_prev) entry->lru_prev->lru_next = entry->lru_next;
+    else g_lru_head = entry->lru_next;
+    if (entry->lru_next) entry->lru_next->lru_prev = entry->lru_prev;
+    else g_lru_tail = entry->lru_prev;
+    entry->lru_prev = entry->lru_next = NULL;
+}
+
+static void lru_push_front(FdCacheEntry* entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = g_lru_head;
+    if (g_lru_head) g_lru_head->lru_prev = entry;
+    g_lru_head = entry;
+    if (!g_lru_tail) g_lru_tail = entry;
+}
+
+/* Takes the entry out of the table (lock held). Returns nonzero if that
+ * dropped the last reference, in which case the caller destroys it after
+ * unlocking. */
+static int unlink_entry(FdCacheEntry* entry) {
+    FdCacheEntry** link = &g_buckets[entry->hash & g_bucket_mask];
+    while (*link && *link != entry) link = &(*link)->chain;
+    if (*link) *link = entry->chain;
+
+    lru_unlink(entry);
+    entry->cached = 0;
+    g_count--;
+    return --entry->refs == 0;
+}
+
+static FdCacheEntry* find_entry(const char* path, uint32_t hash) {
+    for (FdCacheEntry* e = g_buckets[hash & g_bucket_mask]; e; e = e->chain) {
+        if (e->hash == hash && strcmp(e->path, path) == 0) return e;
+    }
+    return NULL;
+}
+
+/* Fits capacity into RLIMIT_NOFILE: connections and the headroom come
+ * first, and the cache takes at most half of what is left, since senders
+ * hold files evicted from the cache on top of it. The soft limit is raised
+ * towards the hard one if it is too low for that. */
+static int fit_rlimit(int capacity, int connections) {
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) < 0 || rl.rlim_cur == RLIM_INFINITY) return capacity;
+
+    rlim_t reserved = (rlim_t)connections + FD_CACHE_HEADROOM;
+    rlim_t wanted = reserved + 2 * (rlim_t)capacity;
+    if (rl.rlim_cur < wanted && rl.rlim_max > rl.rlim_cur) {
+        struct rlimit raised = rl;
+        raised.rlim_cur = rl.rlim_max < wanted ? rl.rlim_max : wanted;
+        if (setrlimit(RLIMIT_NOFILE, &raised) == 0) rl.rlim_cur = raised.rlim_cur;
+    }
+
+    rlim_t spare = rl.rlim_cur > reserved ? (rl.rlim_cur - reserved) / 2 : 0;
+    if (spare < (rlim_t)capacity) {
+        log_message(LOG_WARN, "fd cache limited to %d of %d files by RLIMIT_NOFILE (%lu)",
+                    (int)spare, capacity, (unsigned long)rl.rlim_cur);
+        capacity = (int)spare;
+    }
+    return capacity;
+}
+
+int fd_cache_init(int capacity, int connections, int valid_seconds) {
+    g_valid_seconds = valid_seconds > 0 ? valid_seconds : 0;
+    if (capacity <= 0) return 0;
+
+    capacity = fit_rlimit(capacity, connections);
+    if (capacity <= 0) return 0;
+
+    uint32_t buckets = 16;
+    while (buckets < (uint32_t)capacity * 2) buckets <<= 1;
+
+    g_buckets = calloc(buckets, sizeof(FdCacheEntry*));
+    if (!g_buckets) {
+        log_message(LOG_ERROR, "Failed to allocate fd cache (%d entries)", capacity);
+        return -1;
+    }
+    g_bucket_mask = buckets - 1;
+    g_capacity = capacity;
+    return 0;
+}
+
+void fd_cache_shutdown(void) {
+    fd_cache_invalidate();
+
+    pthread_mutex_lock(&g_lock);
+    free(g_buckets);
+    g_buckets = NULL;
+    g_capacity = 0;
+    pthread_mutex_unlock(&g_lock);
+}
+
+// Opens path into a new entry holding one reference
+static FdCacheEntry* open_entry(const char* path, uint32_t hash) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return NULL;
+
+    FdCacheEntry* entry = calloc(1, sizeof(FdCacheEntry));
+    if (!entry || !(entry->path = strdup(path))) {
+        free(entry);
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+    entry->fd = fd;
+
+    if (fstat(fd, &entry->st) < 0) {
+        int saved = errno;
+        entry_destroy(entry);
+        errno = saved;
+        return NULL;
+    }
+
+    entry->hash = hash;
+    entry->refs = 1;
+    entry->validated = now_seconds();
+    return entry;
+}
+
+FdCacheEntry* fd_cache_open(const char* path) {
+    uint32_t hash = hash_path(path);
+
+    pthread_mutex_lock(&g_lock);
+    if (!g_buckets) {
+        pthread_mutex_unlock(&g_lock);
+        return open_entry(path, hash);
+    }
+
+    FdCacheEntry* entry = find_entry(path, hash);
+    if (entry && (!g_valid_seconds || now_seconds() - entry->validated < g_valid_seconds)) {
+        entry->refs++;
+        lru_unlink(entry);
+        lru_push_front(entry);
+        g_hits++;
+        pthread_mutex_unlock(&g_lock);
+        return entry;
+    }
+    if (entry) {
+        // Old enough to re-check; hold it so it survives the unlocked stat()
+        entry->refs++;
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    if (entry) {
+        struct stat st;
+        int unchanged = stat(path, &st) == 0 && same_file(&st, &entry->st);
+
+        pthread_mutex_lock(&g_lock);
+        if (unchanged) {
+            entry->validated = now_seconds();
+            if (entry->cached) {
+                lru_unlink(entry);
+                lru_push_front(entry);
+            }
+            g_hits++;
+            pthread_mutex_unlock(&g_lock);
+            return entry;
+        }
+        if (entry->cached) unlink_entry(entry);     // Never the last: we hold one
+        int last = --entry->refs == 0;
+        pthread_mutex_unlock(&g_lock);
+        if (last) entry_destroy(entry);
+    }
+
+    FdCacheEntry* fresh = open_entry(path, hash);
+    if (!fresh) return NULL;
+
+    FdCacheEntry* dropped[2] = { NULL, NULL };
+
+    pthread_mutex_lock(&g_lock);
+    g_misses++;
+    if (!g_buckets) {
+        pthread_mutex_unlock(&g_lock);
+        return fresh;
+    }
+
+    entry = find_entry(path, hash);
+    if (entry && same_file(&entry->st, &fresh->st)) {
+        // Another worker cached the same file meanwhile; use theirs
+        entry->refs++;
+        pthread_mutex_unlock(&g_lock);
+        entry_destroy(fresh);
+        return entry;
+    }
+    if (entry && unlink_entry(entry)) dropped[0] = entry;
+
+    if (g_count >= g_capacity) {
+        // The least recently used file closes once no sender holds it
+        FdCacheEntry* victim = g_lru_tail;
+        if (victim && unlink_entry(victim)) dropped[1] = victim;
+    }
+
+    FdCacheEntry** bucket = &g_buckets[hash & g_bucket_mask];
+    fresh->chain = *bucket;
+    *bucket = fresh;
+    lru_push_front(fresh);
+    fresh->cached = 1;
+    fresh->refs++;              // The cache's own reference
+    g_count++;
+    pthread_mutex_unlock(&g_lock);
+
+    for (int i = 0; i < 2; i++) {
+        if (dropped[i]) entry_destroy(dropped[i]);
+    }
+    return fresh;
+}
+
+void fd_cache_release(FdCacheEntry* entry) {
+    if (!entry) return;
+
+    pthread_mutex_lock(&g_lock);
+    int last = --entry->refs == 0;
+    pthread_mutex_unlock(&g_lock);
+
+    if (last) entry_destroy(entry);
+}
+
+void fd_cache_retain(FdCacheEntry* entry) {
+    pthread_mutex_lock(&g_lock);
+    entry->refs++;
+    pthread_mutex_unlock(&g_lock);
+}
+
+void fd_cache_invalidate(void) {
+    FdCacheEntry* unused = NULL;
+    int dropped = 0;
+
+    pthread_mutex_lock(&g_lock);
+    while (g_lru_head) {
+        FdCacheEntry* entry = g_lru_head;
+        dropped++;
+        if (unlink_entry(entry)) {
+            entry->chain = unused;
+            unused = entry;
+        }
+    }
+    pthread_mutex_unlock(&g_lock);
+
+    while (unused) {
+        FdCacheEntry* next = unused->chain;
+        entry_destroy(unused);
+        unused = next;
+    }
+    if (dropped) log_message(LOG_DEBUG, "fd cache: dropped %d open files", dropped);
+}
+
+void fd_cache_get_stats(struct FdCacheStats* stats) {
+    pthread_mutex_lock(&g_lock);
+    stats->hits = g_hits;
+    stats->misses = g_misses;
+    stats->entries = g_count;
+    pthread_mutex_unlock(&g_lock);
+}
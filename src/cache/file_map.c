@@ -0,0 +1,86 @@
+#include "file_map.h"
+#include "node.h"
+#include "logger.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* Guards node->map and every refcount. Held only for a pointer swap and a
+ * counter update (never across mmap or munmap), so one lock serves all
+ * nodes. */
+static pthread_mutex_t g_map_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static int map_matches(const FileMap* map, const struct stat* st) {
+    return map->dev == st->st_dev && map->ino == st->st_ino &&
+           map->size == (size_t)st->st_size &&
+           map->mtime.tv_sec == st->st_mtim.tv_sec &&
+           map->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+static void map_destroy(FileMap* map) {
+    munmap((void*)map->data, map->size);
+    free(map);
+}
+
+FileMap* file_map_acquire(struct Node* node, int fd, const struct stat* st) {
+    if (!node || fd < 0 || st->st_size <= 0) return NULL;
+
+    pthread_mutex_lock(&g_map_lock);
+    FileMap* map = node->map;
+    if (map && map_matches(map, st)) {
+        map->refs++;
+        pthread_mutex_unlock(&g_map_lock);
+        return map;
+    }
+    pthread_mutex_unlock(&g_map_lock);
+
+    // Map outside the lock; two workers racing here both map, one wins
+    void* data = mmap(NULL, (size_t)st->st_size, PROT_READ, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        log_message(LOG_WARN, "mmap of %s failed: %s", node->path, strerror(errno));
+        return NULL;
+    }
+
+    FileMap* fresh = malloc(sizeof(FileMap));
+    if (!fresh) {
+        munmap(data, (size_t)st->st_size);
+        return NULL;
+    }
+    fresh->data  = data;
+    fresh->size  = (size_t)st->st_size;
+    fresh->dev   = st->st_dev;
+    fresh->ino   = st->st_ino;
+    fresh->mtime = st->st_mtim;
+    fresh->refs  = 2;                   // The node's and the caller's
+
+    FileMap* old = NULL;
+    pthread_mutex_lock(&g_map_lock);
+    map = node->map;
+    if (map && map_matches(map, st)) {
+        // Another worker mapped the same file first; use theirs
+        map->refs++;
+        pthread_mutex_unlock(&g_map_lock);
+        map_destroy(fresh);
+        return map;
+    }
+    node->map = fresh;
+    if (map && --map->refs == 0) old = map;
+    pthread_mutex_unlock(&g_map_lock);
+
+    if (old) map_destroy(old);
+    return fresh;
+}
+
+void file_map_release(FileMap* map) {
+    if (!map) return;
+
+    pthread_mutex_lock(&g_map_lock);
+    int last = --map->refs == 0;
+    pthread_mutex_unlock(&g_map_lock);
+
+    if (last) map_destroy(map);
+}
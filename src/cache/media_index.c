@@ -0,0 +1,213 @@
+#include "media_index.h"
+#include "hash_table.h"
+#include "logger.h"
+#include "mime.h"
+#include "mp4.h"
+#include "node.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Image types a poster may have, in order of preference
+static const char* const poster_extensions[] = { ".jpg", ".jpeg", ".png", ".webp" };
+#define POSTER_EXTENSION_COUNT (sizeof(poster_extensions) / sizeof(poster_extensions[0]))
+
+typedef struct {
+    MediaIndex*        index;
+    size_t             cap;
+    const struct Node* tree;
+    const char*        public_dir;      // webroot/public
+    size_t             public_len;
+    const char*        videos_dir;      // webroot/public/videos/
+    size_t             videos_len;
+    int                failed;
+} BuildState;
+
+static int is_media_type(const char* mime) {
+    return mime && (strncmp(mime, "video/", 6) == 0 || strncmp(mime, "audio/", 6) == 0);
+}
+
+static int in_tree(const struct Node* tree, const char* path) {
+    const struct Node* node = lookupNode((struct Node*)tree, (unsigned int)hashPath(path));
+    return node && strcmp(node->path, path) == 0;
+}
+
+/* Looks for "<stem>.jpg" (or another poster extension) beside the file.
+ * Only the cache index is consulted, so this costs no syscalls. */
+static char* find_poster(const BuildState* st, const char* path) {
+    const char* slash = strrchr(path, '/');
+    const char* dot = strrchr(path, '.');
+    size_t stem_len = dot && dot > slash ? (size_t)(dot - path) : strlen(path);
+
+    char candidate[1024];
+    for (size_t i = 0; i < POSTER_EXTENSION_COUNT; i++) {
+        int n = snprintf(candidate, sizeof(candidate), "%.*s%s",
+                         (int)stem_len, path, poster_extensions[i]);
+        if (n < 0 || (size_t)n >= sizeof(candidate)) return NULL;
+        if (in_tree(st->tree, candidate)) return strdup(candidate + st->public_len);
+    }
+    return NULL;
+}
+
+static void probe(MediaEntry* entry, const char* path) {
+    extern struct ServerConfig g_config;
+    entry->duration = -1;
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0) {
+        entry->size = st.st_size;
+        entry->mtime = st.st_mtime;
+
+        Mp4Info info;
+        if (mp4_probe(fd, st.st_size, &info) == 0) {
+            entry->duration = info.duration;
+            entry->moov_first = info.mdat_offset < 0 || info.moov_offset < info.mdat_offset;
+            if (!entry->moov_first && g_config.mp4_faststart_max_kb > 0) {
+                entry->faststart = mp4_faststart_build(fd, &st, &info,
+                                                       (uint64_t)g_config.mp4_faststart_max_kb * 1024);
+            }
+        }
+    }
+    close(fd);
+}
+
+static void add_file(const struct Node* node, void* arg) {
+    extern ht* mime_table;
+    BuildState* st = arg;
+    if (st->failed || strncmp(node->path, st->videos_dir, st->videos_len) != 0) return;
+
+    const char* mime = mime_get_type_from_filename(mime_table, node->path);
+    if (!is_media_type(mime)) return;
+
+    MediaIndex* index = st->index;
+    if (index->count == st->cap) {
+        size_t cap = st->cap ? st->cap * 2 : 32;
+        MediaEntry* grown = realloc(index->entries, cap * sizeof(MediaEntry));
+        if (!grown) {
+            st->failed = 1;
+            return;
+        }
+        index->entries = grown;
+        st->cap = cap;
+    }
+
+    MediaEntry* entry = &index->entries[index->count];
+    memset(entry, 0, sizeof(*entry));
+    entry->url = strdup(node->path + st->public_len);
+    if (!entry->url) {
+        st->failed = 1;
+        return;
+    }
+    entry->mime = mime;
+    entry->etag = node->file_hash;
+    entry->poster = find_poster(st, node->path);
+    probe(entry, node->path);
+    index->count++;
+}
+
+static int compare_url(const void* a, const void* b) {
+    return strcmp(((const MediaEntry*)a)->url, ((const MediaEntry*)b)->url);
+}
+
+MediaIndex* media_index_build(const char* webroot, const struct Node* tree) {
+    MediaIndex* index = calloc(1, sizeof(MediaIndex));
+    if (!index) return NULL;
+
+    char public_dir[512], videos_dir[512];
+    snprintf(public_dir, sizeof(public_dir), "%s/public", webroot);
+    snprintf(videos_dir, sizeof(videos_dir), "%s/public/videos/", webroot);
+
+    index->public_dir = strdup(public_dir);
+    BuildState st = {
+        .index = index, .tree = tree,
+        .public_dir = public_dir, .public_len = strlen(public_dir),
+        .videos_dir = videos_dir, .videos_len = strlen(videos_dir),
+    };
+    walk_tree(tree, add_file, &st);
+
+    if (st.failed || !index->public_dir) {
+        log_message(LOG_ERROR, "Out of memory building the media index of %s", webroot);
+        media_index_free(index);
+        return NULL;
+    }
+
+    // The cache index is ordered by path hash; the catalog pages by name
+    if (index->count > 1) {
+        qsort(index->entries, index->count, sizeof(MediaEntry), compare_url);
+    }
+    log_message(LOG_INFO, "Media index for %s: %zu files", webroot, index->count);
+    return index;
+}
+
+void media_index_free(MediaIndex* index) {
+    if (!index) return;
+    for (size_t i = 0; i < index->count; i++) {
+        free(index->entries[i].url);
+        free(index->entries[i].poster);
+        mp4_faststart_free(index->entries[i].faststart);
+    }
+    free(index->entries);
+    free(index->public_dir);
+    free(index);
+}
+
+const struct Mp4Faststart* media_index_faststart(const MediaIndex* index, const char* full_path) {
+    if (!index || !index->count || !full_path) return NULL;
+
+    size_t prefix = strlen(index->public_dir);
+    if (strncmp(full_path, index->public_dir, prefix) != 0) return NULL;
+    const char* url = full_path + prefix;
+
+    size_t lo = 0, hi = index->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(url, index->entries[mid].url);
+        if (cmp == 0) return index->entries[mid].faststart;
+        if (cmp < 0) hi = mid;
+        else lo = mid + 1;
+    }
+    return NULL;
+}
+
+void media_index_render(const MediaIndex* index, TextBuffer* buf, size_t page, size_t per_page) {
+    size_t total = index ? index->count : 0;
+    size_t pages = per_page ? (total + per_page - 1) / per_page : 0;
+    size_t first = (page - 1) * per_page;
+
+    text_append(buf, "{\"page\": %zu, \"per_page\": %zu, \"total\": %zu, \"pages\": %zu, \"videos\": [",
+                page, per_page, total, pages);
+
+    for (size_t i = first; i < total && i < first + per_page; i++) {
+        const MediaEntry* e = &index->entries[i];
+
+        text_append(buf, "%s\n  {\"path\": \"", i > first ? "," : "");
+        text_append_json(buf, e->url + 1);
+        text_append(buf, "\", \"url\": \"");
+        text_append_json(buf, e->url);
+        text_append(buf, "\", \"mime\": \"");
+        text_append_json(buf, e->mime);
+        text_append(buf, "\", \"size\": %lld, \"modified\": %lld, \"etag\": \"\\\"%u\\\"\", \"duration\": ",
+                    (long long)e->size, (long long)e->mtime, e->etag);
+        if (e->duration >= 0) text_append(buf, "%.3f", e->duration);
+        else text_append(buf, "null");
+
+        text_append(buf, ", \"faststart\": %s, \"poster\": ",
+                    e->moov_first || e->faststart ? "true" : "false");
+        if (e->poster) {
+            text_append(buf, "\"");
+            text_append_json(buf, e->poster);
+            text_append(buf, "\"");
+        } else {
+            text_append(buf, "null");
+        }
+        text_append(buf, "}");
+    }
+    text_append(buf, "\n]}");
+}
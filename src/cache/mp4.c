@@ -0,0 +1,258 @@
+#include "mp4.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Most files have a handful of top-level boxes; stop on anything odd
+#define MP4_MAX_TOP_BOXES 64
+#define MP4_MAX_MOOV_BOXES 256
+
+static uint32_t be32(const unsigned char* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint64_t be64(const unsigned char* p) {
+    return ((uint64_t)be32(p) << 32) | be32(p + 4);
+}
+
+/* Reads the box header at offset. Sets *type, *header (8 or 16 bytes) and
+ * *box_size (whole box, header included). Returns 0, or -1 if the header
+ * is truncated or the size does not fit inside [offset, end). */
+static int read_box(int fd, off_t offset, off_t end, char type[4],
+                    unsigned* header, uint64_t* box_size) {
+    unsigned char buf[16];
+    if (end - offset < 8 || pread(fd, buf, 8, offset) != 8) return -1;
+
+    uint64_t size = be32(buf);
+    memcpy(type, buf + 4, 4);
+    *header = 8;
+
+    if (size == 1) {
+        if (end - offset < 16 || pread(fd, buf + 8, 8, offset + 8) != 8) return -1;
+        size = be64(buf + 8);
+        *header = 16;
+    } else if (size == 0) {
+        size = (uint64_t)(end - offset);        // Runs to the end of the file
+    }
+
+    if (size < *header || size > (uint64_t)(end - offset)) return -1;
+    *box_size = size;
+    return 0;
+}
+
+// Duration from the mvhd box body (after its 8-byte header)
+static double read_mvhd(int fd, off_t body, uint64_t len) {
+    unsigned char buf[32];
+    if (len < 20 || pread(fd, buf, len < sizeof(buf) ? (size_t)len : sizeof(buf), body) < 20) {
+        return -1;
+    }
+
+    uint32_t timescale;
+    uint64_t duration;
+    if (buf[0] == 1) {
+        if (len < 32) return -1;
+        timescale = be32(buf + 20);             // version, flags, creation(8), modification(8)
+        duration  = be64(buf + 24);
+    } else {
+        timescale = be32(buf + 12);             // version, flags, creation(4), modification(4)
+        duration  = be32(buf + 16);
+    }
+    if (timescale == 0) return -1;
+    return (double)duration / (double)timescale;
+}
+
+int mp4_probe(int fd, off_t size, Mp4Info* info) {
+    info->duration = -1;
+    info->moov_offset = -1;
+    info->moov_size = 0;
+    info->mdat_offset = -1;
+
+    off_t offset = 0;
+    unsigned moov_header = 8;
+    for (int i = 0; i < MP4_MAX_TOP_BOXES && offset < size; i++) {
+        char type[4];
+        unsigned header;
+        uint64_t box_size;
+        if (read_box(fd, offset, size, type, &header, &box_size) < 0) break;
+
+        if (memcmp(type, "moov", 4) == 0 && info->moov_offset < 0) {
+            info->moov_offset = offset;
+            info->moov_size = box_size;
+            moov_header = header;
+        } else if (memcmp(type, "mdat", 4) == 0 && info->mdat_offset < 0) {
+            info->mdat_offset = offset;
+        }
+        offset += (off_t)box_size;
+    }
+    if (info->moov_offset < 0) return -1;
+
+    off_t child = info->moov_offset + moov_header;
+    off_t moov_end = info->moov_offset + (off_t)info->moov_size;
+    for (int i = 0; i < MP4_MAX_MOOV_BOXES && child < moov_end; i++) {
+        char type[4];
+        unsigned header;
+        uint64_t box_size;
+        if (read_box(fd, child, moov_end, type, &header, &box_size) < 0) break;
+
+        if (memcmp(type, "mvhd", 4) == 0) {
+            info->duration = read_mvhd(fd, child + header, box_size - header);
+            break;
+        }
+        child += (off_t)box_size;
+    }
+    return 0;
+}
+
+// Boxes on the path from moov down to the chunk offset tables
+static int is_container(const unsigned char* type) {
+    static const char* const containers[] = { "trak", "mdia", "minf", "stbl" };
+    for (size_t i = 0; i < sizeof(containers) / sizeof(containers[0]); i++) {
+        if (memcmp(type, containers[i], 4) == 0) return 1;
+    }
+    return 0;
+}
+
+static void put_be32(unsigned char* p, uint32_t v) {
+    p[0] = (unsigned char)(v >> 24);
+    p[1] = (unsigned char)(v >> 16);
+    p[2] = (unsigned char)(v >> 8);
+    p[3] = (unsigned char)v;
+}
+
+/* Adds delta to every chunk offset in [lo, hi) within the boxes of
+ * buf[0, len). Returns 0, or -1 on a malformed box or a 32-bit offset
+ * that would overflow (the table would have to grow into co64). */
+static int shift_offsets(unsigned char* buf, uint64_t len, uint64_t delta, uint64_t lo, uint64_t hi) {
+    uint64_t pos = 0;
+    while (pos + 8 <= len) {
+        uint64_t size = be32(buf + pos);
+        unsigned header = 8;
+        if (size == 1) {
+            if (pos + 16 > len) return -1;
+            size = be64(buf + pos + 8);
+            header = 16;
+        } else if (size == 0) {
+            size = len - pos;
+        }
+        if (size < header || size > len - pos) return -1;
+
+        unsigned char* type = buf + pos + 4;
+        unsigned char* body = buf + pos + header;
+        uint64_t body_len = size - header;
+
+        if (is_container(type)) {
+            if (shift_offsets(body, body_len, delta, lo, hi) < 0) return -1;
+        } else if (memcmp(type, "stco", 4) == 0 || memcmp(type, "co64", 4) == 0) {
+            int wide = type[0] == 'c';
+            unsigned width = wide ? 8 : 4;
+            if (body_len < 8) return -1;
+            uint64_t count = be32(body + 4);         // After version and flags
+            if (count > (body_len - 8) / width) return -1;
+
+            unsigned char* entry = body + 8;
+            for (uint64_t i = 0; i < count; i++, entry += width) {
+                uint64_t offset = wide ? be64(entry) : be32(entry);
+                if (offset < lo || offset >= hi) continue;
+                offset += delta;
+                if (wide) {
+                    put_be32(entry, (uint32_t)(offset >> 32));
+                    put_be32(entry + 4, (uint32_t)offset);
+                } else {
+                    if (offset > UINT32_MAX) return -1;
+                    put_be32(entry, (uint32_t)offset);
+                }
+            }
+        }
+        pos += size;
+    }
+    return 0;
+}
+
+Mp4Faststart* mp4_faststart_build(int fd, const struct stat* st, const Mp4Info* info, uint64_t max_moov) {
+    if (info->moov_offset < 0 || info->mdat_offset < 0) return NULL;
+    if (info->moov_offset < info->mdat_offset) return NULL;    // Already moov first
+    if (info->moov_size > max_moov || info->moov_size < 8) return NULL;
+
+    Mp4Faststart* view = calloc(1, sizeof(Mp4Faststart));
+    if (!view) return NULL;
+    view->moov = malloc((size_t)info->moov_size);
+    if (!view->moov) {
+        free(view);
+        return NULL;
+    }
+
+    if (pread(fd, view->moov, (size_t)info->moov_size, info->moov_offset) != (ssize_t)info->moov_size) {
+        mp4_faststart_free(view);
+        return NULL;
+    }
+
+    /* Skip the moov's own header and patch its children: media between
+     * the first mdat and the old moov position moves up by the moov size.
+     * Bytes before the mdat and after the moov keep their offsets. */
+    unsigned header = be32(view->moov) == 1 ? 16 : 8;
+    if (be32(view->moov) == 0) {
+        // "Runs to the end of the file" stops being true once moved
+        if (info->moov_size > UINT32_MAX) {
+            mp4_faststart_free(view);
+            return NULL;
+        }
+        put_be32(view->moov, (uint32_t)info->moov_size);
+    }
+    if (info->moov_size < header ||
+        shift_offsets(view->moov + header, info->moov_size - header, info->moov_size,
+                      (uint64_t)info->mdat_offset, (uint64_t)info->moov_offset) < 0) {
+        mp4_faststart_free(view);
+        return NULL;
+    }
+
+    view->moov_size   = info->moov_size;
+    view->moov_offset = info->moov_offset;
+    view->mdat_offset = info->mdat_offset;
+    view->size        = st->st_size;
+    view->dev         = st->st_dev;
+    view->ino         = st->st_ino;
+    view->mtime       = st->st_mtim;
+    return view;
+}
+
+void mp4_faststart_free(Mp4Faststart* view) {
+    if (!view) return;
+    free(view->moov);
+    free(view);
+}
+
+int mp4_faststart_matches(const Mp4Faststart* view, const struct stat* st) {
+    return view->dev == st->st_dev && view->ino == st->st_ino && view->size == st->st_size &&
+           view->mtime.tv_sec == st->st_mtim.tv_sec && view->mtime.tv_nsec == st->st_mtim.tv_nsec;
+}
+
+int mp4_faststart_segments(const Mp4Faststart* view, off_t start, off_t length,
+                           Mp4Segment out[MP4_MAX_SEGMENTS]) {
+    off_t moov_size = (off_t)view->moov_size;
+
+    // The view's pieces, in order: head, moov, media, tail
+    const struct { off_t view_start, length, file_offset; int memory; } parts[MP4_MAX_SEGMENTS] = {
+        { 0,                              view->mdat_offset,                     0,                               0 },
+        { view->mdat_offset,              moov_size,                             0,                               1 },
+        { view->mdat_offset + moov_size,  view->moov_offset - view->mdat_offset, view->mdat_offset,               0 },
+        { view->moov_offset + moov_size,  view->size - view->moov_offset - moov_size,
+                                                                                 view->moov_offset + moov_size,   0 },
+    };
+
+    off_t end = start + length;
+    int count = 0;
+    for (int i = 0; i < MP4_MAX_SEGMENTS; i++) {
+        off_t lo = parts[i].view_start;
+        off_t hi = lo + parts[i].length;
+        if (hi <= start || lo >= end || parts[i].length <= 0) continue;
+
+        off_t from = start > lo ? start : lo;
+        off_t to = end < hi ? end : hi;
+        out[count].data = parts[i].memory ? view->moov + (from - lo) : NULL;
+        out[count].file_offset = parts[i].file_offset + (from - lo);
+        out[count].length = to - from;
+        count++;
+    }
+    return count;
+}
@@ -1,4 +1,5 @@
 #include "node.h"
+#include "file_map.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,18 +15,24 @@
  * directory, then creates a BST node for each discovered file. Each node
  * contains the file path, path hash, content hash, and last modified time.
  *
+ * @param root_dir Webroot; files under root_dir/public are indexed
+ * @param budget Bytes the index may use (0 = unlimited). Files found after
+ *               the budget is spent are not indexed and are served uncached.
+ * @param used Set to the bytes charged to the index (may be NULL)
+ *
  * @return Pointer to root node of the created BST, or NULL on error
  *
- * @note Creates and removes temporary "results.txt" file during execution
  * @warning Caller must free the tree with free_tree() when done
  *
  * @see add_node(), free_tree()
  */
-struct Node* init_tree() {
+struct Node* init_tree(const char* root_dir, size_t budget, size_t* used) {
     struct Node* head = NULL;
+    size_t charged = 0;
+    int skipped = 0;
 
     char cmd[READSIZE];
-    snprintf(cmd, sizeof(cmd), "find %s/public -type f", SERVER_PATH);
+    snprintf(cmd, sizeof(cmd), "find '%s/public' -type f", root_dir);
 
     /* popen pipes find output directly into this process, one line at a time.
      * This avoids the intermediate results.txt file and the 4096-byte buffer
@@ -39,12 +46,28 @@ struct Node* init_tree() {
     char line[512];
     while (fgets(line, sizeof(line), fp)) {
         line[strcspn(line, "\n")] = '\0';
-        if (line[0] != '\0') {
-            head = add_node(head, line);
+        if (line[0] == '\0') continue;
+
+        // Node, path and the 29-byte HTTP date
+        size_t cost = sizeof(struct Node) + strlen(line) + 1 + 30;
+        if (budget && charged + cost > budget) {
+            skipped++;
+            continue;
+        }
+
+        struct Node* added = add_node(head, line);
+        if (added) {
+            head = added;
+            charged += cost;
         }
     }
 
     pclose(fp);
+
+    if (skipped) {
+        fprintf(stderr, "Cache budget for %s reached: %d files not indexed\n", root_dir, skipped);
+    }
+    if (used) *used = charged;
     return head;
 }
 
@@ -88,6 +111,7 @@ struct Node* add_node(struct Node* head, char* filename) {
 
     new_node->left = NULL;
     new_node->right = NULL;
+    new_node->map = NULL;
 
     // Calculate path hash
     unsigned int path_hash = hashPath(filename);
@@ -374,8 +398,26 @@ void free_tree(struct Node* node) {
     free_tree(node->left);
     free_tree(node->right);
     
-    // Free node data
+    // Free node data; senders still using the mapping keep it alive
+    file_map_release(node->map);
     free(node->path);
     free(node->last_modified);
     free(node);
-}
\ No newline at end of file
+}
+
+/**
+ * Calls visit on every node of the tree, in path-hash order
+ *
+ * @param node Root of the tree (may be NULL)
+ * @param visit Callback; must not modify the tree
+ * @param arg Passed through to visit
+ */
+void walk_tree(const struct Node* node, void (*visit)(const struct Node*, void*), void* arg) {
+    if (node == NULL) {
+        return;
+    }
+
+    walk_tree(node->left, visit, arg);
+    visit(node, arg);
+    walk_tree(node->right, visit, arg);
+}
@@ -0,0 +1,220 @@
+#include "prefetch.h"
+#include "fd_cache.h"
+#include "hash_table.h"
+#include "logger.h"
+#include "mime.h"
+#include "node.h"
+#include "vhost.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PREFETCH_QUEUE 256      // Pending windows; more than the workers can have in flight
+
+typedef struct {
+    FdCacheEntry* file;         // Holds a reference until advised
+    off_t  offset;
+    size_t len;
+} PrefetchJob;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  g_wake = PTHREAD_COND_INITIALIZER;
+static pthread_t       g_thread;
+static int             g_running = 0;
+static int             g_stop = 0;
+
+static PrefetchJob g_queue[PREFETCH_QUEUE];
+static unsigned    g_head = 0;          // Next job to run
+static unsigned    g_tail = 0;          // Next free slot
+
+/* Videos still to pre-warm. Seek windows always go first; warming only
+ * runs while the queue is empty. A new warm-up replaces what is left of
+ * the previous one. */
+static char**  g_warm = NULL;
+static size_t  g_warm_count = 0;
+static size_t  g_warm_next = 0;
+
+static size_t  g_window = 0;
+static size_t  g_warm_bytes = 0;
+static struct PrefetchStats g_stats;
+
+static void advise(int fd, off_t offset, size_t len) {
+    int rc = posix_fadvise(fd, offset, (off_t)len, POSIX_FADV_WILLNEED);
+    if (rc != 0) {
+        log_message(LOG_DEBUG, "posix_fadvise(WILLNEED) failed: %s", strerror(rc));
+    }
+}
+
+// Opened directly rather than through the fd cache, so warming a large
+// library does not evict the files requests are using
+static int warm_file(const char* path) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return -1;
+    advise(fd, 0, g_warm_bytes);
+    close(fd);
+    return 0;
+}
+
+static void free_warm_list(void) {
+    for (size_t i = g_warm_next; i < g_warm_count; i++) free(g_warm[i]);
+    free(g_warm);
+    g_warm = NULL;
+    g_warm_count = g_warm_next = 0;
+}
+
+static void* prefetch_thread(void* arg) {
+    (void)arg;
+
+    pthread_mutex_lock(&g_lock);
+    while (!g_stop) {
+        if (g_head != g_tail) {
+            PrefetchJob job = g_queue[g_head % PREFETCH_QUEUE];
+            g_head++;
+            pthread_mutex_unlock(&g_lock);
+
+            advise(job.file->fd, job.offset, job.len);
+            fd_cache_release(job.file);
+
+            pthread_mutex_lock(&g_lock);
+            g_stats.requests++;
+            g_stats.bytes += job.len;
+            continue;
+        }
+
+        if (g_warm_next < g_warm_count) {
+            char* path = g_warm[g_warm_next++];
+            pthread_mutex_unlock(&g_lock);
+
+            int ok = warm_file(path) == 0;
+            free(path);
+
+            pthread_mutex_lock(&g_lock);
+            if (ok) g_stats.warmed++;
+            continue;
+        }
+
+        pthread_cond_wait(&g_wake, &g_lock);
+    }
+
+    // Let go of the files still queued
+    while (g_head != g_tail) {
+        fd_cache_release(g_queue[g_head % PREFETCH_QUEUE].file);
+        g_head++;
+    }
+    free_warm_list();
+    pthread_mutex_unlock(&g_lock);
+    return NULL;
+}
+
+int prefetch_init(int window_kb, int warm_mb) {
+    if (window_kb <= 0 && warm_mb <= 0) return 0;
+
+    g_window = window_kb > 0 ? (size_t)window_kb * 1024 : 0;
+    g_warm_bytes = warm_mb > 0 ? (size_t)warm_mb * 1024 * 1024 : 0;
+    g_stop = 0;
+
+    if (pthread_create(&g_thread, NULL, prefetch_thread, NULL) != 0) {
+        log_message(LOG_ERROR, "Failed to start prefetch thread");
+        g_window = g_warm_bytes = 0;
+        return -1;
+    }
+    g_running = 1;
+
+    log_message(LOG_INFO, "Prefetcher: %d KB read-ahead window, first %d MB of videos pre-warmed",
+                window_kb > 0 ? window_kb : 0, warm_mb > 0 ? warm_mb : 0);
+    return 0;
+}
+
+void prefetch_shutdown(void) {
+    if (!g_running) return;
+
+    pthread_mutex_lock(&g_lock);
+    g_stop = 1;
+    pthread_cond_signal(&g_wake);
+    pthread_mutex_unlock(&g_lock);
+
+    pthread_join(g_thread, NULL);
+    g_running = 0;
+    g_window = 0;
+}
+
+size_t prefetch_window(void) {
+    return g_window;
+}
+
+void prefetch_file(FdCacheEntry* file, off_t offset, size_t len) {
+    if (!g_window || !file || len == 0) return;
+
+    if (offset >= file->st.st_size) return;
+    if ((off_t)len > file->st.st_size - offset) len = (size_t)(file->st.st_size - offset);
+
+    pthread_mutex_lock(&g_lock);
+    if (g_tail - g_head >= PREFETCH_QUEUE) {
+        g_stats.dropped++;
+        pthread_mutex_unlock(&g_lock);
+        return;
+    }
+    fd_cache_retain(file);
+    g_queue[g_tail % PREFETCH_QUEUE] = (PrefetchJob){ file, offset, len };
+    g_tail++;
+    pthread_cond_signal(&g_wake);
+    pthread_mutex_unlock(&g_lock);
+}
+
+typedef struct {
+    char** paths;
+    size_t count;
+    size_t cap;
+} PathList;
+
+static void collect_video(const struct Node* node, void* arg) {
+    extern ht* mime_table;
+    PathList* list = arg;
+
+    const char* type = mime_get_type_from_filename(mime_table, node->path);
+    if (!type || strncmp(type, "video/", 6) != 0) return;
+
+    if (list->count == list->cap) {
+        size_t cap = list->cap ? list->cap * 2 : 64;
+        char** grown = realloc(list->paths, cap * sizeof(char*));
+        if (!grown) return;
+        list->paths = grown;
+        list->cap = cap;
+    }
+    char* copy = strdup(node->path);
+    if (copy) list->paths[list->count++] = copy;
+}
+
+/**
+ * Queues every indexed video for pre-warming
+ *
+ * Walks each host's cache index (under its read lock, so call it after
+ * the index is built or refreshed) and hands the paths to the prefetch
+ * thread. Only the leading warm_mb of each file is read.
+ */
+void prefetch_warm_videos(void) {
+    if (!g_running || !g_warm_bytes) return;
+
+    PathList list = { NULL, 0, 0 };
+    vhost_walk_files(collect_video, &list);
+
+    pthread_mutex_lock(&g_lock);
+    free_warm_list();
+    g_warm = list.paths;
+    g_warm_count = list.count;
+    pthread_cond_signal(&g_wake);
+    pthread_mutex_unlock(&g_lock);
+
+    log_message(LOG_INFO, "Pre-warming the first %zu MB of %zu videos",
+                g_warm_bytes / (1024 * 1024), list.count);
+}
+
+void prefetch_get_stats(struct PrefetchStats* stats) {
+    pthread_mutex_lock(&g_lock);
+    *stats = g_stats;
+    pthread_mutex_unlock(&g_lock);
+}
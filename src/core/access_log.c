@@ -0,0 +1,366 @@
+#include "access_log.h"
+#include "logger.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * The current file is mapped whole and preallocated. Writers reserve slots
+ * with one atomic add on the segment's fill counter and memcpy the record
+ * into the mapping; the kernel writes the pages back. When a segment is
+ * full, the thread that notices swaps in a fresh file and the full one is
+ * trimmed and renamed once its last writer has finished.
+ */
+typedef struct {
+    unsigned char* base;
+    int            fd;
+    uint64_t       capacity;        // Slots in the mapping
+    uint64_t       used;            // Slots reserved (may overshoot capacity)
+    int            writers;         // Threads between reserve and memcpy
+} AccessSegment;
+
+// Ids of paths already defined in the current segment
+#define PATH_SET_SIZE  4096
+#define PATH_SET_PROBE 8
+
+static AccessSegment   g_segments[2];       // Current and previous, alternating
+static AccessSegment*  g_current = NULL;
+static char*           g_path = NULL;
+static uint64_t        g_size_bytes = 0;
+static pthread_mutex_t g_rotate_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t        g_path_set[PATH_SET_SIZE];
+
+static uint64_t wall_us(void) {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (uint64_t)tv.tv_sec * 1000000 + (uint64_t)tv.tv_usec;
+}
+
+/* 64-bit FNV-1a over the path, up to the query string. Never returns 0.
+ * Ids alone identify paths (here and in the decoder), so they are wide
+ * enough that two paths in one file never realistically share one. */
+static uint64_t path_id(const char* path, size_t* len) {
+    uint64_t h = 14695981039346656037ull;
+    size_t n = 0;
+    for (; path[n] && path[n] != '?'; n++) {
+        h ^= (unsigned char)path[n];
+        h *= 1099511628211ull;
+    }
+    *len = n;
+    return h ? h : 1;
+}
+
+/* Returns 1 if this call claimed the id (the caller writes the definition). */
+static int path_set_claim(uint64_t id) {
+    for (int i = 0; i < PATH_SET_PROBE; i++) {
+        uint64_t* entry = &g_path_set[(id + (uint64_t)i) & (PATH_SET_SIZE - 1)];
+        uint64_t seen = __atomic_load_n(entry, __ATOMIC_RELAXED);
+        if (seen == id) return 0;
+        if (seen == 0) {
+            uint64_t expected = 0;
+            if (__atomic_compare_exchange_n(entry, &expected, id, 0,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                return 1;
+            }
+            if (expected == id) return 0;
+        }
+    }
+    return 1;   // Set is full: define the path again rather than lose it
+}
+
+/**
+ * Opens (or continues) the log file into seg
+ *
+ * An existing file is appended to: its fill level is found by skipping
+ * back over empty slots, which also recovers from a crash that left the
+ * file at full preallocated size.
+ *
+ * The blocks are allocated up front rather than left sparse: a store into
+ * a hole of the mapping on a full disk would kill the process with SIGBUS.
+ * Without the space the open fails with ENOSPC instead.
+ */
+static int segment_open(AccessSegment* seg) {
+    int fd = open(g_path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) < 0 || (uint64_t)st.st_size > g_size_bytes) {
+        close(fd);
+        return -1;
+    }
+
+    // A file written in another format version is moved aside, not appended to
+    AccessLogHeader old;
+    if (pread(fd, &old, sizeof(old), 0) == (ssize_t)sizeof(old) &&
+        memcmp(old.magic, ACCESS_LOG_MAGIC, 8) == 0 && old.version != ACCESS_LOG_VERSION) {
+        close(fd);
+        char aside[1024];
+        snprintf(aside, sizeof(aside), "%s.v%u", g_path, old.version);
+        if (rename(g_path, aside) < 0) return -1;
+        log_message(LOG_INFO, "access log: moved version %u file to %s", old.version, aside);
+        return segment_open(seg);
+    }
+
+    int err = posix_fallocate(fd, 0, (off_t)g_size_bytes);
+    if (err != 0) {
+        // Give back whatever part of the range was allocated
+        if (ftruncate(fd, st.st_size) < 0) {
+            log_message(LOG_WARN, "access log: cannot trim %s: %s", g_path, strerror(errno));
+        }
+        close(fd);
+        errno = err;
+        return -1;
+    }
+
+    unsigned char* base = mmap(NULL, g_size_bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    uint64_t used = (uint64_t)st.st_size / ACCESS_LOG_SLOT;
+    AccessLogHeader* header = (AccessLogHeader*)base;
+    if (used == 0 || memcmp(header->magic, ACCESS_LOG_MAGIC, 8) != 0) {
+        memset(header, 0, sizeof(*header));
+        memcpy(header->magic, ACCESS_LOG_MAGIC, 8);
+        header->version = ACCESS_LOG_VERSION;
+        header->slot_size = ACCESS_LOG_SLOT;
+        header->created_us = wall_us();
+        used = 1;
+    } else {
+        while (used > 1 && base[(used - 1) * ACCESS_LOG_SLOT] == ACCESS_REC_EMPTY) used--;
+    }
+
+    seg->base = base;
+    seg->fd = fd;
+    seg->capacity = g_size_bytes / ACCESS_LOG_SLOT;
+    __atomic_store_n(&seg->used, used, __ATOMIC_RELAXED);
+    __atomic_store_n(&seg->writers, 0, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/* Trims the file to the slots actually written and unmaps it. */
+static void segment_close(AccessSegment* seg) {
+    if (!seg->base) return;
+
+    uint64_t used = __atomic_load_n(&seg->used, __ATOMIC_RELAXED);
+    if (used > seg->capacity) used = seg->capacity;
+
+    munmap(seg->base, seg->capacity * ACCESS_LOG_SLOT);
+    if (ftruncate(seg->fd, (off_t)(used * ACCESS_LOG_SLOT)) < 0) {
+        log_message(LOG_WARN, "access log: cannot trim %s: %s", g_path, strerror(errno));
+    }
+    close(seg->fd);
+    seg->base = NULL;
+    seg->fd = -1;
+}
+
+/**
+ * Replaces a full segment with a fresh file
+ *
+ * The full file is renamed to <path>.<UTC timestamp> before the new one is
+ * created under the original name. Writers that still hold the old segment
+ * finish their memcpy before it is unmapped.
+ *
+ * @param full Segment the caller found full
+ */
+static void rotate(AccessSegment* full) {
+    pthread_mutex_lock(&g_rotate_lock);
+
+    // Another thread already rotated it
+    if (__atomic_load_n(&g_current, __ATOMIC_ACQUIRE) != full) {
+        pthread_mutex_unlock(&g_rotate_lock);
+        return;
+    }
+
+    char stamp[32], rotated[1024];
+    time_t now = time(NULL);
+    struct tm tm;
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", gmtime_r(&now, &tm));
+    snprintf(rotated, sizeof(rotated), "%s.%s", g_path, stamp);
+    for (int i = 1; access(rotated, F_OK) == 0 && i < 100; i++) {
+        snprintf(rotated, sizeof(rotated), "%s.%s.%d", g_path, stamp, i);
+    }
+
+    if (rename(g_path, rotated) < 0) {
+        log_message(LOG_ERROR, "access log: cannot rotate %s: %s", g_path, strerror(errno));
+    }
+
+    AccessSegment* next = full == &g_segments[0] ? &g_segments[1] : &g_segments[0];
+    memset(g_path_set, 0, sizeof(g_path_set));
+    if (segment_open(next) < 0) {
+        log_message(LOG_ERROR, "access log: cannot open %s: %s; access logging stopped",
+                    g_path, strerror(errno));
+        next = NULL;
+    }
+    __atomic_store_n(&g_current, next, __ATOMIC_RELEASE);
+
+    while (__atomic_load_n(&full->writers, __ATOMIC_ACQUIRE) > 0) sched_yield();
+    segment_close(full);
+
+    pthread_mutex_unlock(&g_rotate_lock);
+    log_message(LOG_INFO, "access log rotated to %s", rotated);
+}
+
+/* Reserves count consecutive slots. Returns their address with the segment's
+ * writer count held, or NULL if logging is off. */
+static unsigned char* reserve(uint64_t count, AccessSegment** out) {
+    for (;;) {
+        AccessSegment* seg = __atomic_load_n(&g_current, __ATOMIC_ACQUIRE);
+        if (!seg) return NULL;
+
+        __atomic_add_fetch(&seg->writers, 1, __ATOMIC_ACQ_REL);
+        if (__atomic_load_n(&g_current, __ATOMIC_ACQUIRE) != seg) {
+            __atomic_sub_fetch(&seg->writers, 1, __ATOMIC_RELEASE);
+            continue;
+        }
+
+        uint64_t slot = __atomic_fetch_add(&seg->used, count, __ATOMIC_RELAXED);
+        if (slot + count <= seg->capacity) {
+            *out = seg;
+            return seg->base + slot * ACCESS_LOG_SLOT;
+        }
+
+        __atomic_sub_fetch(&seg->writers, 1, __ATOMIC_RELEASE);
+        rotate(seg);
+    }
+}
+
+static void release(AccessSegment* seg) {
+    __atomic_sub_fetch(&seg->writers, 1, __ATOMIC_RELEASE);
+}
+
+static uint8_t method_code(const char* method) {
+    if (!method) return ACCESS_METHOD_OTHER;
+    switch (method[0]) {
+        case 'G': return strcmp(method, "GET") == 0 ? ACCESS_METHOD_GET : ACCESS_METHOD_OTHER;
+        case 'H': return strcmp(method, "HEAD") == 0 ? ACCESS_METHOD_HEAD : ACCESS_METHOD_OTHER;
+        case 'P': return strcmp(method, "POST") == 0 ? ACCESS_METHOD_POST :
+                         strcmp(method, "PUT") == 0 ? ACCESS_METHOD_PUT : ACCESS_METHOD_OTHER;
+        case 'D': return strcmp(method, "DELETE") == 0 ? ACCESS_METHOD_DELETE : ACCESS_METHOD_OTHER;
+        case 'O': return strcmp(method, "OPTIONS") == 0 ? ACCESS_METHOD_OPTIONS : ACCESS_METHOD_OTHER;
+        default:  return ACCESS_METHOD_OTHER;
+    }
+}
+
+/**
+ * Opens the binary access log
+ *
+ * @param path Log file; empty or NULL disables the access log
+ * @param size_mb Size at which the file is rotated
+ *
+ * @return 0 on success (or when disabled), -1 if the file cannot be mapped
+ *
+ * @see access_log_request(), access_log_close()
+ */
+int access_log_init(const char* path, int size_mb) {
+    if (!path || !*path) return 0;
+
+    g_path = strdup(path);
+    g_size_bytes = (uint64_t)(size_mb > 0 ? size_mb : 64) * 1024 * 1024;
+
+    if (!g_path || segment_open(&g_segments[0]) < 0) {
+        log_message(LOG_ERROR, "access log: cannot open %s: %s", path, strerror(errno));
+        free(g_path);
+        g_path = NULL;
+        return -1;
+    }
+    __atomic_store_n(&g_current, &g_segments[0], __ATOMIC_RELEASE);
+    log_message(LOG_INFO, "Binary access log: %s (rotated at %d MB)", path, (int)(g_size_bytes >> 20));
+    return 0;
+}
+
+/**
+ * Trims and closes the current file
+ *
+ * @warning Call only after all workers have stopped
+ */
+void access_log_close(void) {
+    AccessSegment* seg = __atomic_exchange_n(&g_current, NULL, __ATOMIC_ACQ_REL);
+    if (seg) segment_close(seg);
+    free(g_path);
+    g_path = NULL;
+}
+
+/**
+ * Appends the record of a completed request
+ *
+ * The first time a path is seen in the current file its definition is
+ * written too, in the same reservation.
+ *
+ * @param client Request that was just answered
+ * @param conn Connection it arrived on
+ * @param latency_us Time from parsed request to response sent
+ * @param bytes Bytes sent for the request
+ */
+void access_log_request(const Client* client, const Connection* conn, uint64_t latency_us,
+                        uint64_t bytes) {
+    if (!__atomic_load_n(&g_current, __ATOMIC_RELAXED)) return;
+
+    const char* path = client->path ? client->path : "";
+    size_t path_len;
+    uint64_t id = path_id(path, &path_len);
+    if (path_len > UINT16_MAX) path_len = UINT16_MAX;
+
+    uint64_t def_slots = 0;
+    if (path_set_claim(id)) {
+        def_slots = 1;
+        if (path_len > ACCESS_PATH_INLINE) {
+            def_slots += (path_len - ACCESS_PATH_INLINE + ACCESS_LOG_SLOT - 1) / ACCESS_LOG_SLOT;
+        }
+    }
+
+    AccessRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.type = ACCESS_REC_REQUEST;
+    rec.method = method_code(client->method);
+    rec.status = (uint16_t)client->status;
+    rec.client_port = (uint16_t)conn->client_port;
+    rec.path_id = id;
+    rec.latency_us = latency_us > UINT32_MAX ? UINT32_MAX : (uint32_t)latency_us;
+    rec.timestamp_us = wall_us();
+    rec.bytes = bytes;
+    if (conn->ssl) rec.flags |= ACCESS_FLAG_TLS;
+    if (conn->tls_early) rec.flags |= ACCESS_FLAG_EARLY_DATA;
+    if (client->connection_status) rec.flags |= ACCESS_FLAG_KEEP_ALIVE;
+    if (strchr(conn->client_ip, ':')) {
+        rec.flags |= ACCESS_FLAG_IPV6;
+        inet_pton(AF_INET6, conn->client_ip, rec.client_ip);
+    } else {
+        inet_pton(AF_INET, conn->client_ip, rec.client_ip);
+    }
+
+    AccessSegment* seg;
+    unsigned char* dst = reserve(def_slots + 1, &seg);
+    if (!dst) return;
+
+    if (def_slots) {
+        AccessPathRecord* def = (AccessPathRecord*)dst;
+        memset(def, 0, (size_t)def_slots * ACCESS_LOG_SLOT);
+        def->length = (uint16_t)path_len;
+        def->path_id = id;
+        // Spills past def->path into the continuation slots
+        memcpy(dst + offsetof(AccessPathRecord, path), path, path_len);
+        __atomic_store_n(&def->type, ACCESS_REC_PATH, __ATOMIC_RELEASE);
+        dst += def_slots * ACCESS_LOG_SLOT;
+    }
+
+    // Type last: a slot reads as empty until the record is complete
+    rec.type = ACCESS_REC_EMPTY;
+    memcpy(dst, &rec, sizeof(rec));
+    __atomic_store_n(dst, (uint8_t)ACCESS_REC_REQUEST, __ATOMIC_RELEASE);
+
+    release(seg);
+}
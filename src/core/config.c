@@ -3,17 +3,86 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <stddef.h>
+#include <ctype.h>
 #include <unistd.h>
 
 // Global configuration
 struct ServerConfig g_config;
 
+typedef enum {
+    CONFIG_INT,
+    CONFIG_STRING,
+    CONFIG_VHOST        // Repeatable, parsed by parse_vhost()
+} ConfigType;
+
+// One "key = value" entry accepted in the config file
+typedef struct {
+    const char* key;
+    ConfigType  type;
+    size_t      offset;     // offsetof() the field inside ServerConfig
+} ConfigOption;
+
+static const ConfigOption config_options[] = {
+    { "webroot",           CONFIG_STRING, offsetof(ServerConfig, webroot) },
+    { "http_port",         CONFIG_INT,    offsetof(ServerConfig, http_port) },
+    { "https_port",        CONFIG_INT,    offsetof(ServerConfig, https_port) },
+    { "cert_path",         CONFIG_STRING, offsetof(ServerConfig, cert_path) },
+    { "key_path",          CONFIG_STRING, offsetof(ServerConfig, key_path) },
+    { "ecdsa_cert_path",   CONFIG_STRING, offsetof(ServerConfig, ecdsa_cert_path) },
+    { "ecdsa_key_path",    CONFIG_STRING, offsetof(ServerConfig, ecdsa_key_path) },
+    { "db_path",           CONFIG_STRING, offsetof(ServerConfig, db_path) },
+    { "thread_pool_size",  CONFIG_INT,    offsetof(ServerConfig, thread_pool_size) },
+    { "max_queue_size",    CONFIG_INT,    offsetof(ServerConfig, max_queue_size) },
+    { "crypto_pool_size",  CONFIG_INT,    offsetof(ServerConfig, crypto_pool_size) },
+    { "crypto_queue_size", CONFIG_INT,    offsetof(ServerConfig, crypto_queue_size) },
+    { "retry_after",       CONFIG_INT,    offsetof(ServerConfig, retry_after) },
+    { "listen_backlog",    CONFIG_INT,    offsetof(ServerConfig, listen_backlog) },
+    { "codel_target_ms",   CONFIG_INT,    offsetof(ServerConfig, codel_target_ms) },
+    { "codel_interval_ms", CONFIG_INT,    offsetof(ServerConfig, codel_interval_ms) },
+    { "keepalive_timeout",      CONFIG_INT, offsetof(ServerConfig, keepalive_timeout) },
+    { "keepalive_timeout_busy", CONFIG_INT, offsetof(ServerConfig, keepalive_timeout_busy) },
+    { "header_timeout",    CONFIG_INT,    offsetof(ServerConfig, header_timeout) },
+    { "body_timeout",      CONFIG_INT,    offsetof(ServerConfig, body_timeout) },
+    { "write_timeout",     CONFIG_INT,    offsetof(ServerConfig, write_timeout) },
+    { "max_connections",   CONFIG_INT,    offsetof(ServerConfig, max_connections) },
+    { "io_engine",         CONFIG_STRING, offsetof(ServerConfig, io_engine) },
+    { "tls_session_cache_size", CONFIG_INT, offsetof(ServerConfig, tls_session_cache_size) },
+    { "tls_session_timeout",    CONFIG_INT, offsetof(ServerConfig, tls_session_timeout) },
+    { "tls_ticket_rotation",    CONFIG_INT, offsetof(ServerConfig, tls_ticket_rotation) },
+    { "tls_early_data",         CONFIG_INT, offsetof(ServerConfig, tls_early_data) },
+    { "tls_mmap",               CONFIG_INT, offsetof(ServerConfig, tls_mmap) },
+    { "fd_cache_size",     CONFIG_INT,    offsetof(ServerConfig, fd_cache_size) },
+    { "fd_cache_valid",    CONFIG_INT,    offsetof(ServerConfig, fd_cache_valid) },
+    { "prefetch_window_kb", CONFIG_INT,   offsetof(ServerConfig, prefetch_window_kb) },
+    { "prefetch_warm_mb",  CONFIG_INT,    offsetof(ServerConfig, prefetch_warm_mb) },
+    { "mp4_faststart_max_kb", CONFIG_INT, offsetof(ServerConfig, mp4_faststart_max_kb) },
+    { "tls_ciphers",       CONFIG_STRING, offsetof(ServerConfig, tls_ciphers) },
+    { "tls_ciphersuites",  CONFIG_STRING, offsetof(ServerConfig, tls_ciphersuites) },
+    { "tls_groups",        CONFIG_STRING, offsetof(ServerConfig, tls_groups) },
+    { "access_log",        CONFIG_STRING, offsetof(ServerConfig, access_log) },
+    { "access_log_size_mb", CONFIG_INT,   offsetof(ServerConfig, access_log_size_mb) },
+    { "log_ring_size",     CONFIG_INT,    offsetof(ServerConfig, log_ring_size) },
+    { "log_overflow",      CONFIG_STRING, offsetof(ServerConfig, log_overflow) },
+    { "log_level",         CONFIG_STRING, offsetof(ServerConfig, log_level) },
+    { "log_max_size_mb",   CONFIG_INT,    offsetof(ServerConfig, log_max_size_mb) },
+    { "log_rotate_hours",  CONFIG_INT,    offsetof(ServerConfig, log_rotate_hours) },
+    { "log_keep",          CONFIG_INT,    offsetof(ServerConfig, log_keep) },
+    { "log_compress",      CONFIG_INT,    offsetof(ServerConfig, log_compress) },
+    { "trace_buffer",      CONFIG_INT,    offsetof(ServerConfig, trace_buffer) },
+    { "trace_sample_rate", CONFIG_INT,    offsetof(ServerConfig, trace_sample_rate) },
+    { "cache_budget_kb",   CONFIG_INT,    offsetof(ServerConfig, cache_budget_kb) },
+    { "vhost",             CONFIG_VHOST,  0 },
+    { NULL, 0, 0 }
+};
+
 /**
  * Sets defaults for the server to boot up.
  *
  * Default ports, webroots, key paths, threads, and queue sizes are set here.
  *
- * @warning Certificate,Key paths and webroot for the server must be freed later.
+ * @warning Certificate,Key paths, webroot, db_path, io_engine and access_log must be freed later.
  */
 static void init_default_config(void) {
     g_config.webroot = strdup(SERVER_PATH);
@@ -28,32 +97,266 @@ static void init_default_config(void) {
 
     g_config.cert_path = strdup(cert_path);
     g_config.key_path = strdup(server_key_path);
+    g_config.db_path = strdup(SERVER_PATH "/var/db/users.db");
     g_config.thread_pool_size = 20;
     g_config.max_queue_size = 100;
+
+    // Argon2id is memory-hard (64 MB per hash), so keep this pool small
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    g_config.crypto_pool_size = (cpus > 0 && cpus < 4) ? (int)cpus : 4;
+    g_config.crypto_queue_size = 32;
+    g_config.retry_after = 1;
+
+    // Workers hold a connection for its whole keep-alive lifetime, so queue
+    // waits are naturally longer than in an event loop; target accordingly.
+    g_config.listen_backlog = BACKLOG;
+    g_config.codel_target_ms = 50;
+    g_config.codel_interval_ms = 500;
+
+    g_config.keepalive_timeout = 30;
+    g_config.keepalive_timeout_busy = 2;
+    g_config.header_timeout = 10;
+    g_config.body_timeout = 30;
+    g_config.write_timeout = 30;
+
+    // Also capped by RLIMIT_NOFILE, since the connection table is fd-indexed
+    g_config.max_connections = 4096;
+
+    g_config.io_engine = strdup("blocking");
+
+    // Roughly 1 KB per cached session; tickets cover clients beyond that
+    g_config.tls_session_cache_size = 20480;
+    g_config.tls_session_timeout = 7200;
+    g_config.tls_ticket_rotation = 3600;
+    g_config.tls_early_data = 0;
+    // Opt-in: a file truncated while mapped kills the process with SIGBUS
+    g_config.tls_mmap = 0;
+
+    // Lowered at startup to fit RLIMIT_NOFILE beside max_connections
+    g_config.fd_cache_size = 1024;
+    g_config.fd_cache_valid = 30;
+
+    g_config.prefetch_window_kb = 2048;
+    g_config.prefetch_warm_mb = 0;
+
+    // A moov is roughly 1% of its file; this covers videos of a few GB
+    g_config.mp4_faststart_max_kb = 16384;
+
+    // 256 lines of up to 512 bytes: 128 KB per logging thread
+    g_config.log_ring_size = 256;
+    g_config.log_max_size_mb = 64;
+    g_config.log_rotate_hours = 0;
+    g_config.log_keep = 7;
+    g_config.log_compress = 1;
+
+    // One million 64-byte records per file
+    g_config.access_log = strdup(SERVER_PATH "/var/log/access.bin");
+    g_config.access_log_size_mb = 64;
+
+    // About 600 requests' worth of spans (128 bytes each); sampling is opt-in
+    g_config.trace_buffer = 4096;
+    g_config.trace_sample_rate = 0;
+}
+
+/**
+ * Removes leading and trailing whitespace in place.
+ *
+ * @param str String to trim
+ *
+ * @return Pointer to the first non-space character of str
+ */
+static char* trim_whitespace(char* str) {
+    while (isspace((unsigned char)*str)) str++;
+
+    char* end = str + strlen(str);
+    while (end > str && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+
+    return str;
+}
+
+/**
+ * Parses a virtual host definition into the next g_config.vhosts slot.
+ *
+ * Format: "<name> <webroot> [cert=<path> key=<path>] [cache_kb=<n>]".
+ * Redefining a name replaces the earlier entry.
+ *
+ * @param value Raw value string (modified in place)
+ *
+ * @return 0 on success, -1 on a malformed definition or a full table
+ */
+static int parse_vhost(char* value) {
+    char* save = NULL;
+    char* name = strtok_r(value, " \t", &save);
+    char* webroot = strtok_r(NULL, " \t", &save);
+    if (!name || !webroot) {
+        fprintf(stderr, "vhost: expected <name> <webroot> [cert=..] [key=..] [cache_kb=..]\n");
+        return -1;
+    }
+
+    VhostConfig* vh = NULL;
+    for (int i = 0; i < g_config.vhost_count; i++) {
+        if (strcasecmp(g_config.vhosts[i].name, name) == 0) {
+            vh = &g_config.vhosts[i];
+            free(vh->name);
+            free(vh->webroot);
+            free(vh->cert_path);
+            free(vh->key_path);
+            break;
+        }
+    }
+    if (!vh) {
+        if (g_config.vhost_count == MAX_VHOSTS) {
+            fprintf(stderr, "vhost: more than %d virtual hosts\n", MAX_VHOSTS);
+            return -1;
+        }
+        vh = &g_config.vhosts[g_config.vhost_count++];
+    }
+    memset(vh, 0, sizeof(*vh));
+
+    vh->name = strdup(name);
+    vh->webroot = strdup(webroot);
+
+    char* opt;
+    while ((opt = strtok_r(NULL, " \t", &save)) != NULL) {
+        if (strncmp(opt, "cert=", 5) == 0) {
+            free(vh->cert_path);
+            vh->cert_path = strdup(opt + 5);
+        } else if (strncmp(opt, "key=", 4) == 0) {
+            free(vh->key_path);
+            vh->key_path = strdup(opt + 4);
+        } else if (strncmp(opt, "cache_kb=", 9) == 0) {
+            vh->cache_budget_kb = atoi(opt + 9);
+        } else {
+            fprintf(stderr, "vhost %s: unknown option '%s'\n", name, opt);
+        }
+    }
+
+    if (!vh->cert_path != !vh->key_path) {
+        fprintf(stderr, "vhost %s: cert= and key= must be given together\n", name);
+        free(vh->cert_path);
+        free(vh->key_path);
+        vh->cert_path = vh->key_path = NULL;
+    }
+    return 0;
+}
+
+/**
+ * Applies a single key/value pair to g_config.
+ *
+ * @param key Option name from config_options[]
+ * @param value Raw value string
+ *
+ * @return 0 on success, -1 if the key is unknown
+ */
+static int apply_config_option(const char* key, const char* value) {
+    for (int i = 0; config_options[i].key != NULL; i++) {
+        if (strcmp(config_options[i].key, key) != 0) continue;
+
+        void* field = (char*)&g_config + config_options[i].offset;
+        if (config_options[i].type == CONFIG_VHOST) {
+            char buf[1024];
+            snprintf(buf, sizeof(buf), "%s", value);
+            parse_vhost(buf);
+        } else if (config_options[i].type == CONFIG_INT) {
+            *(int*)field = atoi(value);
+        } else {
+            free(*(char**)field);
+            *(char**)field = strdup(value);
+        }
+        return 0;
+    }
+    return -1;
+}
+
+/**
+ * Reads a "key = value" config file into g_config.
+ *
+ * Blank lines and lines starting with '#' are ignored. Unknown keys are
+ * reported but do not abort startup.
+ *
+ * @param path Config file path
+ * @param required If 0, a missing file is silently skipped
+ *
+ * @return 0 on success, -1 if a required file cannot be opened
+ */
+static int load_config_file(const char* path, int required) {
+    FILE* fp = fopen(path, "r");
+    if (!fp) {
+        if (required) {
+            perror("Cannot open config file");
+            return -1;
+        }
+        return 0;
+    }
+
+    char line[1024];
+    int line_no = 0;
+    while (fgets(line, sizeof(line), fp)) {
+        line_no++;
+
+        char* entry = trim_whitespace(line);
+        if (*entry == '\0' || *entry == '#') continue;
+
+        char* eq = strchr(entry, '=');
+        if (!eq) {
+            fprintf(stderr, "%s:%d: expected key = value\n", path, line_no);
+            continue;
+        }
+        *eq = '\0';
+
+        char* key   = trim_whitespace(entry);
+        char* value = trim_whitespace(eq + 1);
+        if (apply_config_option(key, value) < 0) {
+            fprintf(stderr, "%s:%d: unknown option '%s'\n", path, line_no, key);
+        }
+    }
+
+    fclose(fp);
+    return 0;
 }
 
 /**
  * Updates the arguments for the server startup configuration.
- * 
+ *
  * Calls init_default_config() to set default server configuration, then
- * update webroot, ports, and thread sizes through server flags. If a 
- * parameter is unknown, it returns an error. Otherwise successful.
- * 
+ * applies the config file (SERVER_PATH/etc/server.conf, or the one given
+ * with -c), then updates webroot, ports, and thread sizes through server
+ * flags so the command line always wins. If a parameter is unknown, it
+ * returns an error. Otherwise successful.
+ *
  * @param argc Counts how many argument were passed in when executed
  * @param argv Stores the arguments passed in on execution
  *
  * @return 0 on successful updates, -1 on unknown parameters.
  *
- * @see init_default_config()
+ * @see init_default_config(), load_config_file()
  */
 int load_config(int argc, char** argv) {
     // Initialize defaults
     init_default_config();
-    
-    // Parse command line arguments
+
+    // First pass: only look for -c so the file is applied before other flags
+    const char* config_path = NULL;
     int opt;
-    while ((opt = getopt(argc, argv, "w:p:s:t:")) != -1) {
+    opterr = 0;
+    while ((opt = getopt(argc, argv, "c:w:p:s:t:")) != -1) {
+        if (opt == 'c') config_path = optarg;
+    }
+    opterr = 1;
+    optind = 1;
+
+    if (config_path) {
+        if (load_config_file(config_path, 1) < 0) return -1;
+    } else {
+        load_config_file(SERVER_PATH "/etc/server.conf", 0);
+    }
+
+    // Parse command line arguments
+    while ((opt = getopt(argc, argv, "c:w:p:s:t:")) != -1) {
         switch (opt) {
+            case 'c':
+                break;
             case 'w':
                 free(g_config.webroot);
                 g_config.webroot = strdup(optarg);
@@ -68,17 +371,18 @@ int load_config(int argc, char** argv) {
                 g_config.thread_pool_size = atoi(optarg);
                 break;
             default:
-                fprintf(stderr, "Usage: %s [-w webroot] [-p http_port] [-s https_port] [-t threads]\n", argv[0]);
+                fprintf(stderr, "Usage: %s [-c config] [-w webroot] [-p http_port] [-s https_port] [-t threads]\n", argv[0]);
                 return -1;
         }
     }
-    
+
     printf("Configuration loaded:\n");
     printf("  Webroot: %s\n", g_config.webroot);
     printf("  HTTP port: %d\n", g_config.http_port);
     printf("  HTTPS port: %d\n", g_config.https_port);
     printf("  Thread pool: %d\n", g_config.thread_pool_size);
-    
+    printf("  Crypto pool: %d (queue %d)\n", g_config.crypto_pool_size, g_config.crypto_queue_size);
+
     return 0;
 }
 
@@ -100,4 +404,40 @@ void free_config(void) {
         free(g_config.key_path);
         g_config.key_path = NULL;
     }
-}
\ No newline at end of file
+    if (g_config.db_path) {
+        free(g_config.db_path);
+        g_config.db_path = NULL;
+    }
+    if (g_config.io_engine) {
+        free(g_config.io_engine);
+        g_config.io_engine = NULL;
+    }
+    if (g_config.access_log) {
+        free(g_config.access_log);
+        g_config.access_log = NULL;
+    }
+
+    // Optional strings, NULL unless set in the config file
+    free(g_config.ecdsa_cert_path);
+    free(g_config.ecdsa_key_path);
+    free(g_config.tls_ciphers);
+    free(g_config.tls_ciphersuites);
+    free(g_config.tls_groups);
+    free(g_config.log_overflow);
+    free(g_config.log_level);
+    g_config.log_overflow = NULL;
+    g_config.log_level = NULL;
+    g_config.ecdsa_cert_path = NULL;
+    g_config.ecdsa_key_path = NULL;
+    g_config.tls_ciphers = NULL;
+    g_config.tls_ciphersuites = NULL;
+    g_config.tls_groups = NULL;
+
+    for (int i = 0; i < g_config.vhost_count; i++) {
+        free(g_config.vhosts[i].name);
+        free(g_config.vhosts[i].webroot);
+        free(g_config.vhosts[i].cert_path);
+        free(g_config.vhosts[i].key_path);
+    }
+    g_config.vhost_count = 0;
+}
@@ -0,0 +1,133 @@
+#include "crypto_pool.h"
+#include "logger.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+// One queued hashing job; lives on the submitting worker's stack
+typedef struct CryptoJob {
+    int (*func)(void* arg);
+    void* arg;
+    int result;
+    int done;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+} CryptoJob;
+
+static struct ThreadPool* g_crypto_pool = NULL;
+
+/**
+ * Crypto worker entry point
+ *
+ * Runs the job and wakes the request worker blocked in crypto_pool_run().
+ *
+ * @param arg CryptoJob* owned by the waiting caller
+ *
+ * @return Always NULL
+ */
+static void* crypto_job_thread(void* arg) {
+    CryptoJob* job = (CryptoJob*)arg;
+
+    int result = job->func(job->arg);
+
+    pthread_mutex_lock(&job->lock);
+    job->result = result;
+    job->done = 1;
+    pthread_cond_signal(&job->cond);
+    pthread_mutex_unlock(&job->lock);
+
+    return NULL;
+}
+
+/**
+ * Creates the password hashing pool
+ *
+ * Argon2id is CPU- and memory-hard, so it gets a small fixed set of threads
+ * and a bounded queue instead of running on the request workers. When the
+ * queue is full, crypto_pool_run() refuses the job immediately so the caller
+ * can shed load with 503 rather than pile up behind the hash.
+ *
+ * @param num_threads Crypto worker count
+ * @param max_queue_size Pending jobs allowed before admission fails
+ *
+ * @return 0 on success, -1 on failure
+ *
+ * @see crypto_pool_run(), crypto_pool_destroy()
+ */
+int crypto_pool_init(int num_threads, int max_queue_size) {
+    struct ThreadPoolConfig config = {
+        .num_threads = num_threads,
+        // 0 means unlimited in the thread pool; the crypto queue is always bounded
+        .max_queue_size = max_queue_size > 0 ? max_queue_size : 1
+    };
+
+    g_crypto_pool = threadpool_create(config);
+    if (!g_crypto_pool) {
+        log_message(LOG_ERROR, "Failed to create crypto pool");
+        return -1;
+    }
+
+    log_message(LOG_INFO, "Crypto pool started: %d threads, queue %d",
+                num_threads, config.max_queue_size);
+    return 0;
+}
+
+/**
+ * Stops the crypto pool
+ *
+ * @warning Call only after the request pool has drained, since request
+ *          workers may be blocked waiting on crypto jobs.
+ */
+void crypto_pool_destroy(void) {
+    if (!g_crypto_pool) return;
+
+    threadpool_destroy(g_crypto_pool);
+    g_crypto_pool = NULL;
+}
+
+/**
+ * Runs a hashing job on the crypto pool and waits for its result
+ *
+ * @param func Job to run; its return value is passed back to the caller
+ * @param arg Argument for func (must stay valid until this returns)
+ *
+ * @return func(arg), or CRYPTO_BUSY if the bounded queue is full
+ *
+ * @note Falls back to running func inline if the pool was never started
+ */
+int crypto_pool_run(int (*func)(void* arg), void* arg) {
+    if (!g_crypto_pool) {
+        return func(arg);
+    }
+
+    CryptoJob job = { .func = func, .arg = arg, .result = 0, .done = 0 };
+    pthread_mutex_init(&job.lock, NULL);
+    pthread_cond_init(&job.cond, NULL);
+
+    if (threadpool_add_work(g_crypto_pool, crypto_job_thread, &job) != 0) {
+        pthread_cond_destroy(&job.cond);
+        pthread_mutex_destroy(&job.lock);
+        log_message(LOG_WARN, "Crypto queue full, rejecting hash request");
+        return CRYPTO_BUSY;
+    }
+
+    pthread_mutex_lock(&job.lock);
+    while (!job.done) {
+        pthread_cond_wait(&job.cond, &job.lock);
+    }
+    pthread_mutex_unlock(&job.lock);
+
+    pthread_cond_destroy(&job.cond);
+    pthread_mutex_destroy(&job.lock);
+
+    return job.result;
+}
+
+/**
+ * Retrieves crypto pool statistics
+ *
+ * @param stats Filled with the pool's current counters
+ */
+void crypto_pool_get_stats(struct ThreadPoolStats* stats) {
+    threadpool_get_stats(g_crypto_pool, stats);
+}
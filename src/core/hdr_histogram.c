@@ -0,0 +1,82 @@
+#include "hdr_histogram.h"
+
+#define HDR_HALF (1u << (HDR_SUB_BITS - 1))
+
+/* Bucket of a value: exact below 2^HDR_SUB_BITS, then HDR_HALF buckets per
+ * power of two, each keeping the top HDR_SUB_BITS bits of the value. */
+static unsigned hdr_index(uint64_t value) {
+    if (value < (1u << HDR_SUB_BITS)) return (unsigned)value;
+
+    unsigned msb = 63u - (unsigned)__builtin_clzll(value);
+    unsigned shift = msb - (HDR_SUB_BITS - 1);
+    return HDR_HALF * shift + (unsigned)(value >> shift);
+}
+
+/* Largest value that lands in bucket index. */
+static uint64_t hdr_bucket_max(unsigned index) {
+    if (index < (1u << HDR_SUB_BITS)) return index;
+
+    unsigned shift = index / HDR_HALF - 1;
+    uint64_t top = index - HDR_HALF * shift;
+    return ((top + 1) << shift) - 1;
+}
+
+/**
+ * Records one value
+ *
+ * @param h Histogram owned by the calling thread
+ * @param value Microseconds (clamped to 2^HDR_MAX_BITS - 1)
+ */
+void hdr_record(HdrHistogram* h, uint64_t value) {
+    if (value >> HDR_MAX_BITS) value = (1ULL << HDR_MAX_BITS) - 1;
+
+    // Single writer: relaxed stores keep concurrent readers from tearing
+    unsigned i = hdr_index(value);
+    __atomic_store_n(&h->counts[i], h->counts[i] + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->total, h->total + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&h->sum, h->sum + value, __ATOMIC_RELAXED);
+    if (value > h->max) __atomic_store_n(&h->max, value, __ATOMIC_RELAXED);
+}
+
+/**
+ * Adds the counts of src (which may be written concurrently) to dst
+ *
+ * @param dst Private histogram
+ * @param src Histogram owned by another thread
+ */
+void hdr_merge(HdrHistogram* dst, const HdrHistogram* src) {
+    uint64_t total = 0;
+    for (unsigned i = 0; i < HDR_BUCKETS; i++) {
+        uint64_t count = __atomic_load_n(&src->counts[i], __ATOMIC_RELAXED);
+        dst->counts[i] += count;
+        total += count;
+    }
+    // Summed from the buckets so percentiles stay consistent with total
+    dst->total += total;
+    dst->sum += __atomic_load_n(&src->sum, __ATOMIC_RELAXED);
+
+    uint64_t max = __atomic_load_n(&src->max, __ATOMIC_RELAXED);
+    if (max > dst->max) dst->max = max;
+}
+
+uint64_t hdr_percentile(const HdrHistogram* h, double percentile) {
+    if (h->total == 0) return 0;
+
+    uint64_t rank = (uint64_t)((percentile / 100.0) * (double)h->total + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > h->total) rank = h->total;
+
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < HDR_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= rank) {
+            uint64_t value = hdr_bucket_max(i);
+            return value < h->max ? value : h->max;
+        }
+    }
+    return h->max;
+}
+
+double hdr_mean(const HdrHistogram* h) {
+    return h->total ? (double)h->sum / (double)h->total : 0.0;
+}
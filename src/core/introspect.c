@@ -0,0 +1,118 @@
+#include "introspect.h"
+#include "connection.h"
+#include "crypto_pool.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static struct ThreadPool* g_pool = NULL;
+
+/**
+ * Remembers the request worker pool
+ *
+ * @param pool Pool whose workers serve connections (arg is a Connection*)
+ */
+void introspect_init(struct ThreadPool* pool) {
+    g_pool = pool;
+}
+
+static void render_connection(TextBuffer* buf, const ConnectionInfo* c) {
+    text_append(buf, "{\"fd\": %d, \"client_ip\": \"%s\", \"client_port\": %d, \"tls\": %s, "
+                     "\"state\": \"%s\", \"age_us\": %llu, \"requests\": %u, "
+                     "\"bytes_in\": %llu, \"bytes_out\": %llu, \"worker\": %d, \"request\": \"",
+                c->fd, c->client_ip, c->client_port, c->is_ssl ? "true" : "false",
+                connection_state_name(c->state), (unsigned long long)c->age_us, c->requests,
+                (unsigned long long)c->bytes_in, (unsigned long long)c->bytes_out, c->worker_tid);
+    text_append_json(buf, c->request_line);
+    text_append(buf, "\", \"request_us\": %llu, \"response_sent\": %llu, \"response_total\": %llu}",
+                (unsigned long long)c->request_age_us, (unsigned long long)c->response_sent,
+                (unsigned long long)c->response_total);
+}
+
+char* introspect_render_connections(void) {
+    // Room for connections accepted while copying; later ones are left out
+    int max = connection_count() + 64;
+    ConnectionInfo* infos = malloc((size_t)max * sizeof(ConnectionInfo));
+    if (!infos) return NULL;
+    int n = connection_snapshot(infos, max);
+
+    TextBuffer buf = { .data = malloc(1024 + (size_t)n * 384), .len = 0, .cap = 1024 + (size_t)n * 384 };
+    if (!buf.data) {
+        free(infos);
+        return NULL;
+    }
+
+    int by_state[CONN_WRITING + 1] = { 0 };
+    for (int i = 0; i < n; i++) by_state[infos[i].state]++;
+
+    text_append(&buf, "{\n  \"success\": true,\n  \"data\": {\n    \"count\": %d,\n    \"states\": {", n);
+    for (int s = CONN_QUEUED; s <= CONN_WRITING; s++) {
+        text_append(&buf, "%s\"%s\": %d", s == CONN_QUEUED ? "" : ", ",
+                    connection_state_name((ConnState)s), by_state[s]);
+    }
+    text_append(&buf, "},\n    \"connections\": [");
+    for (int i = 0; i < n; i++) {
+        text_append(&buf, "%s\n      ", i ? "," : "");
+        render_connection(&buf, &infos[i]);
+    }
+    text_append(&buf, "\n    ]\n  }\n}");
+
+    free(infos);
+    if (buf.failed) {
+        free(buf.data);
+        return NULL;
+    }
+    return buf.data;
+}
+
+char* introspect_render_workers(void) {
+    extern struct ServerConfig g_config;
+
+    int max = g_config.thread_pool_size > 0 ? g_config.thread_pool_size : 1;
+    struct ThreadPoolWorker* workers = calloc((size_t)max, sizeof(*workers));
+    if (!workers) return NULL;
+    int n = threadpool_worker_snapshot(g_pool, workers, max);
+
+    struct ThreadPoolStats pool = { 0 }, crypto = { 0 };
+    if (g_pool) threadpool_get_stats(g_pool, &pool);
+    crypto_pool_get_stats(&crypto);
+
+    TextBuffer buf = { .data = malloc(1024 + (size_t)n * 512), .len = 0, .cap = 1024 + (size_t)n * 512 };
+    if (!buf.data) {
+        free(workers);
+        return NULL;
+    }
+
+    text_append(&buf, "{\n  \"success\": true,\n  \"data\": {\n"
+                      "    \"workers\": %d, \"busy\": %d, \"queued\": %d,\n"
+                      "    \"crypto\": {\"busy\": %d, \"queued\": %d},\n    \"list\": [",
+                n, pool.active_threads, pool.queued_work, crypto.active_threads, crypto.queued_work);
+
+    uint64_t now = monotonic_us();
+    for (int i = 0; i < n; i++) {
+        const struct ThreadPoolWorker* w = &workers[i];
+        uint64_t for_us = now > w->since_us ? now - w->since_us : 0;
+
+        // The request pool's work items are connection slots
+        ConnectionInfo info;
+        int described = w->busy && connection_describe((const Connection*)w->arg, &info) == 0;
+
+        text_append(&buf, "%s\n      {\"tid\": %d, \"state\": \"%s\", \"for_us\": %llu",
+                    i ? "," : "", w->tid, w->busy ? "busy" : "idle", (unsigned long long)for_us);
+        if (described) {
+            text_append(&buf, ", \"connection\": ");
+            render_connection(&buf, &info);
+        }
+        text_append(&buf, "}");
+    }
+    text_append(&buf, "\n    ]\n  }\n}");
+
+    free(workers);
+    if (buf.failed) {
+        free(buf.data);
+        return NULL;
+    }
+    return buf.data;
+}
@@ -1,46 +1,652 @@
 #include "logger.h"
+#include "config.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 #include <time.h>
-#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <zlib.h>
+
+/*
+ * Every thread that logs owns a single-producer ring of fixed-size lines.
+ * log_message() formats straight into the next free slot and publishes it
+ * with one release store; a dedicated writer thread drains all rings and
+ * hands the lines to the kernel with writev(), many lines per syscall.
+ * Workers never share a lock or a cache line on the logging path.
+ *
+ * The writer is also the only thread that touches the file, so rotation is
+ * a rename and an open between two batches; producers keep filling their
+ * rings meanwhile. Compressing and pruning rotated files is left to a
+ * separate housekeeping thread.
+ */
+#define LOG_LINE_MAX 512
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024    // Linux UIO_MAXIOV
+#endif
+
+typedef struct {
+    uint32_t len;
+    char     text[LOG_LINE_MAX - sizeof(uint32_t)];
+} LogSlot;
+
+typedef struct LogRing {
+    unsigned head __attribute__((aligned(64)));   // Next slot to fill (producer)
+    unsigned tail __attribute__((aligned(64)));   // Next slot to write (writer)
+    unsigned pending;                              // Tail after the current writev()
+    unsigned long dropped;                         // Lines lost to a full ring
+    unsigned long reported;                        // Drops already reported
+    int           orphaned;                        // Owner thread has exited
+    unsigned      mask;
+    LogSlot*      slots;
+    struct LogRing* next;
+} LogRing;
+
+static const char* const level_str[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+
+int g_log_level = LOG_INFO;
 
-static FILE*           log_fp    = NULL;
+static int             log_fd       = -1;
+static int             log_running  = 0;
+static int             log_stopping = 0;
+static int             log_block    = 0;      // Overflow policy: wait instead of drop
+static unsigned        log_ring_size = 256;
+static pthread_t       log_writer;
+
+static LogRing*        log_rings = NULL;      // Every ring, guarded by log_mutex
 static pthread_mutex_t log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  log_wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_key_t   log_ring_key;
+
+// Rotation state, owned by the writer thread
+static char*           log_path = NULL;
+static uint64_t        log_bytes = 0;         // Size of the current file
+static uint64_t        log_max_bytes = 0;     // 0 = no size limit
+static time_t          log_opened = 0;
+static time_t          log_rotate_secs = 0;   // 0 = no age limit
+static int             log_reopen_requested = 0;
+
+// Rotated files waiting for the housekeeper
+typedef struct LogJob {
+    char*          path;
+    struct LogJob* next;
+} LogJob;
+
+static LogJob*         job_head = NULL;
+static LogJob**        job_tail = &job_head;
+static int             job_stopping = 0;
+static int             log_keep = 0;          // Rotated files kept (0 = all)
+static int             log_compress = 0;
+static int             housekeeper_running = 0;
+static pthread_t       log_housekeeper;
+static pthread_mutex_t job_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  job_wakeup = PTHREAD_COND_INITIALIZER;
+
+static __thread LogRing* t_ring = NULL;
+static __thread time_t   t_stamp_time = (time_t)-1;
+static __thread char     t_stamp[32];
+
+// Thread exit: the writer drains what is left and frees the ring
+static void ring_orphan(void* arg) {
+    LogRing* ring = arg;
+    __atomic_store_n(&ring->orphaned, 1, __ATOMIC_RELEASE);
+}
+
+static LogRing* ring_create(void) {
+    LogRing* ring = calloc(1, sizeof(*ring));
+    if (!ring) return NULL;
+
+    ring->slots = malloc((size_t)log_ring_size * sizeof(LogSlot));
+    if (!ring->slots) {
+        free(ring);
+        return NULL;
+    }
+    ring->mask = log_ring_size - 1;
 
-void log_init(const char* log_file) {
     pthread_mutex_lock(&log_mutex);
-    log_fp = fopen(log_file, "a");
+    ring->next = log_rings;
+    log_rings = ring;
     pthread_mutex_unlock(&log_mutex);
+
+    pthread_setspecific(log_ring_key, ring);
+    return ring;
+}
+
+/* Writes the whole iovec array, resuming after short writes. */
+static void writev_all(struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t n = writev(log_fd, iov, count);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return;     // Nowhere to report it; the lines are lost
+        }
+        log_bytes += (uint64_t)n;
+        while (count > 0 && (size_t)n >= iov->iov_len) {
+            n -= (ssize_t)iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = (char*)iov->iov_base + n;
+            iov->iov_len -= (size_t)n;
+        }
+    }
+}
+
+/* One pass over every ring. Returns the number of lines written.
+ * log_mutex is held throughout so the ring list cannot change under the
+ * writev(); producers only take it when a thread logs for the first time. */
+static unsigned drain_rings(void) {
+    struct iovec iov[IOV_MAX];
+    char notes[16][96];
+    int count = 0, note_count = 0;
+    unsigned total = 0;
+
+    pthread_mutex_lock(&log_mutex);
+
+    for (LogRing* ring = log_rings; ring; ring = ring->next) {
+        unsigned head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        unsigned tail = ring->tail;
+
+        // iov is full: this ring waits for the next pass
+        if (count >= IOV_MAX - 1) {
+            ring->pending = tail;
+            continue;
+        }
+
+        // Leave room for a drop notice; the rest waits for the next pass
+        unsigned room = (unsigned)(IOV_MAX - 1 - count);
+        if (head - tail > room) head = tail + room;
+        ring->pending = head;
+
+        unsigned long dropped = __atomic_load_n(&ring->dropped, __ATOMIC_RELAXED);
+        if (dropped != ring->reported && note_count < 16 && count < IOV_MAX) {
+            int len = snprintf(notes[note_count], sizeof(notes[0]),
+                               "[%s] [WARN] Log buffer full: %lu lines dropped\n",
+                               t_stamp, dropped - ring->reported);
+            iov[count].iov_base = notes[note_count++];
+            iov[count++].iov_len = (size_t)len;
+            ring->reported = dropped;
+        }
+
+        for (unsigned i = tail; i != head; i++) {
+            LogSlot* slot = &ring->slots[i & ring->mask];
+            iov[count].iov_base = slot->text;
+            iov[count++].iov_len = slot->len;
+        }
+        total += head - tail;
+    }
+
+    if (count > 0) writev_all(iov, count);
+
+    // Hand the written slots back and free the rings of exited threads
+    LogRing** link = &log_rings;
+    while (*link) {
+        LogRing* ring = *link;
+        __atomic_store_n(&ring->tail, ring->pending, __ATOMIC_RELEASE);
+
+        if (__atomic_load_n(&ring->orphaned, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE) == ring->tail) {
+            *link = ring->next;
+            free(ring->slots);
+            free(ring);
+            continue;
+        }
+        link = &ring->next;
+    }
+
+    pthread_mutex_unlock(&log_mutex);
+    return total;
+}
+
+/* Opens the log file for appending and records its size. */
+static int open_log_file(void) {
+    int fd = open(log_path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return -1;
+
+    struct stat st;
+    log_bytes = fstat(fd, &st) == 0 ? (uint64_t)st.st_size : 0;
+    log_opened = time(NULL);
+    return fd;
+}
+
+/* Switches the writer to a freshly opened log_path. The old descriptor is
+ * only closed once the new one is open, so no line is ever lost. */
+static int switch_log_file(void) {
+    int fd = open_log_file();
+    if (fd < 0) return -1;
+
+    close(log_fd);
+    log_fd = fd;
+    return 0;
+}
+
+static void queue_job(char* path) {
+    LogJob* job = malloc(sizeof(*job));
+    if (!job) {
+        free(path);
+        return;
+    }
+    job->path = path;
+    job->next = NULL;
+
+    pthread_mutex_lock(&job_mutex);
+    *job_tail = job;
+    job_tail = &job->next;
+    pthread_cond_signal(&job_wakeup);
+    pthread_mutex_unlock(&job_mutex);
+}
+
+/* Renames the current file to <path>.<UTC timestamp> and starts a new one. */
+static void rotate_log_file(time_t now) {
+    size_t size = strlen(log_path) + 32;
+    char* rotated = malloc(size);
+    if (!rotated) return;
+
+    char stamp[20];
+    struct tm tm;
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", gmtime_r(&now, &tm));
+    snprintf(rotated, size, "%s.%s", log_path, stamp);
+    for (int i = 1; access(rotated, F_OK) == 0 && i < 100; i++) {
+        snprintf(rotated, size, "%s.%s.%d", log_path, stamp, i);
+    }
+
+    if (rename(log_path, rotated) < 0) {
+        // Keep writing where we are; retry after another full interval/size
+        int err = errno;
+        log_bytes = 0;
+        log_opened = now;
+        log_message(LOG_ERROR, "Cannot rotate %s: %s", log_path, strerror(err));
+        free(rotated);
+        return;
+    }
+
+    if (switch_log_file() < 0) {
+        // Lines keep going to the renamed file until a reopen succeeds
+        log_message(LOG_ERROR, "Cannot open %s after rotation: %s", log_path, strerror(errno));
+        log_bytes = 0;
+        log_opened = now;
+    }
+
+    log_message(LOG_INFO, "Log rotated to %s", rotated);
+    if (housekeeper_running) queue_job(rotated);
+    else free(rotated);
+}
+
+/* Rotation and reopen checks, run by the writer between batches. */
+static void maintain_log_file(time_t now) {
+    if (__atomic_exchange_n(&log_reopen_requested, 0, __ATOMIC_ACQ_REL)) {
+        if (switch_log_file() < 0) {
+            log_message(LOG_ERROR, "Cannot reopen %s: %s", log_path, strerror(errno));
+        } else {
+            log_message(LOG_INFO, "Log file reopened");
+        }
+        return;
+    }
+
+    if (log_bytes == 0) return;
+    if ((log_max_bytes && log_bytes >= log_max_bytes) ||
+        (log_rotate_secs && now - log_opened >= log_rotate_secs)) {
+        rotate_log_file(now);
+    }
+}
+
+/* Compresses path to path.gz (via a temporary file) and removes path. */
+static void compress_file(const char* path) {
+    size_t size = strlen(path) + 8;
+    char* gz_path = malloc(size);
+    char* tmp_path = malloc(size);
+    if (!gz_path || !tmp_path) goto out;
+    snprintf(gz_path, size, "%s.gz", path);
+    snprintf(tmp_path, size, "%s.gz~", path);
+
+    int in = open(path, O_RDONLY | O_CLOEXEC);
+    if (in < 0) goto out;
+
+    gzFile out = gzopen(tmp_path, "wb6");
+    if (!out) {
+        close(in);
+        goto out;
+    }
+
+    char buf[65536];
+    ssize_t n;
+    int ok = 1;
+    while ((n = read(in, buf, sizeof(buf))) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = 0;
+            break;
+        }
+        if (gzwrite(out, buf, (unsigned)n) != (int)n) {
+            ok = 0;
+            break;
+        }
+    }
+    close(in);
+
+    if (gzclose(out) != Z_OK) ok = 0;
+    if (ok && rename(tmp_path, gz_path) == 0) {
+        unlink(path);
+    } else {
+        unlink(tmp_path);
+        log_message(LOG_WARN, "Could not compress %s; left uncompressed", path);
+    }
+
+out:
+    free(gz_path);
+    free(tmp_path);
+}
+
+static int compare_names_desc(const void* a, const void* b) {
+    return strcmp(*(char* const*)b, *(char* const*)a);
+}
+
+/* Deletes all but the newest log_keep rotated files. The timestamp in the
+ * names makes lexical order chronological. */
+static void prune_rotated_files(void) {
+    if (log_keep <= 0) return;
+
+    char* dir_path = strdup(log_path);
+    if (!dir_path) return;
+    char* slash = strrchr(dir_path, '/');
+    const char* base = slash ? slash + 1 : log_path;
+    if (slash) *slash = '\0';
+
+    DIR* dir = opendir(slash ? (*dir_path ? dir_path : "/") : ".");
+    if (!dir) {
+        free(dir_path);
+        return;
+    }
+
+    size_t base_len = strlen(base);
+    char** names = NULL;
+    size_t count = 0, cap = 0;
+
+    struct dirent* entry;
+    while ((entry = readdir(dir)) != NULL) {
+        const char* name = entry->d_name;
+        size_t len = strlen(name);
+
+        // <base>.<digits>..., but not a compression still in progress
+        if (strncmp(name, base, base_len) != 0 || name[base_len] != '.' ||
+            name[base_len + 1] < '0' || name[base_len + 1] > '9' ||
+            name[len - 1] == '~') {
+            continue;
+        }
+
+        if (count == cap) {
+            cap = cap ? cap * 2 : 16;
+            char** grown = realloc(names, cap * sizeof(char*));
+            if (!grown) break;
+            names = grown;
+        }
+        if (!(names[count] = strdup(name))) break;
+        count++;
+    }
+    closedir(dir);
+
+    if (count > (size_t)log_keep) {
+        qsort(names, count, sizeof(char*), compare_names_desc);
+        for (size_t i = (size_t)log_keep; i < count; i++) {
+            char file[PATH_MAX];
+            snprintf(file, sizeof(file), "%s/%s", slash ? dir_path : ".", names[i]);
+            if (unlink(file) == 0) log_message(LOG_INFO, "Removed old log %s", file);
+        }
+    }
+
+    for (size_t i = 0; i < count; i++) free(names[i]);
+    free(names);
+    free(dir_path);
 }
 
-void log_message(LogLevel level, const char* format, ...) {
-    if (!log_fp) return;
+static void* log_housekeeper_thread(void* arg) {
+    (void)arg;
+
+    for (;;) {
+        pthread_mutex_lock(&job_mutex);
+        while (!job_head && !job_stopping) {
+            pthread_cond_wait(&job_wakeup, &job_mutex);
+        }
+        LogJob* job = job_head;
+        if (job) {
+            job_head = job->next;
+            if (!job_head) job_tail = &job_head;
+        }
+        pthread_mutex_unlock(&job_mutex);
+
+        if (!job) break;    // Stopping and nothing left to do
+
+        if (log_compress) compress_file(job->path);
+        prune_rotated_files();
+        free(job->path);
+        free(job);
+    }
+    return NULL;
+}
+
+static void* log_writer_thread(void* arg) {
+    (void)arg;
+
+    for (;;) {
+        int stopping = __atomic_load_n(&log_stopping, __ATOMIC_ACQUIRE);
+
+        // The writer's own timestamp, used for drop notices
+        time_t now = time(NULL);
+        struct tm tm;
+        strftime(t_stamp, sizeof(t_stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime_r(&now, &tm));
+
+        maintain_log_file(now);
+        if (drain_rings() > 0) continue;
+        if (stopping) break;
+
+        // Idle: producers wake us early when a ring fills up
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += 50 * 1000000L;
+        if (deadline.tv_nsec >= 1000000000L) {
+            deadline.tv_sec++;
+            deadline.tv_nsec -= 1000000000L;
+        }
+        pthread_mutex_lock(&log_mutex);
+        pthread_cond_timedwait(&log_wakeup, &log_mutex, &deadline);
+        pthread_mutex_unlock(&log_mutex);
+    }
+    return NULL;
+}
+
+/**
+ * Opens the log file and starts the background writer
+ *
+ * Reads log_ring_size, log_overflow and the rotation settings from the
+ * configuration. If the writer cannot be started, logging is disabled
+ * rather than fatal; if the housekeeper cannot, rotated files are simply
+ * left uncompressed and unpruned.
+ *
+ * @param log_file Path of the log file (appended to)
+ *
+ * @see log_write(), log_close()
+ */
+void log_init(const char* log_file) {
+    extern struct ServerConfig g_config;
+
+    log_path = strdup(log_file);
+    if (!log_path) return;
+    log_fd = open_log_file();
+    if (log_fd < 0) {
+        free(log_path);
+        log_path = NULL;
+        return;
+    }
+
+    log_max_bytes = (uint64_t)(g_config.log_max_size_mb > 0 ? g_config.log_max_size_mb : 0) << 20;
+    log_rotate_secs = g_config.log_rotate_hours > 0 ? (time_t)g_config.log_rotate_hours * 3600 : 0;
+    log_keep = g_config.log_keep;
+    log_compress = g_config.log_compress;
+
+    unsigned size = 16;
+    while (size < (unsigned)g_config.log_ring_size && size < (1u << 20)) size <<= 1;
+    log_ring_size = size;
+    log_block = g_config.log_overflow && strcmp(g_config.log_overflow, "block") == 0;
 
+    if (g_config.log_level) {
+        int level = log_level_parse(g_config.log_level);
+        if (level >= 0) log_set_level((LogLevel)level);
+        else fprintf(stderr, "Unknown log_level '%s', using %s\n",
+                     g_config.log_level, log_level_name((LogLevel)g_log_level));
+    }
+
+    pthread_key_create(&log_ring_key, ring_orphan);
+
+    if (pthread_create(&log_writer, NULL, log_writer_thread, NULL) != 0) {
+        close(log_fd);
+        log_fd = -1;
+        return;
+    }
+    __atomic_store_n(&log_running, 1, __ATOMIC_RELEASE);
+
+    if ((log_max_bytes || log_rotate_secs) &&
+        pthread_create(&log_housekeeper, NULL, log_housekeeper_thread, NULL) == 0) {
+        housekeeper_running = 1;
+    }
+}
+
+/**
+ * Queues one log line
+ *
+ * Called through the log_message() macro, which has already checked the
+ * level against g_log_level.
+ * Formats the line directly into the calling thread's ring; the write
+ * happens later on the writer thread. Lines longer than LOG_LINE_MAX are
+ * truncated. When the ring is full the line is dropped (counted and
+ * reported by the writer) or, with log_overflow = block, the caller waits
+ * for the writer to make room.
+ *
+ * @param level Severity
+ * @param format printf-style format
+ */
+void log_write(LogLevel level, const char* format, ...) {
+    if (!__atomic_load_n(&log_running, __ATOMIC_ACQUIRE)) return;
+
+    LogRing* ring = t_ring;
+    if (!ring) {
+        ring = t_ring = ring_create();
+        if (!ring) return;
+    }
+
+    unsigned head = ring->head;
+    while (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) > ring->mask) {
+        pthread_cond_signal(&log_wakeup);
+        if (!log_block || __atomic_load_n(&log_stopping, __ATOMIC_RELAXED)) {
+            __atomic_add_fetch(&ring->dropped, 1, __ATOMIC_RELAXED);
+            return;
+        }
+        sched_yield();
+    }
+
+    // The formatted second changes at most once per second per thread
     time_t now = time(NULL);
-    char timestamp[64];
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ",
-             gmtime(&now));
+    if (now != t_stamp_time) {
+        struct tm tm;
+        strftime(t_stamp, sizeof(t_stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime_r(&now, &tm));
+        t_stamp_time = now;
+    }
 
-    const char* level_str[] = {"DEBUG", "INFO", "WARN", "ERROR"};
+    LogSlot* slot = &ring->slots[head & ring->mask];
+    size_t cap = sizeof(slot->text) - 1;   // Keep room for the newline
+
+    int len = snprintf(slot->text, cap, "[%s] [%s] ", t_stamp, level_str[level]);
 
     va_list args;
     va_start(args, format);
+    int body = vsnprintf(slot->text + len, cap - (size_t)len, format, args);
+    va_end(args);
 
-    pthread_mutex_lock(&log_mutex);
-    fprintf(log_fp, "[%s] [%s] ", timestamp, level_str[level]);
-    vfprintf(log_fp, format, args);
-    fprintf(log_fp, "\n");
-    fflush(log_fp);
-    pthread_mutex_unlock(&log_mutex);
+    len += body < 0 ? 0 : body;
+    if ((size_t)len > cap - 1) len = (int)cap - 1;
+    slot->text[len++] = '\n';
+    slot->len = (uint32_t)len;
 
-    va_end(args);
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    // Wake the writer before the ring fills rather than after
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_RELAXED) == ring->mask / 2 ||
+        level == LOG_ERROR) {
+        pthread_cond_signal(&log_wakeup);
+    }
+}
+
+/**
+ * Asks the writer to reopen the log file
+ *
+ * For external rotation tools: after they rename server.log, the next
+ * batch goes to a new file under the original name. Safe to call from
+ * any thread; the reopen happens on the writer.
+ */
+void log_reopen(void) {
+    __atomic_store_n(&log_reopen_requested, 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&log_wakeup);
 }
 
+/**
+ * Flushes every queued line, stops the writer and closes the log file
+ *
+ * Waits for the housekeeper to finish compressing already rotated files.
+ *
+ * @note Lines logged after this call are discarded
+ */
 void log_close(void) {
-    pthread_mutex_lock(&log_mutex);
-    if (log_fp) {
-        fclose(log_fp);
-        log_fp = NULL;
+    if (!__atomic_load_n(&log_running, __ATOMIC_ACQUIRE)) return;
+
+    __atomic_store_n(&log_stopping, 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&log_wakeup);
+    pthread_join(log_writer, NULL);
+    __atomic_store_n(&log_running, 0, __ATOMIC_RELEASE);
+
+    if (housekeeper_running) {
+        pthread_mutex_lock(&job_mutex);
+        job_stopping = 1;
+        pthread_cond_signal(&job_wakeup);
+        pthread_mutex_unlock(&job_mutex);
+        pthread_join(log_housekeeper, NULL);
+        housekeeper_running = 0;
     }
-    pthread_mutex_unlock(&log_mutex);
-    pthread_mutex_destroy(&log_mutex);
+
+    // Threads still alive keep their t_ring pointer; leave the rings allocated
+    close(log_fd);
+    log_fd = -1;
+    free(log_path);
+    log_path = NULL;
+}
+
+/**
+ * Changes the lowest level that is written
+ *
+ * Takes effect immediately on every thread; lines already queued are
+ * still written.
+ *
+ * @param level New threshold
+ */
+void log_set_level(LogLevel level) {
+    __atomic_store_n(&g_log_level, (int)level, __ATOMIC_RELAXED);
+}
+
+int log_level_parse(const char* name) {
+    if (!name) return -1;
+    for (int i = 0; i < (int)(sizeof(level_str) / sizeof(level_str[0])); i++) {
+        if (strcasecmp(name, level_str[i]) == 0) return i;
+    }
+    return -1;
+}
+
+const char* log_level_name(LogLevel level) {
+    return (level >= LOG_DEBUG && level <= LOG_ERROR) ? level_str[level] : "UNKNOWN";
 }
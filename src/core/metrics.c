@@ -0,0 +1,429 @@
+#include "metrics.h"
+#include "connection.h"
+#include "hdr_histogram.h"
+#include "crypto_pool.h"
+#include "fd_cache.h"
+#include "prefetch.h"
+#include "thread_pool.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static const char* const method_names[] = {
+    "GET", "HEAD", "POST", "PUT", "DELETE", "OPTIONS", "other"
+};
+#define METHOD_COUNT (sizeof(method_names) / sizeof(method_names[0]))
+
+// Codes the server sends, each with its own series; anything else is
+// counted under its class ("1xx" ... "5xx")
+static const int status_codes[] = {
+    200, 204, 206, 301, 302, 304, 400, 401, 403, 404, 405, 408, 411, 413,
+    414, 416, 425, 429, 431, 500, 501, 503, 505
+};
+#define STATUS_LISTED (sizeof(status_codes) / sizeof(status_codes[0]))
+#define STATUS_COUNT  (STATUS_LISTED + 5)
+
+// Histogram bucket upper bounds in microseconds, exported in seconds
+static const uint64_t latency_bounds_us[] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000,
+    100000, 250000, 500000, 1000000, 2500000, 5000000, 10000000
+};
+#define BUCKET_COUNT (sizeof(latency_bounds_us) / sizeof(latency_bounds_us[0]) + 1)
+
+typedef struct {
+    uint64_t buckets[BUCKET_COUNT];     // Per bucket, not cumulative; last is +Inf
+    uint64_t sum_us;
+} Histogram;
+
+typedef struct MetricsShard {
+    uint64_t  requests[METHOD_COUNT][STATUS_COUNT];
+    uint64_t  bytes_sent;
+    uint64_t  cache_hits;
+    uint64_t  cache_misses;
+    uint64_t  handshakes[METRICS_HANDSHAKE_KINDS];
+    Histogram request_latency;
+    Histogram handshake_latency;
+    HdrHistogram* phases;           // [METRICS_ROUTES][METRICS_PHASES], allocated on first use
+    struct MetricsShard* next;
+} __attribute__((aligned(64))) MetricsShard;
+
+/* Shards are never freed: a thread that exits leaves its counts behind, so
+ * the exported counters never go backwards. */
+static MetricsShard*       g_shards = NULL;
+static pthread_mutex_t     g_shards_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ThreadPool*  g_pool = NULL;
+
+static __thread MetricsShard* t_shard = NULL;
+
+static const char* const route_names[METRICS_ROUTES] = { "static", "api", "post" };
+static const char* const phase_names[METRICS_PHASES] = {
+    "queue", "handshake", "parse", "route", "first_byte", "send", "total"
+};
+
+/* Only the owning thread writes a shard, so an increment needs no atomic
+ * read-modify-write; the relaxed store just keeps scrapes from tearing. */
+#define SHARD_ADD(field, n) __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+
+static MetricsShard* shard_get(void) {
+    if (t_shard) return t_shard;
+
+    MetricsShard* shard = aligned_alloc(64, sizeof(MetricsShard));
+    if (!shard) return NULL;
+    memset(shard, 0, sizeof(*shard));
+
+    pthread_mutex_lock(&g_shards_lock);
+    shard->next = g_shards;
+    g_shards = shard;
+    pthread_mutex_unlock(&g_shards_lock);
+
+    t_shard = shard;
+    return shard;
+}
+
+static unsigned method_index(const char* method) {
+    if (method) {
+        for (unsigned i = 0; i < METHOD_COUNT - 1; i++) {
+            if (strcmp(method, method_names[i]) == 0) return i;
+        }
+    }
+    return METHOD_COUNT - 1;
+}
+
+static unsigned status_index(int status) {
+    for (unsigned i = 0; i < STATUS_LISTED; i++) {
+        if (status_codes[i] == status) return i;
+    }
+    int cls = status / 100;
+    if (cls < 1 || cls > 5) cls = 5;
+    return STATUS_LISTED + (unsigned)(cls - 1);
+}
+
+static void histogram_add(Histogram* h, uint64_t us) {
+    unsigned i = 0;
+    while (i < BUCKET_COUNT - 1 && us > latency_bounds_us[i]) i++;
+    SHARD_ADD(h->buckets[i], 1);
+    SHARD_ADD(h->sum_us, us);
+}
+
+/**
+ * Remembers the worker pool whose queue is exported as a gauge
+ *
+ * @param pool Request worker pool (may be NULL)
+ */
+void metrics_init(struct ThreadPool* pool) {
+    g_pool = pool;
+}
+
+/**
+ * Counts a completed request
+ *
+ * @param method Request method (anything unknown is counted as "other")
+ * @param status Response status code
+ * @param bytes Bytes sent for the response
+ * @param latency_us Time from request read to response sent
+ */
+void metrics_record_request(const char* method, int status, uint64_t bytes, uint64_t latency_us) {
+    MetricsShard* shard = shard_get();
+    if (!shard) return;
+
+    SHARD_ADD(shard->requests[method_index(method)][status_index(status)], 1);
+    SHARD_ADD(shard->bytes_sent, bytes);
+    histogram_add(&shard->request_latency, latency_us);
+}
+
+/**
+ * Counts a static file lookup in the cache index
+ *
+ * @param hit Nonzero if the file was found
+ */
+void metrics_record_cache(int hit) {
+    MetricsShard* shard = shard_get();
+    if (!shard) return;
+
+    if (hit) SHARD_ADD(shard->cache_hits, 1);
+    else SHARD_ADD(shard->cache_misses, 1);
+}
+
+/**
+ * Counts a completed (or failed) TLS handshake
+ *
+ * @param kind Full, resumed or failed
+ * @param duration_us Time spent in the handshake
+ */
+void metrics_record_handshake(MetricsHandshake kind, uint64_t duration_us) {
+    MetricsShard* shard = shard_get();
+    if (!shard) return;
+
+    SHARD_ADD(shard->handshakes[kind], 1);
+    if (kind != METRICS_HANDSHAKE_FAILED) histogram_add(&shard->handshake_latency, duration_us);
+}
+
+/**
+ * Records the duration of one phase of a request
+ *
+ * @param route Route class the request was dispatched to
+ * @param phase Phase measured
+ * @param duration_us Its duration
+ */
+void metrics_record_phase(MetricsRoute route, MetricsPhase phase, uint64_t duration_us) {
+    MetricsShard* shard = shard_get();
+    if (!shard) return;
+
+    if (!shard->phases) {
+        // Published with a release store: a scrape may read it concurrently
+        HdrHistogram* phases = calloc(METRICS_ROUTES * METRICS_PHASES, sizeof(HdrHistogram));
+        if (!phases) return;
+        __atomic_store_n(&shard->phases, phases, __ATOMIC_RELEASE);
+    }
+    hdr_record(&shard->phases[route * METRICS_PHASES + phase], duration_us);
+}
+
+/* Sums every shard into total. Holds the list lock only, never a shard. */
+static void shards_sum(MetricsShard* total) {
+    memset(total, 0, sizeof(*total));
+
+    pthread_mutex_lock(&g_shards_lock);
+    for (MetricsShard* shard = g_shards; shard; shard = shard->next) {
+        for (unsigned m = 0; m < METHOD_COUNT; m++) {
+            for (unsigned s = 0; s < STATUS_COUNT; s++) {
+                total->requests[m][s] += __atomic_load_n(&shard->requests[m][s], __ATOMIC_RELAXED);
+            }
+        }
+        total->bytes_sent   += __atomic_load_n(&shard->bytes_sent, __ATOMIC_RELAXED);
+        total->cache_hits   += __atomic_load_n(&shard->cache_hits, __ATOMIC_RELAXED);
+        total->cache_misses += __atomic_load_n(&shard->cache_misses, __ATOMIC_RELAXED);
+        for (unsigned k = 0; k < METRICS_HANDSHAKE_KINDS; k++) {
+            total->handshakes[k] += __atomic_load_n(&shard->handshakes[k], __ATOMIC_RELAXED);
+        }
+        for (unsigned b = 0; b < BUCKET_COUNT; b++) {
+            total->request_latency.buckets[b] +=
+                __atomic_load_n(&shard->request_latency.buckets[b], __ATOMIC_RELAXED);
+            total->handshake_latency.buckets[b] +=
+                __atomic_load_n(&shard->handshake_latency.buckets[b], __ATOMIC_RELAXED);
+        }
+        total->request_latency.sum_us +=
+            __atomic_load_n(&shard->request_latency.sum_us, __ATOMIC_RELAXED);
+        total->handshake_latency.sum_us +=
+            __atomic_load_n(&shard->handshake_latency.sum_us, __ATOMIC_RELAXED);
+    }
+    pthread_mutex_unlock(&g_shards_lock);
+}
+
+void metrics_handshake_totals(unsigned long totals[METRICS_HANDSHAKE_KINDS]) {
+    memset(totals, 0, METRICS_HANDSHAKE_KINDS * sizeof(totals[0]));
+
+    pthread_mutex_lock(&g_shards_lock);
+    for (MetricsShard* shard = g_shards; shard; shard = shard->next) {
+        for (unsigned k = 0; k < METRICS_HANDSHAKE_KINDS; k++) {
+            totals[k] += __atomic_load_n(&shard->handshakes[k], __ATOMIC_RELAXED);
+        }
+    }
+    pthread_mutex_unlock(&g_shards_lock);
+}
+
+static void render_histogram(TextBuffer* buf, const char* name, const char* help,
+                             const Histogram* h) {
+    text_append(buf, "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+
+    uint64_t cumulative = 0;
+    for (unsigned b = 0; b < BUCKET_COUNT - 1; b++) {
+        cumulative += h->buckets[b];
+        text_append(buf, "%s_bucket{le=\"%g\"} %llu\n", name,
+                    (double)latency_bounds_us[b] / 1e6, (unsigned long long)cumulative);
+    }
+    cumulative += h->buckets[BUCKET_COUNT - 1];
+    text_append(buf, "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)cumulative);
+    text_append(buf, "%s_sum %.6f\n", name, (double)h->sum_us / 1e6);
+    text_append(buf, "%s_count %llu\n", name, (unsigned long long)cumulative);
+}
+
+char* metrics_render(size_t* len) {
+    // Too large for the stack of a worker thread
+    MetricsShard* total = malloc(sizeof(MetricsShard));
+    if (!total) return NULL;
+    shards_sum(total);
+
+    TextBuffer buf = { .data = malloc(16384), .len = 0, .cap = 16384, .failed = 0 };
+    if (!buf.data) {
+        free(total);
+        return NULL;
+    }
+
+    extern time_t g_server_start;
+    text_append(&buf, "# HELP snap_uptime_seconds Time since the server started.\n"
+                      "# TYPE snap_uptime_seconds gauge\n"
+                      "snap_uptime_seconds %ld\n", (long)(time(NULL) - g_server_start));
+
+    text_append(&buf, "# HELP snap_http_requests_total Requests answered, by method and status.\n"
+                      "# TYPE snap_http_requests_total counter\n");
+    for (unsigned m = 0; m < METHOD_COUNT; m++) {
+        for (unsigned s = 0; s < STATUS_COUNT; s++) {
+            uint64_t count = total->requests[m][s];
+            if (!count) continue;
+            if (s < STATUS_LISTED) {
+                text_append(&buf, "snap_http_requests_total{method=\"%s\",code=\"%d\"} %llu\n",
+                            method_names[m], status_codes[s], (unsigned long long)count);
+            } else {
+                text_append(&buf, "snap_http_requests_total{method=\"%s\",code=\"%uxx\"} %llu\n",
+                            method_names[m], s - (unsigned)STATUS_LISTED + 1,
+                            (unsigned long long)count);
+            }
+        }
+    }
+
+    text_append(&buf, "# HELP snap_http_response_bytes_total Bytes sent in responses.\n"
+                      "# TYPE snap_http_response_bytes_total counter\n"
+                      "snap_http_response_bytes_total %llu\n",
+                (unsigned long long)total->bytes_sent);
+
+    render_histogram(&buf, "snap_http_request_duration_seconds",
+                     "Time from parsed request to response sent.", &total->request_latency);
+
+    uint64_t lookups = total->cache_hits + total->cache_misses;
+    text_append(&buf, "# HELP snap_cache_lookups_total Static file lookups in the cache index.\n"
+                      "# TYPE snap_cache_lookups_total counter\n"
+                      "snap_cache_lookups_total{result=\"hit\"} %llu\n"
+                      "snap_cache_lookups_total{result=\"miss\"} %llu\n"
+                      "# HELP snap_cache_hit_ratio Share of cache lookups that hit.\n"
+                      "# TYPE snap_cache_hit_ratio gauge\n"
+                      "snap_cache_hit_ratio %.4f\n",
+                (unsigned long long)total->cache_hits, (unsigned long long)total->cache_misses,
+                lookups ? (double)total->cache_hits / (double)lookups : 0.0);
+
+    struct FdCacheStats fds;
+    fd_cache_get_stats(&fds);
+    text_append(&buf, "# HELP snap_fd_cache_opens_total Static file opens, served from the open-file cache or not.\n"
+                      "# TYPE snap_fd_cache_opens_total counter\n"
+                      "snap_fd_cache_opens_total{result=\"hit\"} %llu\n"
+                      "snap_fd_cache_opens_total{result=\"miss\"} %llu\n"
+                      "# HELP snap_fd_cache_entries Files held open by the open-file cache.\n"
+                      "# TYPE snap_fd_cache_entries gauge\n"
+                      "snap_fd_cache_entries %d\n",
+                (unsigned long long)fds.hits, (unsigned long long)fds.misses, fds.entries);
+
+    struct PrefetchStats pf;
+    prefetch_get_stats(&pf);
+    text_append(&buf, "# HELP snap_prefetch_windows_total Read-ahead windows advised for long sends.\n"
+                      "# TYPE snap_prefetch_windows_total counter\n"
+                      "snap_prefetch_windows_total{result=\"advised\"} %llu\n"
+                      "snap_prefetch_windows_total{result=\"dropped\"} %llu\n"
+                      "# HELP snap_prefetch_bytes_total Bytes covered by advised read-ahead windows.\n"
+                      "# TYPE snap_prefetch_bytes_total counter\n"
+                      "snap_prefetch_bytes_total %llu\n"
+                      "# HELP snap_prefetch_warmed_files_total Videos whose start was pre-warmed.\n"
+                      "# TYPE snap_prefetch_warmed_files_total counter\n"
+                      "snap_prefetch_warmed_files_total %llu\n",
+                (unsigned long long)pf.requests, (unsigned long long)pf.dropped,
+                (unsigned long long)pf.bytes, (unsigned long long)pf.warmed);
+
+    text_append(&buf, "# HELP snap_tls_handshakes_total TLS handshakes by outcome.\n"
+                      "# TYPE snap_tls_handshakes_total counter\n"
+                      "snap_tls_handshakes_total{result=\"full\"} %llu\n"
+                      "snap_tls_handshakes_total{result=\"resumed\"} %llu\n"
+                      "snap_tls_handshakes_total{result=\"failed\"} %llu\n",
+                (unsigned long long)total->handshakes[METRICS_HANDSHAKE_FULL],
+                (unsigned long long)total->handshakes[METRICS_HANDSHAKE_RESUMED],
+                (unsigned long long)total->handshakes[METRICS_HANDSHAKE_FAILED]);
+
+    render_histogram(&buf, "snap_tls_handshake_duration_seconds",
+                     "Duration of successful TLS handshakes.", &total->handshake_latency);
+
+    struct ThreadPoolStats pool = {0}, crypto = {0};
+    if (g_pool) threadpool_get_stats(g_pool, &pool);
+    crypto_pool_get_stats(&crypto);
+
+    text_append(&buf, "# HELP snap_connections_active Open client connections.\n"
+                      "# TYPE snap_connections_active gauge\n"
+                      "snap_connections_active %d\n"
+                      "# HELP snap_queue_depth Work items waiting for a thread.\n"
+                      "# TYPE snap_queue_depth gauge\n"
+                      "snap_queue_depth{pool=\"workers\"} %d\n"
+                      "snap_queue_depth{pool=\"crypto\"} %d\n"
+                      "# HELP snap_workers_busy Threads currently running a work item.\n"
+                      "# TYPE snap_workers_busy gauge\n"
+                      "snap_workers_busy{pool=\"workers\"} %d\n"
+                      "snap_workers_busy{pool=\"crypto\"} %d\n"
+                      "# HELP snap_queue_rejected_total Work refused because the queue was full.\n"
+                      "# TYPE snap_queue_rejected_total counter\n"
+                      "snap_queue_rejected_total{pool=\"workers\"} %d\n"
+                      "snap_queue_rejected_total{pool=\"crypto\"} %d\n"
+                      "# HELP snap_queue_shed_total Work dropped by CoDel after waiting too long.\n"
+                      "# TYPE snap_queue_shed_total counter\n"
+                      "snap_queue_shed_total{pool=\"workers\"} %d\n",
+                connection_count(),
+                pool.queued_work, crypto.queued_work,
+                pool.active_threads, crypto.active_threads,
+                pool.rejected_work, crypto.rejected_work,
+                pool.shed_work);
+
+    free(total);
+    if (buf.failed) {
+        free(buf.data);
+        return NULL;
+    }
+    if (len) *len = buf.len;
+    return buf.data;
+}
+
+char* metrics_render_latency(const char* route) {
+    int only = -1;
+    if (route) {
+        for (int r = 0; r < METRICS_ROUTES; r++) {
+            if (strcmp(route, route_names[r]) == 0) only = r;
+        }
+        if (only < 0) return NULL;
+    }
+
+    HdrHistogram* merged = calloc(METRICS_ROUTES * METRICS_PHASES, sizeof(HdrHistogram));
+    if (!merged) return NULL;
+
+    pthread_mutex_lock(&g_shards_lock);
+    for (MetricsShard* shard = g_shards; shard; shard = shard->next) {
+        HdrHistogram* phases = __atomic_load_n(&shard->phases, __ATOMIC_ACQUIRE);
+        if (!phases) continue;
+        for (int i = 0; i < METRICS_ROUTES * METRICS_PHASES; i++) {
+            hdr_merge(&merged[i], &phases[i]);
+        }
+    }
+    pthread_mutex_unlock(&g_shards_lock);
+
+    TextBuffer buf = { .data = malloc(8192), .len = 0, .cap = 8192, .failed = 0 };
+    if (!buf.data) {
+        free(merged);
+        return NULL;
+    }
+
+    text_append(&buf, "{\n  \"success\": true,\n  \"data\": {");
+    int first_route = 1;
+    for (int r = 0; r < METRICS_ROUTES; r++) {
+        if (only >= 0 && r != only) continue;
+
+        text_append(&buf, "%s\n    \"%s\": {", first_route ? "" : ",", route_names[r]);
+        first_route = 0;
+        for (int p = 0; p < METRICS_PHASES; p++) {
+            const HdrHistogram* h = &merged[r * METRICS_PHASES + p];
+            text_append(&buf,
+                "%s\n      \"%s\": {\"count\": %llu, \"mean_us\": %.1f, \"p50_us\": %llu, "
+                "\"p90_us\": %llu, \"p99_us\": %llu, \"p999_us\": %llu, \"max_us\": %llu}",
+                p ? "," : "", phase_names[p], (unsigned long long)h->total, hdr_mean(h),
+                (unsigned long long)hdr_percentile(h, 50.0),
+                (unsigned long long)hdr_percentile(h, 90.0),
+                (unsigned long long)hdr_percentile(h, 99.0),
+                (unsigned long long)hdr_percentile(h, 99.9),
+                (unsigned long long)h->max);
+        }
+        text_append(&buf, "\n    }");
+    }
+    text_append(&buf, "\n  }\n}");
+
+    free(merged);
+    if (buf.failed) {
+        free(buf.data);
+        return NULL;
+    }
+    return buf.data;
+}
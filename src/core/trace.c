@@ -0,0 +1,196 @@
+#include "trace.h"
+#include "logger.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_LABEL_SIZE 96
+
+typedef struct {
+    uint64_t trace_id;
+    uint64_t start_us;
+    uint32_t dur_us;
+    uint32_t worker;                    // Kernel thread id that recorded the span
+    uint16_t status;                    // Request span only
+    uint8_t  kind;
+    char     label[TRACE_LABEL_SIZE];   // Request span only: "<method> <path>"
+} TraceSpan;
+
+static const char* const span_names[TRACE_SPAN_KINDS] = {
+    "request", "queue", "handshake", "parse", "cache_lookup", "file_open", "first_byte", "send"
+};
+
+/* Spans are rare (only sampled requests write them), so one lock over the
+ * ring costs less than making every slot safe to read while written. */
+static pthread_mutex_t g_ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static TraceSpan* g_ring = NULL;
+static size_t     g_capacity = 0;
+static uint64_t   g_written = 0;        // Spans ever written; g_written % g_capacity is next
+
+static unsigned   g_sample_rate = 0;
+static uint64_t   g_last_trace_id = 0;
+
+/* Sampling draws from a per-thread generator rather than counting
+ * requests: a shared counter would put every request on one contended
+ * cache line, and per-thread counts would rarely fire with many idle
+ * workers. */
+static __thread uint64_t t_rng = 0;
+
+int trace_init(int capacity, int sample_rate) {
+    if (capacity <= 0) return 0;
+
+    g_ring = calloc((size_t)capacity, sizeof(TraceSpan));
+    if (!g_ring) {
+        log_message(LOG_ERROR, "Failed to allocate %d trace spans", capacity);
+        return -1;
+    }
+    g_capacity = (size_t)capacity;
+    g_sample_rate = sample_rate > 0 ? (unsigned)sample_rate : 0;
+
+    if (g_sample_rate) {
+        log_message(LOG_INFO, "Tracing 1 in %u requests into %d spans", g_sample_rate, capacity);
+    }
+    return 0;
+}
+
+void trace_shutdown(void) {
+    pthread_mutex_lock(&g_ring_lock);
+    free(g_ring);
+    g_ring = NULL;
+    g_capacity = 0;
+    g_written = 0;
+    pthread_mutex_unlock(&g_ring_lock);
+}
+
+// xorshift64*, seeded from the thread id and the clock on first use
+static uint64_t next_random(void) {
+    if (!t_rng) t_rng = (monotonic_us() << 20) ^ (uint32_t)current_tid() ^ 0x9e3779b97f4a7c15ULL;
+    t_rng ^= t_rng >> 12;
+    t_rng ^= t_rng << 25;
+    t_rng ^= t_rng >> 27;
+    return t_rng * 0x2545f4914f6cdd1dULL;
+}
+
+uint64_t trace_sample(int requested) {
+    if (!g_ring) return 0;
+
+    int sampled = requested || (g_sample_rate && next_random() % g_sample_rate == 0);
+    if (!sampled) return 0;
+
+    return __atomic_add_fetch(&g_last_trace_id, 1, __ATOMIC_RELAXED);
+}
+
+static TraceSpan* ring_slot(void) {
+    TraceSpan* span = &g_ring[g_written % g_capacity];
+    g_written++;
+    return span;
+}
+
+void trace_span(uint64_t trace_id, TraceSpanKind kind, uint64_t start_us, uint64_t end_us) {
+    if (!trace_id || !g_ring) return;
+    uint32_t worker = (uint32_t)current_tid();
+
+    pthread_mutex_lock(&g_ring_lock);
+    if (g_ring) {
+        TraceSpan* span = ring_slot();
+        span->trace_id = trace_id;
+        span->start_us = start_us;
+        span->dur_us   = end_us > start_us ? (uint32_t)(end_us - start_us) : 0;
+        span->worker   = worker;
+        span->status   = 0;
+        span->kind     = (uint8_t)kind;
+        span->label[0] = '\0';
+    }
+    pthread_mutex_unlock(&g_ring_lock);
+}
+
+void trace_request(uint64_t trace_id, uint64_t start_us, uint64_t end_us,
+                   const char* method, const char* path, int status) {
+    if (!trace_id || !g_ring) return;
+    uint32_t worker = (uint32_t)current_tid();
+
+    pthread_mutex_lock(&g_ring_lock);
+    if (g_ring) {
+        TraceSpan* span = ring_slot();
+        span->trace_id = trace_id;
+        span->start_us = start_us;
+        span->dur_us   = end_us > start_us ? (uint32_t)(end_us - start_us) : 0;
+        span->worker   = worker;
+        span->status   = (uint16_t)status;
+        span->kind     = TRACE_SPAN_REQUEST;
+        snprintf(span->label, sizeof(span->label), "%s %s",
+                 method ? method : "-", path ? path : "-");
+    }
+    pthread_mutex_unlock(&g_ring_lock);
+}
+
+void trace_clear(void) {
+    pthread_mutex_lock(&g_ring_lock);
+    g_written = 0;
+    pthread_mutex_unlock(&g_ring_lock);
+}
+
+/* Each trace gets its own row (tid = trace id), named after its request,
+ * so overlapping requests from different workers never nest into each
+ * other. The worker that recorded a span is kept in its args. */
+char* trace_render(void) {
+    TraceSpan* spans = NULL;
+    size_t count = 0;
+
+    // Copy out so rendering does not hold up workers recording spans
+    pthread_mutex_lock(&g_ring_lock);
+    if (g_ring) {
+        count = g_written < g_capacity ? (size_t)g_written : g_capacity;
+        spans = malloc((count ? count : 1) * sizeof(TraceSpan));
+        if (spans) {
+            size_t oldest = g_written < g_capacity ? 0 : g_written % g_capacity;
+            for (size_t i = 0; i < count; i++) {
+                spans[i] = g_ring[(oldest + i) % g_capacity];
+            }
+        }
+    }
+    pthread_mutex_unlock(&g_ring_lock);
+
+    TextBuffer buf = { .data = malloc(8192 + count * 160), .len = 0, .cap = 8192 + count * 160 };
+    if (!buf.data || (count && !spans)) {
+        free(buf.data);
+        free(spans);
+        return NULL;
+    }
+
+    text_append(&buf, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+    for (size_t i = 0; i < count; i++) {
+        const TraceSpan* s = &spans[i];
+        const char* sep = i ? "," : "";
+
+        if (s->kind == TRACE_SPAN_REQUEST) {
+            text_append(&buf, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+                        "\"tid\": %llu, \"args\": {\"name\": \"", sep,
+                        (unsigned long long)s->trace_id);
+            text_append_json(&buf, s->label);
+            text_append(&buf, "\"}},\n{\"name\": \"");
+            text_append_json(&buf, s->label);
+            text_append(&buf, "\", \"cat\": \"request\", \"ph\": \"X\", \"pid\": 1, \"tid\": %llu, "
+                        "\"ts\": %llu, \"dur\": %u, \"args\": {\"status\": %u, \"worker\": %u}}",
+                        (unsigned long long)s->trace_id, (unsigned long long)s->start_us,
+                        s->dur_us, s->status, s->worker);
+        } else {
+            text_append(&buf, "%s\n{\"name\": \"%s\", \"cat\": \"phase\", \"ph\": \"X\", \"pid\": 1, "
+                        "\"tid\": %llu, \"ts\": %llu, \"dur\": %u, \"args\": {\"worker\": %u}}",
+                        sep, span_names[s->kind < TRACE_SPAN_KINDS ? s->kind : 0],
+                        (unsigned long long)s->trace_id, (unsigned long long)s->start_us,
+                        s->dur_us, s->worker);
+        }
+    }
+    text_append(&buf, "\n]}\n");
+
+    free(spans);
+    if (buf.failed) {
+        free(buf.data);
+        return NULL;
+    }
+    return buf.data;
+}
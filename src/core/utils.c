@@ -1,5 +1,8 @@
 #include "utils.h"
 #include <ctype.h>
+#include <stdarg.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 
 /**
  * Gets the current time added to by an offset. 
@@ -23,6 +26,60 @@ char* get_time(int offset)
     return str;
 }
 
+uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+int current_tid(void)
+{
+    static __thread int tid = 0;
+    if (!tid) tid = (int)syscall(SYS_gettid);
+    return tid;
+}
+
+void text_append(TextBuffer* buf, const char* format, ...)
+{
+    if (buf->failed) return;
+
+    for (;;) {
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buf->data + buf->len, buf->cap - buf->len, format, args);
+        va_end(args);
+
+        if (n < 0) {
+            buf->failed = 1;
+            return;
+        }
+        if ((size_t)n < buf->cap - buf->len) {
+            buf->len += (size_t)n;
+            return;
+        }
+
+        size_t cap = buf->cap * 2 + (size_t)n;
+        char* grown = realloc(buf->data, cap);
+        if (!grown) {
+            buf->failed = 1;
+            return;
+        }
+        buf->data = grown;
+        buf->cap = cap;
+    }
+}
+
+void text_append_json(TextBuffer* buf, const char* s)
+{
+    for (; s && *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') text_append(buf, "\\%c", c);
+        else if (c < 0x20) text_append(buf, "\\u%04x", c);
+        else text_append(buf, "%c", c);
+    }
+}
+
 void url_decode(char* dst, const char* src, size_t dst_size)
 {
     if (!dst || !src || dst_size == 0) return;
@@ -61,7 +118,12 @@ char* get_query_param(Client* client, const char* key)
     char search_key[128];
     snprintf(search_key, sizeof(search_key), "%s=", key);
 
+    /* The key must start a parameter, so "page=" does not match inside
+     * "per_page=". */
     char* param_start = strstr(query_start, search_key);
+    while (param_start && param_start != query_start && param_start[-1] != '&') {
+        param_start = strstr(param_start + 1, search_key);
+    }
     if (!param_start) {
         return NULL;
     }
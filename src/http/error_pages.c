@@ -16,12 +16,15 @@ typedef struct {
     size_t len;
 } ErrorPage;
 
-static ErrorPage g_pages[NUM_KNOWN_CODES];
-static int       g_page_count = 0;
+struct ErrorPages {
+    ErrorPage pages[NUM_KNOWN_CODES];
+    int       count;
+};
 
-void error_pages_init(const char* webroot)
+ErrorPages* error_pages_init(const char* webroot)
 {
-    g_page_count = 0;
+    ErrorPages* set = calloc(1, sizeof(*set));
+    if (!set) return NULL;
 
     for (int i = 0; i < NUM_KNOWN_CODES; i++) {
         char path[512];
@@ -45,31 +48,35 @@ void error_pages_init(const char* webroot)
 
         buf[n] = '\0';
 
-        g_pages[g_page_count].code    = KNOWN_CODES[i];
-        g_pages[g_page_count].content = buf;
-        g_pages[g_page_count].len     = n;
-        g_page_count++;
+        set->pages[set->count].code    = KNOWN_CODES[i];
+        set->pages[set->count].content = buf;
+        set->pages[set->count].len     = n;
+        set->count++;
 
-        log_message(LOG_INFO, "Loaded error page %d (%zu bytes)", KNOWN_CODES[i], n);
+        log_message(LOG_INFO, "Loaded error page %d from %s (%zu bytes)", KNOWN_CODES[i], webroot, n);
     }
+    return set;
 }
 
-const char* error_pages_get(int code, size_t* out_len)
+const char* error_pages_get(const ErrorPages* pages, int code, size_t* out_len)
 {
-    for (int i = 0; i < g_page_count; i++) {
-        if (g_pages[i].code == code) {
-            if (out_len) *out_len = g_pages[i].len;
-            return g_pages[i].content;
+    if (!pages) return NULL;
+
+    for (int i = 0; i < pages->count; i++) {
+        if (pages->pages[i].code == code) {
+            if (out_len) *out_len = pages->pages[i].len;
+            return pages->pages[i].content;
         }
     }
     return NULL;
 }
 
-void error_pages_free(void)
+void error_pages_free(ErrorPages* pages)
 {
-    for (int i = 0; i < g_page_count; i++) {
-        free(g_pages[i].content);
-        g_pages[i].content = NULL;
+    if (!pages) return;
+
+    for (int i = 0; i < pages->count; i++) {
+        free(pages->pages[i].content);
     }
-    g_page_count = 0;
+    free(pages);
 }
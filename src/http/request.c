@@ -1,6 +1,7 @@
 #include "request.h"
 #include "response.h"
 #include "logger.h"
+#include "fd_cache.h"
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -12,9 +13,8 @@ static void parse_range_header(Client* client, char* range_value);
 /**
  * Parses an HTTP/S request and creates a Client object
  *
- * Parses the request line (method, path, version) and all headers from a raw
- * HTTP/S request string. Validates the HTTP version and required headers,
- * returning a fully initialized Client structure.
+ * Allocating wrapper around parse_http_request_into() for callers that do
+ * not own a Client of their own.
  *
  * @param raw_request Raw HTTP request string received from the client
  * @param client_fd File descriptor for the client socket
@@ -22,11 +22,9 @@ static void parse_range_header(Client* client, char* range_value);
  *
  * @return Pointer to initialized Client structure, or NULL on error
  *
- * @note Returns NULL for: allocation failure, empty/malformed requests,
- *       unsupported HTTP versions, or missing required headers
- * @warning Caller must free the returned Client structure and all its members
+ * @warning Caller must free the returned Client with free_client()
  *
- * @see parse_header_line()
+ * @see parse_http_request_into()
  */
 Client* parse_http_request(char* raw_request, int client_fd, SSL* ssl) {
     // Allocate client structure
@@ -35,9 +33,38 @@ Client* parse_http_request(char* raw_request, int client_fd, SSL* ssl) {
         log_message(LOG_ERROR, "Failed to allocate client structure");
         return NULL;
     }
+
+    if (parse_http_request_into(client, raw_request, client_fd, ssl) < 0) {
+        free(client);
+        return NULL;
+    }
+    return client;
+}
+
+/**
+ * Parses an HTTP/S request into an existing Client
+ *
+ * Parses the request line (method, path, version) and all headers from a raw
+ * HTTP/S request string. Validates the HTTP version and required headers.
+ * The Client is typically the one embedded in the connection's slot, so no
+ * per-request Client allocation is needed.
+ *
+ * @param client Client to fill; must be empty (zeroed or client_reset())
+ * @param raw_request Raw HTTP request string received from the client
+ * @param client_fd File descriptor for the client socket
+ * @param ssl SSL structure for HTTPS connections, or NULL for HTTP
+ *
+ * @return 0 on success, -1 on error (an error response has been sent and
+ *         the client has been reset)
+ *
+ * @note Fails for: empty/malformed requests, unsupported HTTP versions,
+ *       or missing required headers
+ * @warning Caller must release the fields with client_reset()
+ *
+ * @see parse_header_line(), client_reset()
+ */
+int parse_http_request_into(Client* client, char* raw_request, int client_fd, SSL* ssl) {
     client->content_length = -1;  /* -1 = header not present */
-    client->fd = -1;
-    
     client->client_fd = client_fd;
     client->fd = -1;  // No file open yet
     
@@ -74,9 +101,8 @@ Client* parse_http_request(char* raw_request, int client_fd, SSL* ssl) {
     if (!line) {
         log_message(LOG_WARN, "Empty HTTP request");
         send_error_response(400, client);
-        free(client->body);
-        free(client);
-        return NULL;
+        client_reset(client);
+        return -1;
     }
 
     // Parse: METHOD PATH VERSION
@@ -89,9 +115,8 @@ Client* parse_http_request(char* raw_request, int client_fd, SSL* ssl) {
     if (!raw_method || !raw_path || !raw_version) {
         log_message(LOG_WARN, "Malformed request line");
         send_error_response(400, client);
-        free(client->body);
-        free(client);
-        return NULL;
+        client_reset(client);
+        return -1;
     }
 
     client->method  = strdup(raw_method);
@@ -106,12 +131,8 @@ Client* parse_http_request(char* raw_request, int client_fd, SSL* ssl) {
     } else {
         log_message(LOG_WARN, "Unsupported HTTP version: %s", client->version);
         send_error_response(505, client);
-        free(client->method);
-        free(client->path);
-        free(client->version);
-        free(client->body);
-        free(client);
-        return NULL;
+        client_reset(client);
+        return -1;
     }
     
     // Parse headers
@@ -123,11 +144,11 @@ Client* parse_http_request(char* raw_request, int client_fd, SSL* ssl) {
     if (strcmp(client->version, "HTTP/1.1") == 0 && !client->host) {
         log_message(LOG_WARN, "Missing Host header in HTTP/1.1 request");
         send_error_response(400, client);
-        free_client(client);
-        return NULL;
+        client_reset(client);
+        return -1;
     }
     
-    return client;
+    return 0;
 }
 
 /**
@@ -199,6 +220,9 @@ static void parse_header_line(Client* client, char* line) {
     else if (strncasecmp(line, "Content-Length: ", 16) == 0) {
         client->content_length = strtol(line + 16, NULL, 10);
     }
+    else if (strncasecmp(line, "X-Trace: ", 9) == 0) {
+        client->trace_requested = (line[9] == '1') ? 1 : 0;
+    }
     else if (strncasecmp(line, "Cookie: ", 8) == 0) {
         // Extract the "session" cookie value from the Cookie header
         char* sv = strstr(line + 8, "session=");
@@ -339,27 +363,31 @@ char* resolve_request_path(const char* request_path, const char* webroot) {
 }
 
 /**
- * Frees all client struct data.
+ * Releases everything a parsed request owns and empties the Client.
  *
- * Frees client struct and closes the client socket. Also frees
- * path data returned from resolve_request_path().
+ * Releases the requested file (back to the open-file cache when it came
+ * from there) and frees the strings strdup'd by
+ * parse_http_request_into() and resolve_request_path(). The Client itself
+ * is not freed, so the same struct can hold the next request on the
+ * connection.
  *
- * @param request_path Client requested path.
- * @param webroot Path where web files are stored.
+ * @param client Client to reset (safe to call on an already-empty Client)
  *
- * @note Other client struct data is freed elsewhere.
+ * @note The client socket is not closed; it belongs to the connection.
  */
-void free_client(Client* client) {
+void client_reset(Client* client) {
     if (!client) return;
 
-    if (client->fd >= 0) {
+    if (client->file) {
+        fd_cache_release(client->file);
+    } else if (client->fd >= 0) {
         close(client->fd);
     }
 
     free(client->full_path);
     free(client->client_ip);
 
-    // These are all strdup'd in parse_http_request / parse_header_line
+    // These are all strdup'd in parse_http_request_into / parse_header_line
     free(client->method);
     free(client->path);
     free(client->version);
@@ -375,6 +403,25 @@ void free_client(Client* client) {
     free(client->post_type);
     free(client->session_token);
 
+    memset(client, 0, sizeof(*client));
+    client->fd = -1;
+    client->content_length = -1;
+}
+
+/**
+ * Frees all client struct data.
+ *
+ * Frees a Client allocated by parse_http_request(). Closes the requested
+ * file but not the client socket.
+ *
+ * @param client Client to free
+ *
+ * @see client_reset()
+ */
+void free_client(Client* client) {
+    if (!client) return;
+
+    client_reset(client);
     free(client);
 }
 
@@ -390,7 +437,7 @@ void free_client(Client* client) {
  * not have been initialzed by the client.
  */
 void print_client_info(const Client* client) {
-    if (!client) return;
+    if (!client || !log_enabled(LOG_DEBUG)) return;
 
     log_message(LOG_DEBUG, "=== Client Request ===");
     log_message(LOG_DEBUG, "%s %s %s", client->method, client->path, client->version);
@@ -1,7 +1,14 @@
 #include "response.h"
-#include "error_pages.h"
+#include "vhost.h"
 #include "logger.h"
 #include "node.h"
+#include "io_engine.h"
+#include "ssl_handler.h"
+#include "file_map.h"
+#include "fd_cache.h"
+#include "prefetch.h"
+#include "media_index.h"
+#include "mp4.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -15,31 +22,228 @@
 #define MAX_HEADER_SIZE 8192
 #define BUFFER_SIZE 65536
 
+// Sends at least this long have the prefetcher read ahead of them
+#define READAHEAD_MIN_SEND (1024 * 1024)
+
+/* (Re)starts the write-stall deadline; called before every blocking write so
+ * the timer measures time without progress, not total transfer time. */
+static void arm_write_timer(Client* client)
+{
+    extern struct ServerConfig g_config;
+    if (client->conn) {
+        client->conn->state = CONN_WRITING;
+        timer_arm(&client->conn->timer, TIMER_WRITE, (unsigned)g_config.write_timeout * 1000);
+    }
+}
+
+/* Accounts bytes written to the connection's statistics and stamps the
+ * first write of the response. */
+static void count_bytes_out(Client* client, ssize_t n)
+{
+    if (client->conn && n > 0) {
+        if (!client->conn->first_byte_us) client->conn->first_byte_us = monotonic_us();
+        client->conn->bytes_out += (uint64_t)n;
+    }
+}
+
 /* Send all bytes, retrying on partial writes. Returns 0 on success, -1 on error. */
 static int send_all(Client* client, const void* buf, size_t len)
 {
     const char* p = (const char*)buf;
     while (len > 0) {
         ssize_t n;
+        arm_write_timer(client);
         if (client->is_ssl) {
-            n = SSL_write(client->ssl, p, (int)len);
+            n = ssl_write_data(client->ssl, p, (int)len);
             if (n <= 0) {
                 log_message(LOG_WARN, "SSL_write failed: %d", SSL_get_error(client->ssl, (int)n));
                 return -1;
             }
         } else {
-            n = send(client->client_fd, p, len, MSG_NOSIGNAL);
+            n = io_send(client->client_fd, p, len);
             if (n < 0) {
                 log_message(LOG_WARN, "send() failed: %s", strerror(errno));
                 return -1;
             }
         }
+        count_bytes_out(client, n);
         p   += n;
         len -= (size_t)n;
     }
     return 0;
 }
 
+/* Sends [start, start + length) of a mapped file over TLS. SSL_write
+ * encrypts straight from the page cache, so there is no read() and no
+ * copy into a bounce buffer. Large sends keep the prefetcher one window
+ * ahead, so a seek into a cold part of a video does not stall on every
+ * page fault. Returns 0, 1 if the client went away, -1 on error. */
+static int send_mapped(Client* client, const FileMap* map, size_t start, size_t length)
+{
+    size_t sent = 0;
+    size_t advised = start;
+    size_t window = length >= READAHEAD_MIN_SEND ? prefetch_window() : 0;
+
+    while (sent < length) {
+        size_t offset = start + sent;
+        if (window && offset + window / 2 >= advised) {
+            prefetch_file(client->file, (off_t)advised, window);
+            advised += window;
+        }
+
+        size_t chunk = length - sent > BUFFER_SIZE ? BUFFER_SIZE : length - sent;
+        arm_write_timer(client);
+        int n = ssl_write_data(client->ssl, map->data + offset, (int)chunk);
+        if (n <= 0) {
+            if (errno == ECONNRESET || errno == EPIPE) {
+                log_message(LOG_INFO, "Client disconnected (sent %zu/%zu bytes)", sent, length);
+                return 1;
+            }
+            log_message(LOG_WARN, "SSL_write failed: %d", SSL_get_error(client->ssl, n));
+            return -1;
+        }
+        count_bytes_out(client, n);
+        sent += (size_t)n;
+    }
+
+    log_message(LOG_INFO, "Sent %zu mapped bytes (status %d)", sent, client->status);
+    return 0;
+}
+
+/* Sends [start, start + length) of client->fd with positioned reads,
+ * through io_uring when the worker has a ring. Returns 0 when done (or at
+ * an early EOF), 1 if the client went away, -1 on a send error. */
+static int send_file_range(Client* client, off_t start, off_t length)
+{
+    /* Send file content. The fd may be shared with other workers through
+     * the open-file cache, so every read is positioned; the file offset is
+     * never used. */
+    off_t position = start;
+    char buffer[BUFFER_SIZE];
+    off_t remaining = length;
+    off_t total_sent = 0;
+
+    /* Long sends keep the prefetcher between half a window and a window
+     * ahead of position, so a seek does not wait on the disk per chunk. */
+    size_t window = length >= READAHEAD_MIN_SEND ? prefetch_window() : 0;
+    off_t advised = start;
+
+    /* With io_uring each chunk is one linked read->send submission, using the
+     * worker's registered buffer instead of this stack buffer. */
+    int use_uring = !client->is_ssl && io_uring_ready();
+    
+    while (remaining > 0) {
+        int size_to_read = (remaining > BUFFER_SIZE) ? BUFFER_SIZE : remaining;
+
+        if (window && position + (off_t)(window / 2) >= advised) {
+            prefetch_file(client->file, advised, window);
+            advised += (off_t)window;
+        }
+
+        if (use_uring) {
+            arm_write_timer(client);
+            ssize_t moved = io_file_to_socket(client->fd, client->client_fd, position,
+                                              (size_t)size_to_read);
+            if (moved == 0) break;
+            if (moved < 0) {
+                if (errno == EINTR) continue;
+                if (errno == ECONNRESET || errno == EPIPE) {
+                    log_message(LOG_INFO, "Client disconnected (sent %ld/%ld bytes)",
+                               total_sent, length);
+                    return 1;
+                }
+                log_message(LOG_ERROR, "Send failed: %s", strerror(errno));
+                return -1;
+            }
+            count_bytes_out(client, moved);
+            position += moved;
+            remaining -= moved;
+            total_sent += moved;
+            continue;
+        }
+        
+        ssize_t bytes_read = pread(client->fd, buffer, size_to_read, position);
+        if (bytes_read <= 0) {
+            if (bytes_read < 0 && errno == EINTR) continue;
+            break;
+        }
+        
+        /* Inner loop: send all bytes_read bytes before the next pread().
+         * Without this, a short write would move position past unsent
+         * bytes, causing a gap in the response. EINTR is retried; EPIPE/ECONNRESET
+         * indicate a client disconnect, which is normal for video seeking. */
+        ssize_t write_offset = 0;
+        while (write_offset < bytes_read) {
+            ssize_t bytes_sent;
+            arm_write_timer(client);
+            if (client->is_ssl) {
+                bytes_sent = ssl_write_data(client->ssl, buffer + write_offset, bytes_read - write_offset);
+            } else {
+                bytes_sent = io_send(client->client_fd, buffer + write_offset, bytes_read - write_offset);
+            }
+
+            if (bytes_sent <= 0) {
+                if (errno == EINTR) continue;
+                if (errno == ECONNRESET || errno == EPIPE) {
+                    log_message(LOG_INFO, "Client disconnected (sent %ld/%ld bytes)",
+                               total_sent, length);
+                    return 1;
+                }
+                log_message(LOG_ERROR, "Send failed: %s", strerror(errno));
+                return -1;
+            }
+            count_bytes_out(client, bytes_sent);
+            write_offset += bytes_sent;
+        }
+
+        position += bytes_read;
+        remaining -= bytes_read;
+        total_sent += bytes_read;
+    }
+    
+    log_message(LOG_INFO, "Sent %ld bytes (status %d)", total_sent, client->status);
+    return 0;
+}
+
+// File bytes, from the shared mapping when there is one
+static int send_body(Client* client, const FileMap* map, off_t start, off_t length)
+{
+    if (map) return send_mapped(client, map, (size_t)start, (size_t)length);
+    return send_file_range(client, start, length);
+}
+
+/* Faststart view of the requested file, if the media index has one and
+ * the open file is still the one it was built from. The view lives in
+ * the host's media index, which stays put while the cache lock is held. */
+static const Mp4Faststart* faststart_view(Client* client, const struct stat* st)
+{
+    if (!client->vhost || !client->vhost->media) return NULL;
+
+    const Mp4Faststart* view = media_index_faststart(client->vhost->media, client->full_path);
+    if (!view || !mp4_faststart_matches(view, st)) return NULL;
+    return view;
+}
+
+/* Sends a range of a faststart view: the patched moov from memory, every
+ * other piece from the file at its original offset. */
+static int send_faststart(Client* client, const Mp4Faststart* view, const FileMap* map,
+                          off_t start, off_t length)
+{
+    Mp4Segment segments[MP4_MAX_SEGMENTS];
+    int count = mp4_faststart_segments(view, start, length, segments);
+
+    for (int i = 0; i < count; i++) {
+        int rc;
+        if (segments[i].data) {
+            rc = send_all(client, segments[i].data, (size_t)segments[i].length);
+        } else {
+            rc = send_body(client, map, segments[i].file_offset, segments[i].length);
+        }
+        if (rc != 0) return rc;
+    }
+    return 0;
+}
+
 /**
  * Sends a complete file response with proper HTTP headers
  *
@@ -56,9 +260,11 @@ static int send_all(Client* client, const void* buf, size_t len)
  * @return 0 on success, -1 on error
  *
  * @note Handles range request validation and sends 416 if range is invalid
+ * @note Over TLS, cached files can be sent from a shared mapping (tls_mmap)
  * @note Gracefully handles client disconnections during transfer (ECONNRESET)
  * @note For HEAD requests, only headers are sent (no file content)
- * @warning Requires client->fd to be a valid open file descriptor
+ * @warning Requires client->fd to be a valid open file descriptor, read
+ *          only with positioned I/O (it may be shared via the fd cache)
  *
  * @see send_error_response(), mime_get_type_from_filename()
  */
@@ -68,16 +274,18 @@ int send_file_response(Client* client, struct Node* cache_node) {
         return -1;
     }
 
-    // Get file metadata — fstat when fd is open (GET), stat for HEAD
+    // Get file metadata — cached with the open file, else fstat/stat
     struct stat st;
-    if (client->fd >= 0) {
+    if (client->file) {
+        st = client->file->st;
+    } else if (client->fd >= 0) {
         if (fstat(client->fd, &st) < 0) {
             log_message(LOG_ERROR, "fstat failed: %s", strerror(errno));
             send_error_response(500, client);
             return -1;
         }
     } else {
-        // HEAD request: fd intentionally not opened
+        // No file opened for this request
         if (stat(client->full_path, &st) < 0) {
             log_message(LOG_ERROR, "stat failed: %s", strerror(errno));
             send_error_response(500, client);
@@ -134,6 +342,7 @@ int send_file_response(Client* client, struct Node* cache_node) {
         header_len += snprintf(headers + header_len, MAX_HEADER_SIZE - header_len,
                               "%s 200 OK\r\n", client->version);
     }
+    client->status = is_partial ? 206 : 200;
     
     extern ht* mime_table;
 
@@ -185,6 +394,11 @@ int send_file_response(Client* client, struct Node* cache_node) {
     header_len += snprintf(headers + header_len, MAX_HEADER_SIZE - header_len, "\r\n");
     
     free(current_date);
+
+    int head_only = strcmp(client->method, "HEAD") == 0;
+    if (client->conn) {
+        client->conn->response_total = (uint64_t)header_len + (head_only ? 0 : (uint64_t)content_length);
+    }
     
     // Send headers
     if (send_all(client, headers, header_len) < 0) {
@@ -193,64 +407,27 @@ int send_file_response(Client* client, struct Node* cache_node) {
     }
     
     // For HEAD requests, stop here
-    if (strcmp(client->method, "HEAD") == 0) {
+    if (head_only) {
         log_message(LOG_INFO, "HEAD request - headers only");
         return 0;
     }
     
-    // Send file content
-    if (lseek(client->fd, start, SEEK_SET) < 0) {
-        log_message(LOG_ERROR, "lseek failed: %s", strerror(errno));
-        return -1;
+    extern struct ServerConfig g_config;
+    FileMap* map = NULL;
+    if (client->is_ssl && g_config.tls_mmap && cache_node) {
+        map = file_map_acquire(cache_node, client->fd, &st);
     }
-    
-    char buffer[BUFFER_SIZE];
-    off_t remaining = content_length;
-    off_t total_sent = 0;
-    
-    while (remaining > 0) {
-        int size_to_read = (remaining > BUFFER_SIZE) ? BUFFER_SIZE : remaining;
-        
-        ssize_t bytes_read = read(client->fd, buffer, size_to_read);
-        if (bytes_read <= 0) {
-            if (bytes_read < 0 && errno == EINTR) continue;
-            break;
-        }
-        
-        /* Inner loop: send all bytes_read bytes before the next read().
-         * Without this, a short write advances the file fd past unsent bytes,
-         * causing a gap in the response. EINTR is retried; EPIPE/ECONNRESET
-         * indicate a client disconnect, which is normal for video seeking. */
-        ssize_t write_offset = 0;
-        while (write_offset < bytes_read) {
-            ssize_t bytes_sent;
-            if (client->is_ssl) {
-                bytes_sent = SSL_write(client->ssl, buffer + write_offset, bytes_read - write_offset);
-            } else {
-                bytes_sent = send(client->client_fd, buffer + write_offset, bytes_read - write_offset, 0);
-            }
-
-            if (bytes_sent <= 0) {
-                if (errno == EINTR) continue;
-                if (errno == ECONNRESET || errno == EPIPE) {
-                    log_message(LOG_INFO, "Client disconnected (sent %ld/%ld bytes)",
-                               total_sent, content_length);
-                    return 0;
-                }
-                log_message(LOG_ERROR, "Send failed: %s", strerror(errno));
-                return -1;
-            }
-            write_offset += bytes_sent;
-        }
 
-        remaining -= bytes_read;
-        total_sent += bytes_read;
+    int rc;
+    const Mp4Faststart* view = faststart_view(client, &st);
+    if (view) {
+        rc = send_faststart(client, view, map, start, content_length);
+    } else {
+        rc = send_body(client, map, start, content_length);
     }
-    
-    log_message(LOG_INFO, "Sent %ld bytes (status %d)", 
-               total_sent, is_partial ? 206 : 200);
-    
-    return 0;
+
+    file_map_release(map);
+    return rc < 0 ? -1 : 0;
 }
 
 /**
@@ -274,6 +451,7 @@ int send_file_response(Client* client, struct Node* cache_node) {
  */
 int send_error_response(int status_code, Client* client) {
     if (!client) return -1;
+    client->status = status_code;
 
     const char* status_msg = get_status_message(status_code);
     char* current_date = get_current_http_date();
@@ -283,7 +461,9 @@ int send_error_response(int status_code, Client* client) {
     const char* body;
     char        fallback[512];
 
-    body = error_pages_get(status_code, &body_len);
+    // Requests that failed before a host was picked get the default pages
+    const VirtualHost* vhost = client->vhost ? client->vhost : vhost_default();
+    body = error_pages_get(vhost->error_pages, status_code, &body_len);
     if (!body) {
         body_len = (size_t)snprintf(fallback, sizeof(fallback),
             "<html><head><title>%d %s</title></head>"
@@ -319,6 +499,101 @@ int send_error_response(int status_code, Client* client) {
     return 0;
 }
 
+/**
+ * Sends a 503 Service Unavailable response with a Retry-After hint
+ *
+ * Used when a request is shed because a bounded queue (such as the crypto
+ * pool) is saturated. The body is the standard error page; Retry-After
+ * tells well-behaved clients to back off instead of retrying immediately.
+ *
+ * @param retry_after Seconds the client should wait before retrying
+ * @param client Pointer to Client structure containing connection details
+ *
+ * @return 0 on success, -1 if client is NULL
+ *
+ * @note Always sets Connection: close header
+ *
+ * @see send_error_response()
+ */
+int send_unavailable_response(int retry_after, Client* client) {
+    if (!client) return -1;
+    client->status = 503;
+
+    const char* status_msg = get_status_message(503);
+    char* current_date = get_current_http_date();
+
+    char body[512];
+    int body_len = snprintf(body, sizeof(body),
+        "<html><head><title>503 %s</title></head>"
+        "<body><h1>503 %s</h1><hr><p>Snap/0.4</p></body></html>\n",
+        status_msg, status_msg);
+
+    char headers[MAX_HEADER_SIZE];
+    int  header_len = 0;
+
+    const char* version = client->version ? client->version : "HTTP/1.1";
+
+    header_len += snprintf(headers + header_len, MAX_HEADER_SIZE - header_len,
+                           "%s 503 %s\r\n", version, status_msg);
+    header_len += snprintf(headers + header_len, MAX_HEADER_SIZE - header_len,
+                           "Content-Type: text/html\r\n");
+    header_len += snprintf(headers + header_len, MAX_HEADER_SIZE - header_len,
+                           "Content-Length: %d\r\n", body_len);
+    header_len += snprintf(headers + header_len, MAX_HEADER_SIZE - header_len,
+                           "Retry-After: %d\r\n", retry_after);
+    header_len += snprintf(headers + header_len, MAX_HEADER_SIZE - header_len,
+                           "Date: %s\r\n", current_date);
+    header_len += snprintf(headers + header_len, MAX_HEADER_SIZE - header_len,
+                           "Connection: close\r\n");
+    header_len += snprintf(headers + header_len, MAX_HEADER_SIZE - header_len, "\r\n");
+
+    free(current_date);
+
+    send_all(client, headers, header_len);
+    send_all(client, body, body_len);
+
+    client->connection_status = 0;
+    log_message(LOG_INFO, "Sent 503 (Retry-After: %d)", retry_after);
+
+    return 0;
+}
+
+/**
+ * Sends a 425 Too Early response (RFC 8470)
+ *
+ * Used for a request that arrived in TLS 1.3 early data but is not safe to
+ * replay. The connection stays open: the client repeats the request once
+ * the handshake has completed, on the same connection.
+ *
+ * @param client Pointer to Client structure containing connection details
+ *
+ * @return 0 on success, -1 if client is NULL
+ *
+ * @see send_error_response()
+ */
+int send_too_early_response(Client* client) {
+    if (!client) return -1;
+    client->status = 425;
+
+    char* current_date = get_current_http_date();
+    const char* version = client->version ? client->version : "HTTP/1.1";
+
+    char headers[MAX_HEADER_SIZE];
+    int header_len = snprintf(headers, sizeof(headers),
+        "%s 425 %s\r\n"
+        "Content-Length: 0\r\n"
+        "Date: %s\r\n"
+        "\r\n",
+        version, get_status_message(425), current_date);
+
+    free(current_date);
+
+    send_all(client, headers, header_len);
+    log_message(LOG_INFO, "Sent 425 for %s %s in early data", client->method, client->path);
+
+    return 0;
+}
+
 /**
  * Sends a 304 Not Modified response for cache validation
  *
@@ -338,6 +613,7 @@ int send_error_response(int status_code, Client* client) {
  * @see send_file_response()
  */
 int send_not_modified_response(Client* client, struct Node* cache_node) {
+    client->status = 304;
     char headers[MAX_HEADER_SIZE];
     int header_len = 0;
     
@@ -393,8 +669,10 @@ const char* get_status_message(int code) {
         case 404: return "Not Found";
         case 416: return "Range Not Satisfiable";
         case 418: return "I'm a teapot";
+        case 425: return "Too Early";
         case 500: return "Internal Server Error";
         case 501: return "Not Implemented";
+        case 503: return "Service Unavailable";
         case 505: return "HTTP Version Not Supported";
         default: return "Unknown";
     }
@@ -460,6 +738,7 @@ char* get_current_http_date(void) {
  */
 int send_redirect_response(const char* location, Client* client) {
     if (!client || !location) return -1;
+    client->status = 301;
     
     char headers[MAX_HEADER_SIZE];
     int header_len = 0;
@@ -494,6 +773,7 @@ int send_redirect_response(const char* location, Client* client) {
  */
 int send_login_redirect(const char* location, const char* token, int max_age, Client* client) {
     if (!client || !location || !token) return -1;
+    client->status = 302;
 
     char headers[MAX_HEADER_SIZE];
     int header_len = 0;
@@ -538,6 +818,7 @@ int send_login_redirect(const char* location, const char* token, int max_age, Cl
  */
 int send_options_response(Client* client) {
     if (!client) return -1;
+    client->status = 200;
     
     char headers[MAX_HEADER_SIZE];
     int header_len = 0;
@@ -581,6 +862,7 @@ int send_options_response(Client* client) {
 
 int send_range_not_satisfiable(Client* client, off_t file_size) {
     if (!client) return -1;
+    client->status = 416;
     
     char headers[MAX_HEADER_SIZE];
     int header_len = 0;
@@ -608,6 +890,7 @@ void send_api_response(Client* client, int code, char* mime_type, char* body)
 {
     if(!client || !body)
         return;
+    client->status = code;
 
     char headers[MAX_HEADER_SIZE];
     int header_len = 0;
@@ -0,0 +1,142 @@
+#include "vhost.h"
+#include "cache.h"
+#include "config.h"
+#include "logger.h"
+#include "media_index.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/* Slot 0 is the default host; slots 1.. mirror g_config.vhosts. The table
+ * is built before the workers start and never resized, so lookups need no
+ * locking. */
+static VirtualHost g_hosts[MAX_VHOSTS + 1];
+static int         g_host_count = 0;
+
+static void vhost_setup(VirtualHost* vh, const char* name, const char* webroot, int budget_kb) {
+    memset(vh, 0, sizeof(*vh));
+    vh->name = name;
+    vh->webroot = webroot;
+    vh->cache_budget = budget_kb > 0 ? (size_t)budget_kb * 1024 : 0;
+    pthread_rwlock_init(&vh->cache_lock, NULL);
+
+    vh->cache_tree = cache_tree_init(webroot, vh->cache_budget, &vh->cache_used);
+    if (!vh->cache_tree) {
+        log_message(LOG_WARN, "Empty cache index for %s", webroot);
+    }
+    vh->media = media_index_build(webroot, vh->cache_tree);
+
+    vh->error_pages = error_pages_init(webroot);
+
+    log_message(LOG_INFO, "Host %s: webroot %s, cache index %zu bytes (budget %zu)",
+                name ? name : "(default)", webroot, vh->cache_used, vh->cache_budget);
+}
+
+/**
+ * Builds the host table from the configuration
+ *
+ * Indexes each host's webroot and loads its error pages. A host whose
+ * webroot is missing still starts (with an empty index) so that one broken
+ * site does not keep the others down.
+ *
+ * @return 0 on success
+ *
+ * @see vhost_lookup(), vhost_shutdown()
+ */
+int vhost_init(void) {
+    extern struct ServerConfig g_config;
+
+    g_host_count = 0;
+    vhost_setup(&g_hosts[g_host_count++], NULL, g_config.webroot, g_config.cache_budget_kb);
+
+    for (int i = 0; i < g_config.vhost_count; i++) {
+        const VhostConfig* vc = &g_config.vhosts[i];
+        vhost_setup(&g_hosts[g_host_count++], vc->name, vc->webroot, vc->cache_budget_kb);
+    }
+    return 0;
+}
+
+/**
+ * Frees every host's cache index and error pages
+ *
+ * @warning Call only after all workers have stopped
+ */
+void vhost_shutdown(void) {
+    for (int i = 0; i < g_host_count; i++) {
+        cache_tree_free(g_hosts[i].cache_tree);
+        media_index_free(g_hosts[i].media);
+        error_pages_free(g_hosts[i].error_pages);
+        pthread_rwlock_destroy(&g_hosts[i].cache_lock);
+    }
+    g_host_count = 0;
+}
+
+/**
+ * Finds the host serving a request
+ *
+ * @param host Host header value or SNI name; may carry a port
+ *             ("example.com:8443", "[::1]:8443") and may be NULL
+ *
+ * @return Matching host, or the default host
+ */
+VirtualHost* vhost_lookup(const char* host) {
+    if (!host || g_host_count <= 1) return &g_hosts[0];
+
+    // Strip the port (after the closing bracket for IPv6 literals)
+    size_t len;
+    const char* colon = host[0] == '[' ? strstr(host, "]:") : strchr(host, ':');
+    if (colon && host[0] == '[') colon++;
+    len = colon ? (size_t)(colon - host) : strlen(host);
+    if (len > 0 && host[len - 1] == '.') len--;
+
+    for (int i = 1; i < g_host_count; i++) {
+        if (strlen(g_hosts[i].name) == len && strncasecmp(g_hosts[i].name, host, len) == 0) {
+            return &g_hosts[i];
+        }
+    }
+    return &g_hosts[0];
+}
+
+VirtualHost* vhost_default(void) {
+    return &g_hosts[0];
+}
+
+/**
+ * Rebuilds the cache index and media catalog of every host
+ *
+ * The new index is built without holding the lock and swapped in under
+ * the host's write lock, so requests keep being served (from the old
+ * index) while a host is re-indexed.
+ */
+void vhost_refresh_caches(void) {
+    for (int i = 0; i < g_host_count; i++) {
+        VirtualHost* vh = &g_hosts[i];
+
+        size_t used = 0;
+        struct Node* fresh = cache_tree_init(vh->webroot, vh->cache_budget, &used);
+        struct MediaIndex* media = media_index_build(vh->webroot, fresh);
+
+        pthread_rwlock_wrlock(&vh->cache_lock);
+        struct Node* old = vh->cache_tree;
+        struct MediaIndex* old_media = vh->media;
+        vh->cache_tree = fresh;
+        vh->media = media;
+        vh->cache_used = used;
+        pthread_rwlock_unlock(&vh->cache_lock);
+
+        cache_tree_free(old);
+        media_index_free(old_media);
+    }
+}
+
+void vhost_walk_files(void (*visit)(const struct Node*, void*), void* arg) {
+    for (int i = 0; i < g_host_count; i++) {
+        VirtualHost* vh = &g_hosts[i];
+
+        pthread_rwlock_rdlock(&vh->cache_lock);
+        walk_tree(vh->cache_tree, visit, arg);
+        pthread_rwlock_unlock(&vh->cache_lock);
+    }
+}
@@ -11,11 +11,23 @@
 #include "api.h"
 #include "post.h"
 #include "session.h"
-#include "error_pages.h"
+#include "crypto_pool.h"
+#include "overload.h"
+#include "timer_wheel.h"
+#include "connection.h"
+#include "io_engine.h"
+#include "vhost.h"
+#include "access_log.h"
+#include "metrics.h"
+#include "trace.h"
+#include "introspect.h"
+#include "fd_cache.h"
+#include "prefetch.h"
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <unistd.h>
 #include <signal.h>
 #include <errno.h>
@@ -24,6 +36,7 @@
 #include <sys/socket.h>
 #include <sys/select.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <time.h>
 
@@ -36,6 +49,8 @@
 // Global variables for signal handling
 static volatile sig_atomic_t g_shutdown = 0;
 static volatile sig_atomic_t g_refresh_cache = 0;
+static volatile sig_atomic_t g_reload_tls = 0;
+static volatile sig_atomic_t g_reopen_logs = 0;
 
 // Global thread pool
 static struct ThreadPool* g_thread_pool = NULL;
@@ -47,10 +62,6 @@ ht* mime_table;
 sqlite3* g_database = NULL;
 pthread_mutex_t g_db_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-// Global cache tree and its rwlock (readers = worker threads, writer = cache refresh)
-static struct Node* g_cache_tree = NULL;
-static pthread_rwlock_t g_cache_rwlock = PTHREAD_RWLOCK_INITIALIZER;
-
 // Server start time for uptime calculation
 time_t g_server_start = 0;
 
@@ -64,6 +75,8 @@ time_t g_server_start = 0;
  * 
  * @note SIGINT/SIGTERM/SIGQUIT trigger graceful shutdown
  * @note SIGUSR1 triggers cache tree refresh
+ * @note SIGUSR2 triggers a TLS certificate reload
+ * @note SIGHUP reopens the log file
  * @warning This function runs in signal context - keep it minimal
  */
 void signal_handler(int signum) {
@@ -79,6 +92,14 @@ void signal_handler(int signum) {
             write(STDERR_FILENO, "Cache refresh signal received\n", 30);
             g_refresh_cache = 1;
             break;
+        case SIGUSR2:
+            write(STDERR_FILENO, "TLS reload signal received\n", 27);
+            g_reload_tls = 1;
+            break;
+        case SIGHUP:
+            write(STDERR_FILENO, "Log reopen signal received\n", 27);
+            g_reopen_logs = 1;
+            break;
         default:
             break;
     }
@@ -88,7 +109,8 @@ void signal_handler(int signum) {
  * Setup signal handlers for server management.
  * 
  * Configures handlers for shutdown signals (SIGINT/SIGTERM/SIGQUIT),
- * cache refresh signal (SIGUSR1), and ignores SIGPIPE.
+ * cache refresh signal (SIGUSR1), TLS reload signal (SIGUSR2), log reopen
+ * signal (SIGHUP), and ignores SIGPIPE.
  * 
  * @note SIGPIPE is ignored to prevent crashes on broken connections
  * @note All other signals invoke signal_handler()
@@ -106,6 +128,8 @@ void setup_signals(void) {
     sigaction(SIGTERM, &sa, NULL);
     sigaction(SIGQUIT, &sa, NULL);
     sigaction(SIGUSR1, &sa, NULL);
+    sigaction(SIGUSR2, &sa, NULL);
+    sigaction(SIGHUP, &sa, NULL);
 }
 
 /**
@@ -115,12 +139,12 @@ void setup_signals(void) {
  *  validates asking path, checks for cached responses (304), 
  *  then sends file. All resources are cleaned up before thread exit.
  *
- * @param arg ThreadArgs* object - holds client info
+ * @param arg Connection* slot from the connection table
  *
  * @return Always returns NULL (pthread requirement)
  *
  * @note This function is called by thread pool workers
- * @note All allocated resources (Client, SSL, ThreadArgs) are freed internally
+ * @note The SSL object is freed and the slot released before the socket closes
  * @warning Do not call directly - submit via threadpool_add_work()
  *
  * @see threadpool_add_work(), parse_http_request(), send_file_response()
@@ -149,46 +173,303 @@ static int compare_http_dates(const char* a, const char* b) {
     return ta.tm_sec - tb.tm_sec;
 }
 
+/* GET/HEAD for static content: the only requests served from 0-RTT data. */
+static int early_data_allowed(const Client* client) {
+    if (strcmp(client->method, "GET") != 0 && strcmp(client->method, "HEAD") != 0) return 0;
+    return strncmp(client->path, "/api/", 5) != 0;
+}
+
+/* Single blocking read from the client, TLS or plaintext (via the I/O engine). */
+static ssize_t connection_recv(Connection* conn, char* buf, size_t len) {
+    ssize_t n;
+    do {
+        if (conn->ssl) {
+            int was_early = conn->tls_early;
+            n = ssl_read_data(conn->ssl, &conn->tls_early, buf, (int)len);
+            // The early-data phase ends with the handshake (or its failure)
+            if (was_early && !conn->tls_early && n >= 0) conn->handshake_us = monotonic_us();
+        } else {
+            n = io_recv(conn->client_fd, buf, len);
+        }
+    } while (n < 0 && errno == EINTR);
+
+    if (n > 0) conn->bytes_in += (uint64_t)n;
+    return n;
+}
+
+/* Keep-alive idle deadline, shortened while connections wait for a worker. */
+static unsigned keepalive_timeout_ms(void) {
+    struct ThreadPoolStats stats;
+    threadpool_get_stats(g_thread_pool, &stats);
+
+    int seconds = stats.queued_work > 0 ? g_config.keepalive_timeout_busy
+                                        : g_config.keepalive_timeout;
+    return (unsigned)seconds * 1000;
+}
+
+/* Returns the Content-Length declared in a header block, or 0 if absent. */
+static long scan_content_length(const char* headers, const char* headers_end) {
+    const char* line = strstr(headers, "\r\n");
+    while (line && line < headers_end) {
+        line += 2;
+        if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            return strtol(line + 15, NULL, 10);
+        }
+        line = strstr(line, "\r\n");
+    }
+    return 0;
+}
+
+/**
+ * Reads one complete request from the connection
+ *
+ * Accumulates bytes until the header block is complete and, when a
+ * Content-Length is present, until the whole body has arrived. Bytes past
+ * the end of the request (pipelined requests) stay in the buffer for the
+ * next call. Each phase runs under its own deadline on the timer wheel:
+ * waiting for the first byte uses the keep-alive idle timeout (or the header
+ * timeout on a fresh connection), the rest of the headers must arrive within
+ * header_timeout of that first byte however slowly they trickle in, and the
+ * body gets body_timeout.
+ *
+ * @param conn Connection being served; its read buffer holds conn->buffered
+ *             bytes and is NUL-terminated after them
+ * @param first_request Nonzero for the first request on the connection
+ *
+ * @return Length of the request at the start of the read buffer, 0 if the
+ *         peer closed or a deadline expired, -1 on read error or oversized
+ *         headers
+ *
+ * @see timer_arm(), handle_client_thread()
+ */
+static ssize_t read_request(Connection* conn, int first_request) {
+    char* buf = conn->read_buf;
+    size_t cap = CONNECTION_BUFFER_SIZE - 1;
+
+    int header_deadline = first_request || conn->buffered > 0;
+    if (header_deadline) {
+        timer_arm(&conn->timer, TIMER_HEADER, (unsigned)g_config.header_timeout * 1000);
+    } else {
+        conn->state = CONN_IDLE;
+        timer_arm(&conn->timer, TIMER_IDLE, keepalive_timeout_ms());
+    }
+
+    buf[conn->buffered] = '\0';
+    char* header_end;
+    while ((header_end = strstr(buf, "\r\n\r\n")) == NULL) {
+        if (conn->buffered >= MAX_REQUEST_SIZE) {
+            log_message(LOG_WARN, "Request headers exceed %d bytes", MAX_REQUEST_SIZE);
+            return -1;
+        }
+
+        ssize_t n = connection_recv(conn, buf + conn->buffered, MAX_REQUEST_SIZE - conn->buffered);
+        if (n <= 0) return n;
+
+        if (!header_deadline) {
+            timer_arm(&conn->timer, TIMER_HEADER, (unsigned)g_config.header_timeout * 1000);
+            header_deadline = 1;
+        }
+        conn->state = CONN_READING;
+        conn->buffered += (size_t)n;
+        buf[conn->buffered] = '\0';
+    }
+
+    size_t header_len = (size_t)(header_end - buf) + 4;
+    size_t request_len = header_len;
+
+    /* Oversized bodies are left unread; handle_post() answers 413 and closes. */
+    long content_length = scan_content_length(buf, header_end);
+    if (content_length > 0 && content_length <= MAX_BODY_SIZE) {
+        request_len += (size_t)content_length;
+
+        if (conn->buffered < request_len) {
+            timer_arm(&conn->timer, TIMER_BODY, (unsigned)g_config.body_timeout * 1000);
+        }
+        while (conn->buffered < request_len) {
+            ssize_t n = connection_recv(conn, buf + conn->buffered, cap - conn->buffered);
+            if (n <= 0) return n;
+            conn->buffered += (size_t)n;
+        }
+        buf[conn->buffered] = '\0';
+    }
+
+    // Processing has no deadline of its own; sends arm the write-stall timer
+    timer_cancel(&conn->timer);
+    return (ssize_t)request_len;
+}
+
+/* Feeds the phase histograms, each phase measured from the latest stamp before it. */
+static void record_phases(Connection* conn, const Client* client, uint64_t done) {
+    MetricsRoute route = METRICS_ROUTE_STATIC;
+    if (client->method && strcmp(client->method, "POST") == 0) route = METRICS_ROUTE_POST;
+    else if (client->path && strncmp(client->path, "/api/", 5) == 0) route = METRICS_ROUTE_API;
+
+    if (conn->dequeued_us) {
+        metrics_record_phase(route, METRICS_PHASE_QUEUE, conn->dequeued_us - conn->accepted_us);
+        if (conn->handshake_us) {
+            metrics_record_phase(route, METRICS_PHASE_HANDSHAKE,
+                                 conn->handshake_us - conn->dequeued_us);
+        }
+        // Later requests on this connection did not wait for either
+        conn->dequeued_us = 0;
+        conn->handshake_us = 0;
+    }
+
+    uint64_t last = conn->request_start_us;
+    if (conn->parsed_us) {
+        metrics_record_phase(route, METRICS_PHASE_PARSE, conn->parsed_us - last);
+        last = conn->parsed_us;
+    }
+    if (conn->routed_us) {
+        metrics_record_phase(route, METRICS_PHASE_ROUTE, conn->routed_us - last);
+        last = conn->routed_us;
+    }
+    if (conn->first_byte_us) {
+        metrics_record_phase(route, METRICS_PHASE_FIRST_BYTE, conn->first_byte_us - last);
+        metrics_record_phase(route, METRICS_PHASE_SEND, done - conn->first_byte_us);
+    }
+    metrics_record_phase(route, METRICS_PHASE_TOTAL, done - conn->request_start_us);
+}
+
+/* Emits the spans of a traced request from the same stamps as the phase
+ * histograms; cache lookup and file open were recorded as they happened. */
+static void record_trace(const Connection* conn, const Client* client, uint64_t done) {
+    uint64_t id = conn->trace_id;
+
+    if (conn->dequeued_us) {
+        trace_span(id, TRACE_SPAN_QUEUE, conn->accepted_us, conn->dequeued_us);
+        if (conn->handshake_us) {
+            trace_span(id, TRACE_SPAN_HANDSHAKE, conn->dequeued_us, conn->handshake_us);
+        }
+    }
+    if (conn->parsed_us) {
+        trace_span(id, TRACE_SPAN_PARSE, conn->request_start_us, conn->parsed_us);
+    }
+    if (conn->first_byte_us) {
+        uint64_t routed = conn->routed_us ? conn->routed_us
+                        : conn->parsed_us ? conn->parsed_us : conn->request_start_us;
+        trace_span(id, TRACE_SPAN_FIRST_BYTE, routed, conn->first_byte_us);
+        trace_span(id, TRACE_SPAN_SEND, conn->first_byte_us, done);
+    }
+    trace_request(id, conn->request_start_us, done, client->method, client->path, client->status);
+}
+
+/* Ends one request: records its metrics, trace and access-log entry and
+ * clears the Client for the next request on the connection. */
+static void finish_request(Connection* conn, Client* client) {
+    if (client->status) {
+        uint64_t now = monotonic_us();
+        if (conn->trace_id) record_trace(conn, client, now);
+        record_phases(conn, client, now);
+
+        uint64_t latency = now - conn->request_start_us;
+        uint64_t bytes = conn->bytes_out - conn->request_bytes_out;
+        metrics_record_request(client->method, client->status, bytes, latency);
+        access_log_request(client, conn, latency, bytes);
+    }
+    conn->trace_id = 0;
+    client_reset(client);
+}
+
 void* handle_client_thread(void* arg) {
-    ThreadArgs* args = (ThreadArgs*)arg;
+    Connection* conn = (Connection*)arg;
     extern struct ServerConfig g_config;
 
-    /* 30-second idle timeout so keep-alive threads don't hold indefinitely. */
-    struct timeval tv = { .tv_sec = 30, .tv_usec = 0 };
-    setsockopt(args->client_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    conn->dequeued_us = monotonic_us();
+    conn->worker_tid  = current_tid();
+
+    /* Deadlines (idle, header, body, write stall) are tracked on the timer
+     * wheel, which shuts the socket down on expiry to unblock this worker.
+     * IP and port are already resolved at accept() time for both IPv4 and IPv6. */
+
+    /* The TLS handshake runs here rather than on the accept thread, so one
+     * slow or hostile client cannot stall accept() for everyone else. */
+    if (conn->ssl) {
+        conn->state = CONN_HANDSHAKE;
+        ssl_handshake_begin(conn->ssl);
+        timer_arm(&conn->timer, TIMER_HEADER, (unsigned)g_config.header_timeout * 1000);
+        if (SSL_get_max_early_data(conn->ssl) > 0) {
+            // Completed by the first read, after any 0-RTT data (ssl_read_data)
+            conn->tls_early = 1;
+        }
+    }
 
-    /* IP and port are already resolved at accept() time for both IPv4 and IPv6. */
+    if (conn->ssl && !conn->tls_early) {
+        int handshake_ok = SSL_accept(conn->ssl) > 0;
+        ssl_record_handshake(conn->ssl, handshake_ok);
+        if (!handshake_ok) {
+            ERR_clear_error();
+            SSL_free(conn->ssl);
+            conn->ssl = NULL;
+            log_message(LOG_INFO, "TLS handshake failed for %s:%d", conn->client_ip, conn->client_port);
+            goto cleanup;
+        }
+        conn->handshake_us = monotonic_us();
+    }
 
-    while (1) {
-        char request_buffer[8192];
-        memset(request_buffer, 0, sizeof(request_buffer));
+    /* The slot's buffer holds headers plus the largest accepted body;
+     * leftover pipelined bytes are carried over between iterations. */
+    if (connection_alloc_buffer(conn) < 0) {
+        log_message(LOG_ERROR, "Failed to allocate read buffer");
+        goto cleanup;
+    }
+    char* request_buffer = conn->read_buf;
+    int first_request = 1;
 
-        ssize_t recv_len;
-        if (args->ssl) {
-            recv_len = SSL_read(args->ssl, request_buffer, sizeof(request_buffer) - 1);
-        } else {
-            recv_len = recv(args->client_fd, request_buffer, sizeof(request_buffer) - 1, 0);
-        }
+    /* Parsed requests live in the slot's embedded Client, reset after each
+     * response, so the keep-alive loop allocates no per-request structures. */
+    Client* client = &conn->client;
 
-        if (recv_len <= 0) {
-            if (recv_len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    while (1) {
+        ssize_t request_len = read_request(conn, first_request);
+        first_request = 0;
+
+        if (request_len <= 0) {
+            TimerKind expired = timer_cancel(&conn->timer);
+            if (expired == TIMER_IDLE)
                 log_message(LOG_INFO, "Keep-alive idle timeout, closing connection");
+            else if (expired != TIMER_NONE)
+                log_message(LOG_WARN, "%s timeout for %s:%d, closing connection",
+                            timer_kind_name(expired), conn->client_ip, conn->client_port);
             else
                 log_message(LOG_WARN, "Client disconnected or read error");
             goto cleanup;
         }
 
-        request_buffer[recv_len] = '\0';
-        log_message(LOG_DEBUG, "Received %ld bytes from client", recv_len);
+        log_message(LOG_DEBUG, "Received %ld byte request from client", request_len);
+
+        /* Parse this request in place, then shift any pipelined bytes down.
+         * parse_http_request_into() copies every field, so the buffer is free to reuse. */
+        conn->state = CONN_PROCESSING;
+        conn->requests++;
+        conn->request_start_us  = monotonic_us();
+        conn->request_bytes_out = conn->bytes_out;
+        conn->parsed_us = conn->routed_us = conn->first_byte_us = 0;
+        conn->response_total = 0;
+
+        // Set before parsing so parse errors are sent under the write deadline
+        client->conn = conn;
+
+        char next_byte = request_buffer[request_len];
+        request_buffer[request_len] = '\0';
+        int parsed = parse_http_request_into(client, request_buffer, conn->client_fd, conn->ssl);
 
-        Client* client = parse_http_request(request_buffer, args->client_fd, args->ssl);
-        if (!client) {
+        request_buffer[request_len] = next_byte;
+        conn->buffered -= (size_t)request_len;
+        memmove(request_buffer, request_buffer + request_len, conn->buffered);
+
+        if (parsed < 0) {
             log_message(LOG_ERROR, "Failed to parse request");
             goto cleanup;
         }
 
-        client->client_ip   = strdup(args->client_ip);
-        client->client_port = args->client_port;
+        client->client_ip   = strdup(conn->client_ip);
+        client->client_port = conn->client_port;
+        client->vhost       = vhost_lookup(client->host);
+        conn->parsed_us     = monotonic_us();
+        conn->trace_id      = trace_sample(client->trace_requested);
+        snprintf(conn->request_line, sizeof(conn->request_line), "%s %s",
+                 client->method, client->path);
 
         log_message(LOG_INFO, "Request from %s:%d - %s %s %s",
                     client->client_ip, client->client_port,
@@ -196,14 +477,26 @@ void* handle_client_thread(void* arg) {
 
         print_client_info(client);
 
+        /* Early data can be replayed by an attacker, so only requests that
+         * are safe to repeat are served before the handshake completes. */
+        if (conn->tls_early) {
+            int safe = early_data_allowed(client);
+            ssl_record_early_request(safe);
+            if (!safe) {
+                send_too_early_response(client);
+                finish_request(conn, client);
+                continue;
+            }
+        }
+
         // Handle TLS upgrade redirect (HTTP only)
-        if (!args->ssl && client->upgrade_tls) {
+        if (!conn->ssl && client->upgrade_tls) {
             char redirect_url[512];
             snprintf(redirect_url, sizeof(redirect_url), "https://%s%s",
                      client->host ? client->host : "localhost", client->path);
             log_message(LOG_INFO, "Redirecting to HTTPS: %s", redirect_url);
             send_redirect_response(redirect_url, client);
-            free_client(client);
+            finish_request(conn, client);
             goto cleanup;
         }
 
@@ -216,13 +509,14 @@ void* handle_client_thread(void* arg) {
                 log_message(LOG_WARN, "Unsupported method: %s", client->method);
                 send_error_response(501, client);
             }
-            free_client(client);
+            finish_request(conn, client);
             goto cleanup;
         }
 
         if (strncmp(client->method, "POST", 4) == 0) {
+            conn->routed_us = monotonic_us();
             handle_post(client);
-            free_client(client);
+            finish_request(conn, client);
             goto cleanup;
         }
 
@@ -230,16 +524,16 @@ void* handle_client_thread(void* arg) {
         if (!validate_path(client->path)) {
             log_message(LOG_WARN, "Invalid/dangerous path detected: %s", client->path);
             send_error_response(403, client);
-            free_client(client);
+            finish_request(conn, client);
             goto cleanup;
         }
 
         // Resolve full filesystem path
-        client->full_path = resolve_request_path(client->path, g_config.webroot);
+        client->full_path = resolve_request_path(client->path, client->vhost->webroot);
         if (!client->full_path) {
             log_message(LOG_ERROR, "Failed to resolve path");
             send_error_response(500, client);
-            free_client(client);
+            finish_request(conn, client);
             goto cleanup;
         }
 
@@ -248,8 +542,9 @@ void* handle_client_thread(void* arg) {
         // Check API endpoint
         if (strncmp(client->path, "/api/", 5) == 0) {
             log_message(LOG_INFO, "API endpoint detected - %s", client->full_path);
+            conn->routed_us = monotonic_us();
             handle_api_request(client);
-            free_client(client);
+            finish_request(conn, client);
             goto cleanup;
         }
 
@@ -273,14 +568,20 @@ void* handle_client_thread(void* arg) {
                     log_message(LOG_INFO, "Unauthenticated access to %s - redirecting to login",
                                 client->path);
                     send_redirect_response("/login.html", client);
-                    free_client(client);
+                    finish_request(conn, client);
                     goto cleanup;
                 }
             }
         }
 
-        pthread_rwlock_rdlock(&g_cache_rwlock);
-        struct Node* cache_node = cache_lookup(g_cache_tree, client->full_path);
+        pthread_rwlock_t* cache_lock = &client->vhost->cache_lock;
+        pthread_rwlock_rdlock(cache_lock);
+        uint64_t lookup_start = conn->trace_id ? monotonic_us() : 0;
+        struct Node* cache_node = cache_lookup(client->vhost->cache_tree, client->full_path);
+        if (conn->trace_id) {
+            trace_span(conn->trace_id, TRACE_SPAN_CACHE_LOOKUP, lookup_start, monotonic_us());
+        }
+        metrics_record_cache(cache_node != NULL);
 
         // Check If-Modified-Since header
         if (cache_node && cache_node->last_modified && client->modified_since) {
@@ -288,8 +589,8 @@ void* handle_client_thread(void* arg) {
                 log_message(LOG_INFO, "Resource not modified (If-Modified-Since) - sending 304");
                 send_not_modified_response(client, cache_node);
                 int keep_alive = client->connection_status;
-                free_client(client);
-                pthread_rwlock_unlock(&g_cache_rwlock);
+                finish_request(conn, client);
+                pthread_rwlock_unlock(cache_lock);
                 if (keep_alive) continue;
                 goto cleanup;
             }
@@ -302,18 +603,22 @@ void* handle_client_thread(void* arg) {
                            client->tag, cache_node->file_hash);
                 send_not_modified_response(client, cache_node);
                 int keep_alive = client->connection_status;
-                free_client(client);
-                pthread_rwlock_unlock(&g_cache_rwlock);
+                finish_request(conn, client);
+                pthread_rwlock_unlock(cache_lock);
                 if (keep_alive) continue;
                 goto cleanup;
             }
         }
 
-        // HEAD requests only need metadata — skip open() and let send_file_response
-        // use stat() internally. For all other methods, open the file normally.
-        if (strcmp(client->method, "HEAD") != 0) {
-            client->fd = open(client->full_path, O_RDONLY);
-            if (client->fd < 0) {
+        /* HEAD goes through the open-file cache too: a hit already carries
+         * the stat data, which is all HEAD needs. */
+        {
+            uint64_t open_start = conn->trace_id ? monotonic_us() : 0;
+            client->file = fd_cache_open(client->full_path);
+            if (conn->trace_id) {
+                trace_span(conn->trace_id, TRACE_SPAN_FILE_OPEN, open_start, monotonic_us());
+            }
+            if (!client->file) {
                 if (errno == ENOENT) {
                     log_message(LOG_WARN, "File not found: %s", client->full_path);
                     send_error_response(404, client);
@@ -325,37 +630,221 @@ void* handle_client_thread(void* arg) {
                                client->full_path, strerror(errno));
                     send_error_response(500, client);
                 }
-                free_client(client);
-                pthread_rwlock_unlock(&g_cache_rwlock);
+                finish_request(conn, client);
+                pthread_rwlock_unlock(cache_lock);
                 goto cleanup;
             }
+            client->fd = client->file->fd;
         }
 
+        conn->routed_us = monotonic_us();
         int result = send_file_response(client, cache_node);
-        pthread_rwlock_unlock(&g_cache_rwlock);
+        pthread_rwlock_unlock(cache_lock);
         if (result < 0) {
             log_message(LOG_ERROR, "Failed to send file response");
         }
 
         int keep_alive = client->connection_status;
-        free_client(client);
+        finish_request(conn, client);
         if (!keep_alive) goto cleanup;
     }
 
 cleanup:
-    if (args->ssl) {
-        SSL_shutdown(args->ssl);
-        SSL_free(args->ssl);
+    if (conn->ssl) {
+        // close_notify is a blocking write too; bound it like any other
+        timer_arm(&conn->timer, TIMER_WRITE, (unsigned)g_config.write_timeout * 1000);
+        if (SSL_is_init_finished(conn->ssl)) {
+            SSL_shutdown(conn->ssl);
+        }
+        ERR_clear_error();
+        SSL_free(conn->ssl);
     }
 
-    close(args->client_fd);
-    
-    // Free thread arguments
-    free(args);
-    
+    // The wheel must be done with this fd before it can be closed and reused
+    timer_cancel(&conn->timer);
+
+    // Release the slot first: once closed, the fd (and slot) can be reissued
+    int client_fd = conn->client_fd;
+    connection_release(conn);
+    close(client_fd);
+
+    return NULL;
+}
+
+/**
+ * Shed callback for connections dropped by the pool's CoDel controller
+ *
+ * Runs on a worker in place of handle_client_thread() when the connection
+ * has already waited too long in the queue. Plaintext clients get the canned
+ * 503; TLS clients are closed without a handshake (see overload_reject_tls).
+ *
+ * @param arg Connection* slot - released here
+ *
+ * @return Always returns NULL
+ */
+void* shed_client_thread(void* arg) {
+    Connection* conn = (Connection*)arg;
+    int client_fd = conn->client_fd;
+    SSL* ssl = conn->ssl;
+
+    connection_release(conn);
+    if (ssl) {
+        SSL_free(ssl);
+        overload_reject_tls(client_fd);
+    } else {
+        overload_reject(client_fd);
+    }
+    overload_note_codel_shed();
+
     return NULL;
 }
 
+/**
+ * Hands a freshly accepted connection to the thread pool
+ *
+ * Claims the connection's slot, records the peer address and, for HTTPS,
+ * creates the SSL object (the handshake itself happens on the worker). When
+ * the pool queue is full the connection is refused immediately: plaintext
+ * clients receive a preformatted 503 with Retry-After, TLS clients are
+ * closed before any handshake cost is paid.
+ *
+ * @param client_fd Accepted socket
+ * @param ca Peer address
+ * @param tls Nonzero for HTTPS listeners
+ *
+ * @see handle_client_thread(), shed_client_thread(), overload_reject()
+ */
+static void dispatch_connection(int client_fd, const struct sockaddr_storage* ca, int tls) {
+    /* The slot is indexed by fd; a fd past the table means we are at
+     * max_connections, which is overload like a full queue. */
+    Connection* conn = connection_acquire(client_fd);
+    if (!conn) {
+        overload_reject(client_fd);
+        return;
+    }
+
+    if (ca->ss_family == AF_INET6) {
+        struct sockaddr_in6* a6 = (struct sockaddr_in6*)ca;
+        conn->client_port = ntohs(a6->sin6_port);
+        inet_ntop(AF_INET6, &a6->sin6_addr, conn->client_ip, sizeof(conn->client_ip));
+    } else {
+        struct sockaddr_in* a4 = (struct sockaddr_in*)ca;
+        conn->client_port = ntohs(a4->sin_port);
+        inet_ntop(AF_INET, &a4->sin_addr, conn->client_ip, sizeof(conn->client_ip));
+    }
+
+    if (tls) {
+        // Created from whichever context is current; a reload does not affect it
+        conn->ssl = ssl_context_new_connection();
+        if (!conn->ssl) {
+            connection_release(conn);
+            close(client_fd);
+            return;
+        }
+        SSL_set_fd(conn->ssl, client_fd);
+    }
+
+    log_message(LOG_INFO, "New %s connection from %s:%d",
+                tls ? "HTTPS" : "HTTP", conn->client_ip, conn->client_port);
+
+    if (threadpool_add_work_sheddable(g_thread_pool, handle_client_thread,
+                                      shed_client_thread, conn) != 0) {
+        SSL* ssl = conn->ssl;
+        connection_release(conn);
+        if (ssl) {
+            SSL_free(ssl);
+            overload_reject_tls(client_fd);
+        } else {
+            overload_reject(client_fd);
+        }
+    }
+}
+
+/**
+ * Backs off after accept() ran out of file descriptors
+ *
+ * The pending connection stays queued, so retrying at once would spin the
+ * accept loop. Closes the idle files held by the fd cache and pauses
+ * accepting briefly so in-flight connections can finish.
+ *
+ * @param err EMFILE or ENFILE
+ */
+#define ACCEPT_BACKOFF_MS 100
+static void accept_exhausted(int err) {
+    static time_t last_report = 0;
+
+    time_t now = time(NULL);
+    if (now != last_report) {
+        last_report = now;
+        log_message(LOG_WARN, "accept(): %s, pausing %d ms", strerror(err), ACCEPT_BACKOFF_MS);
+    }
+
+    fd_cache_invalidate();
+
+    struct timespec pause = { 0, ACCEPT_BACKOFF_MS * 1000000L };
+    nanosleep(&pause, NULL);
+}
+
+/**
+ * Accepts every pending connection on a listening socket
+ *
+ * Drains the (non-blocking) listen queue in one pass, up to ACCEPT_BATCH
+ * connections, and dispatches each to the thread pool.
+ *
+ * @param listen_fd Listening socket (IPv4 or IPv6)
+ * @param tls Nonzero for HTTPS listeners
+ *
+ * @see dispatch_connection()
+ */
+#define ACCEPT_BATCH 64
+static void accept_connections(int listen_fd, int tls) {
+    for (int n = 0; n < ACCEPT_BATCH; n++) {
+        struct sockaddr_storage ca;
+        socklen_t al = sizeof(ca);
+        int client_fd = accept(listen_fd, (struct sockaddr*)&ca, &al);
+        if (client_fd < 0) {
+            if (errno == EMFILE || errno == ENFILE)
+                accept_exhausted(errno);
+            else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                log_message(LOG_ERROR, "accept(): %s", strerror(errno));
+            return;
+        }
+
+        dispatch_connection(client_fd, &ca, tls);
+    }
+}
+
+/**
+ * Dispatches connections delivered by the io_uring multishot accept
+ *
+ * @param listen_tls TLS flag per listener index
+ *
+ * @return 0 normally, -1 if multishot accept is unsupported
+ *
+ * @see io_accept_wait(), dispatch_connection()
+ */
+static int accept_uring_connections(const int* listen_tls) {
+    IoAcceptEvent events[ACCEPT_BATCH];
+    int n = io_accept_wait(events, ACCEPT_BATCH, 1000);
+    if (n < 0) return -1;
+
+    for (int i = 0; i < n; i++) {
+        if (events[i].fd < 0) {
+            accept_exhausted(-events[i].fd);
+            continue;
+        }
+
+        struct sockaddr_storage ca;
+        socklen_t al = sizeof(ca);
+        if (getpeername(events[i].fd, (struct sockaddr*)&ca, &al) < 0) {
+            close(events[i].fd);
+            continue;
+        }
+        dispatch_connection(events[i].fd, &ca, listen_tls[events[i].listener]);
+    }
+    return 0;
+}
+
 /**
  * Sets up and opens a new socket on a specified port
  *
@@ -383,6 +872,11 @@ int create_server_socket(int port) {
         close(sock);
         return -1;
     }
+
+    /* Accepted sockets inherit TCP_NODELAY. Responses go out as a header
+     * write followed by the body; with Nagle on, the body of a small file
+     * waits for the client's delayed ACK of the header (~40 ms). */
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
     
     // Bind to address
     struct sockaddr_in server_addr;
@@ -398,13 +892,16 @@ int create_server_socket(int port) {
     }
     
     // Listen for connections
-    if (listen(sock, BACKLOG) < 0) {
+    if (listen(sock, g_config.listen_backlog) < 0) {
         perror("listen failed");
         close(sock);
         return -1;
     }
+
+    // Non-blocking so accept_connections() can drain the queue without stalling
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
     
-    printf("Server listening on port %d (IPv4)\n", port);
+    printf("Server listening on port %d (IPv4, backlog %d)\n", port, g_config.listen_backlog);
     return sock;
 }
 
@@ -421,6 +918,7 @@ int create_server_socket6(int port) {
 
     int opt = 1;
     setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));    // See create_server_socket()
 
     // IPV6_V6ONLY=1: accept IPv6 connections only; IPv4 handled by the other socket
     int v6only = 1;
@@ -437,12 +935,14 @@ int create_server_socket6(int port) {
         return -1;
     }
 
-    if (listen(sock, BACKLOG) < 0) {
+    if (listen(sock, g_config.listen_backlog) < 0) {
         close(sock);
         return -1;
     }
 
-    printf("Server listening on port %d (IPv6)\n", port);
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL, 0) | O_NONBLOCK);
+
+    printf("Server listening on port %d (IPv6, backlog %d)\n", port, g_config.listen_backlog);
     return sock;
 }
 
@@ -460,7 +960,7 @@ int create_server_socket6(int port) {
  * @return 0 on successful shutdown, 1 on initialization error
  *
  * @note All clients are handled by handle_client_thread
- * @warning Must cleanup ThreadArgs object in handle_worker_thread
+ * @warning Workers release their connection slot in handle_client_thread
  * @see handle_client_thread(), setup_signals(), threadpool_create()
  */
 int main(int argc, char** argv) {
@@ -486,6 +986,43 @@ int main(int argc, char** argv) {
     // Setup signal handlers
     setup_signals();
 
+    // Canned 503 for connections refused under overload
+    overload_init(g_config.retry_after);
+
+    // io_uring or blocking syscalls; falls back to blocking if unavailable
+    io_engine_init(g_config.io_engine);
+
+    // Per-connection deadlines
+    if (timer_wheel_init(100) < 0) {
+        fprintf(stderr, "Failed to start timer wheel\n");
+        log_close();
+        return 1;
+    }
+
+    // Connection slots, indexed by socket fd
+    if (connection_table_init(g_config.max_connections) < 0) {
+        fprintf(stderr, "Failed to allocate connection table\n");
+        timer_wheel_shutdown();
+        log_close();
+        return 1;
+    }
+
+    // Binary per-request records; the server runs without them if the file fails
+    if (access_log_init(g_config.access_log, g_config.access_log_size_mb) < 0) {
+        fprintf(stderr, "Access log %s unavailable, continuing without it\n", g_config.access_log);
+    }
+
+    // Without the cache every request opens its file, as before
+    if (fd_cache_init(g_config.fd_cache_size, g_config.max_connections,
+                      g_config.fd_cache_valid) < 0) {
+        fprintf(stderr, "Open file cache unavailable, opening files per request\n");
+    }
+
+    // Tracing is a diagnostic aid; run without it rather than refuse to start
+    if (trace_init(g_config.trace_buffer, g_config.trace_sample_rate) < 0) {
+        fprintf(stderr, "Trace buffer unavailable, continuing without tracing\n");
+    }
+
     // Initialize libsodium (for password hashing)
     printf("Initializing libsodium...\n");
     if (sodium_init() < 0) {
@@ -495,6 +1032,13 @@ int main(int argc, char** argv) {
         return 1;
     }
     log_message(LOG_INFO, "libsodium initialized successfully");
+
+    // Password hashing runs on its own bounded pool, off the request workers
+    if (crypto_pool_init(g_config.crypto_pool_size, g_config.crypto_queue_size) < 0) {
+        fprintf(stderr, "Failed to create crypto pool\n");
+        log_close();
+        return 1;
+    }
     
     // Initialize database
     printf("Initializing database...\n");
@@ -506,34 +1050,40 @@ int main(int argc, char** argv) {
     }
     log_message(LOG_INFO, "Database initialized successfully");
     
-    // Initialize cache tree
-    g_cache_tree = cache_tree_init(g_config.webroot);
-    if (!g_cache_tree) {
-        log_message(LOG_ERROR, "Failed to initialize cache tree");
+    // Before the hosts: their media catalogs are filtered by MIME type
+    char mime_table_path[256];
+    snprintf(mime_table_path, sizeof(mime_table_path), "%s/etc/mime.types", SERVER_PATH);
+
+    mime_table = mime_init(mime_table_path);
+    if (mime_table == NULL) {
+        fprintf(stderr, "Failed to load MIME types\n");
         return 1;
     }
 
-    // Load error pages into memory
-    error_pages_init(g_config.webroot);
+    // Cache index, media catalog and error pages of the default host and every vhost
+    if (vhost_init() < 0) {
+        log_message(LOG_ERROR, "Failed to initialize virtual hosts");
+        return 1;
+    }
     
     // Initialize OpenSSL
     init_openssl();
-    SSL_CTX* ssl_ctx = create_ssl_context();
+    SSL_CTX* ssl_ctx = ssl_context_build();
     if (!ssl_ctx) {
         log_message(LOG_ERROR, "Failed to create SSL context");
-        cache_tree_free(g_cache_tree);
+        vhost_shutdown();
         cleanup_openssl();
         return 1;
     }
-    configure_ssl_context(ssl_ctx);
+    ssl_context_install(ssl_ctx);
     
     // Create IPv4 HTTP/HTTPS sockets
     int http_sock = create_server_socket(g_config.http_port);
     if (http_sock < 0) {
         log_message(LOG_ERROR, "Failed to create HTTP socket");
-        SSL_CTX_free(ssl_ctx);
+        ssl_context_shutdown();
         cleanup_openssl();
-        cache_tree_free(g_cache_tree);
+        vhost_shutdown();
         return 1;
     }
 
@@ -541,9 +1091,9 @@ int main(int argc, char** argv) {
     if (https_sock < 0) {
         log_message(LOG_ERROR, "Failed to create HTTPS socket");
         close(http_sock);
-        SSL_CTX_free(ssl_ctx);
+        ssl_context_shutdown();
         cleanup_openssl();
-        cache_tree_free(g_cache_tree);
+        vhost_shutdown();
         return 1;
     }
 
@@ -556,7 +1106,9 @@ int main(int argc, char** argv) {
     // Create thread pool
     struct ThreadPoolConfig pool_config = {
         .num_threads = g_config.thread_pool_size,
-        .max_queue_size = g_config.max_queue_size
+        .max_queue_size = g_config.max_queue_size,
+        .codel_target_us = (uint32_t)g_config.codel_target_ms * 1000,
+        .codel_interval_us = (uint32_t)g_config.codel_interval_ms * 1000
     };
     
     g_thread_pool = threadpool_create(pool_config);
@@ -564,20 +1116,20 @@ int main(int argc, char** argv) {
         log_message(LOG_ERROR, "Failed to create thread pool");
         close(http_sock);
         close(https_sock);
-        SSL_CTX_free(ssl_ctx);
+        ssl_context_shutdown();
         cleanup_openssl();
-        cache_tree_free(g_cache_tree);
+        vhost_shutdown();
         return 1;
     }
+    metrics_init(g_thread_pool);
+    introspect_init(g_thread_pool);
     
-    char mime_table_path[256];
-    snprintf(mime_table_path, sizeof(mime_table_path), "%s/etc/mime.types", SERVER_PATH);
 
-    mime_table = mime_init(mime_table_path);
-    if (mime_table == NULL) {
-        fprintf(stderr, "Failed to load MIME types\n");
-        return 1;
+    // Needs the cache index and MIME table to pick out the videos to warm
+    if (prefetch_init(g_config.prefetch_window_kb, g_config.prefetch_warm_mb) < 0) {
+        fprintf(stderr, "Prefetcher unavailable, sending without read-ahead\n");
     }
+    prefetch_warm_videos();
     
 
     log_message(LOG_INFO, "Server initialized successfully");
@@ -585,8 +1137,23 @@ int main(int argc, char** argv) {
     printf("HTTP Port: %d\n", g_config.http_port);
     printf("HTTPS Port: %d\n", g_config.https_port);
     printf("Thread Pool Size: %d\n", g_config.thread_pool_size);
+    printf("I/O engine: %s\n", io_engine_name());
     printf("Press Ctrl+C to shutdown\n");
     printf("Send SIGUSR1 (kill -USR1 %d) to refresh cache\n", getpid());
+    printf("Send SIGUSR2 (kill -USR2 %d) to reload TLS certificates\n", getpid());
+    printf("Send SIGHUP (kill -HUP %d) to reopen the log file\n", getpid());
+
+    // With io_uring, one multishot accept per listener replaces select()+accept()
+    int listen_fds[4];
+    int listen_tls[4];
+    int listen_count = 0;
+    listen_fds[listen_count] = http_sock;  listen_tls[listen_count++] = 0;
+    listen_fds[listen_count] = https_sock; listen_tls[listen_count++] = 1;
+    if (http6_sock  >= 0) { listen_fds[listen_count] = http6_sock;  listen_tls[listen_count++] = 0; }
+    if (https6_sock >= 0) { listen_fds[listen_count] = https6_sock; listen_tls[listen_count++] = 1; }
+
+    int uring_accept = io_engine_kind() == IO_ENGINE_URING &&
+                       io_accept_start(listen_fds, listen_count) == 0;
 
     // Main server loop
     while (!g_shutdown) {
@@ -595,15 +1162,34 @@ int main(int argc, char** argv) {
         // Handle cache refresh signal
         if (g_refresh_cache) {
             log_message(LOG_INFO, "Refreshing cache tree");
-
-            // Acquire write lock — blocks until all readers (worker threads) finish
-            pthread_rwlock_wrlock(&g_cache_rwlock);
-            cache_tree_refresh(&g_cache_tree, g_config.webroot);
-            pthread_rwlock_unlock(&g_cache_rwlock);
+            vhost_refresh_caches();
+            fd_cache_invalidate();
+            prefetch_warm_videos();
 
             g_refresh_cache = 0;
             log_message(LOG_INFO, "Cache refresh complete");
         }
+
+        // Certificates are reloaded off the accept thread; see ssl_reload_start()
+        if (g_reload_tls) {
+            g_reload_tls = 0;
+            ssl_reload_start();
+        }
+
+        if (g_reopen_logs) {
+            g_reopen_logs = 0;
+            log_reopen();
+        }
+
+        if (uring_accept) {
+            if (accept_uring_connections(listen_tls) < 0) {
+                log_message(LOG_WARN, "Multishot accept unsupported, falling back to select()");
+                io_accept_stop();
+                uring_accept = 0;
+            }
+            overload_monitor(g_thread_pool);
+            continue;
+        }
         
         // Setup select() for all active sockets (IPv4 + optional IPv6)
         fd_set read_fds;
@@ -630,118 +1216,17 @@ int main(int argc, char** argv) {
             break;
         }
         
+        overload_monitor(g_thread_pool);
+
         if (activity == 0) {
             // Timeout, no activity - just loop again to check signals
             continue;
         }
         
-        // ── IPv4 HTTP ──────────────────────────────────────────────────────────
-        if (FD_ISSET(http_sock, &read_fds)) {
-            struct sockaddr_in ca;
-            socklen_t al = sizeof(ca);
-            int client_fd = accept(http_sock, (struct sockaddr*)&ca, &al);
-            if (client_fd < 0) { if (errno != EINTR) log_message(LOG_ERROR, "accept() HTTP4: %s", strerror(errno)); }
-            else {
-                ThreadArgs* args = malloc(sizeof(ThreadArgs));
-                if (!args) { close(client_fd); }
-                else {
-                    args->client_fd   = client_fd;
-                    args->ssl         = NULL;
-                    args->client_port = ntohs(ca.sin_port);
-                    inet_ntop(AF_INET, &ca.sin_addr, args->client_ip, sizeof(args->client_ip));
-                    log_message(LOG_INFO, "New HTTP connection from %s:%d", args->client_ip, args->client_port);
-                    if (threadpool_add_work(g_thread_pool, handle_client_thread, args) != 0) {
-                        log_message(LOG_WARN, "Thread pool queue full, rejecting connection");
-                        close(client_fd); free(args);
-                    }
-                }
-            }
-        }
-
-        // ── IPv4 HTTPS ─────────────────────────────────────────────────────────
-        if (FD_ISSET(https_sock, &read_fds)) {
-            struct sockaddr_in ca;
-            socklen_t al = sizeof(ca);
-            int client_fd = accept(https_sock, (struct sockaddr*)&ca, &al);
-            if (client_fd < 0) { if (errno != EINTR) log_message(LOG_ERROR, "accept() HTTPS4: %s", strerror(errno)); }
-            else {
-                SSL* ssl = SSL_new(ssl_ctx);
-                if (!ssl) { close(client_fd); }
-                else {
-                    SSL_set_fd(ssl, client_fd);
-                    if (SSL_accept(ssl) <= 0) { ERR_clear_error(); SSL_free(ssl); close(client_fd); }
-                    else {
-                        ThreadArgs* args = malloc(sizeof(ThreadArgs));
-                        if (!args) { SSL_shutdown(ssl); SSL_free(ssl); close(client_fd); }
-                        else {
-                            args->client_fd   = client_fd;
-                            args->ssl         = ssl;
-                            args->client_port = ntohs(ca.sin_port);
-                            inet_ntop(AF_INET, &ca.sin_addr, args->client_ip, sizeof(args->client_ip));
-                            log_message(LOG_INFO, "New HTTPS connection from %s:%d", args->client_ip, args->client_port);
-                            if (threadpool_add_work(g_thread_pool, handle_client_thread, args) != 0) {
-                                log_message(LOG_WARN, "Thread pool queue full, rejecting connection");
-                                SSL_shutdown(ssl); SSL_free(ssl); close(client_fd); free(args);
-                            }
-                        }
-                    }
-                }
-            }
-        }
-
-        // ── IPv6 HTTP ──────────────────────────────────────────────────────────
-        if (http6_sock >= 0 && FD_ISSET(http6_sock, &read_fds)) {
-            struct sockaddr_in6 ca;
-            socklen_t al = sizeof(ca);
-            int client_fd = accept(http6_sock, (struct sockaddr*)&ca, &al);
-            if (client_fd < 0) { if (errno != EINTR) log_message(LOG_ERROR, "accept() HTTP6: %s", strerror(errno)); }
-            else {
-                ThreadArgs* args = malloc(sizeof(ThreadArgs));
-                if (!args) { close(client_fd); }
-                else {
-                    args->client_fd   = client_fd;
-                    args->ssl         = NULL;
-                    args->client_port = ntohs(ca.sin6_port);
-                    inet_ntop(AF_INET6, &ca.sin6_addr, args->client_ip, sizeof(args->client_ip));
-                    log_message(LOG_INFO, "New HTTP connection from [%s]:%d", args->client_ip, args->client_port);
-                    if (threadpool_add_work(g_thread_pool, handle_client_thread, args) != 0) {
-                        log_message(LOG_WARN, "Thread pool queue full, rejecting connection");
-                        close(client_fd); free(args);
-                    }
-                }
-            }
-        }
-
-        // ── IPv6 HTTPS ─────────────────────────────────────────────────────────
-        if (https6_sock >= 0 && FD_ISSET(https6_sock, &read_fds)) {
-            struct sockaddr_in6 ca;
-            socklen_t al = sizeof(ca);
-            int client_fd = accept(https6_sock, (struct sockaddr*)&ca, &al);
-            if (client_fd < 0) { if (errno != EINTR) log_message(LOG_ERROR, "accept() HTTPS6: %s", strerror(errno)); }
-            else {
-                SSL* ssl = SSL_new(ssl_ctx);
-                if (!ssl) { close(client_fd); }
-                else {
-                    SSL_set_fd(ssl, client_fd);
-                    if (SSL_accept(ssl) <= 0) { ERR_clear_error(); SSL_free(ssl); close(client_fd); }
-                    else {
-                        ThreadArgs* args = malloc(sizeof(ThreadArgs));
-                        if (!args) { SSL_shutdown(ssl); SSL_free(ssl); close(client_fd); }
-                        else {
-                            args->client_fd   = client_fd;
-                            args->ssl         = ssl;
-                            args->client_port = ntohs(ca.sin6_port);
-                            inet_ntop(AF_INET6, &ca.sin6_addr, args->client_ip, sizeof(args->client_ip));
-                            log_message(LOG_INFO, "New HTTPS connection from [%s]:%d", args->client_ip, args->client_port);
-                            if (threadpool_add_work(g_thread_pool, handle_client_thread, args) != 0) {
-                                log_message(LOG_WARN, "Thread pool queue full, rejecting connection");
-                                SSL_shutdown(ssl); SSL_free(ssl); close(client_fd); free(args);
-                            }
-                        }
-                    }
-                }
-            }
-        }
+        if (FD_ISSET(http_sock, &read_fds))  accept_connections(http_sock, 0);
+        if (FD_ISSET(https_sock, &read_fds)) accept_connections(https_sock, 1);
+        if (http6_sock  >= 0 && FD_ISSET(http6_sock,  &read_fds)) accept_connections(http6_sock, 0);
+        if (https6_sock >= 0 && FD_ISSET(https6_sock, &read_fds)) accept_connections(https6_sock, 1);
     }
     
     // Shutdown sequence
@@ -749,6 +1234,7 @@ int main(int argc, char** argv) {
     log_message(LOG_INFO, "Server shutdown initiated");
 
     // Stop accepting new connections
+    if (uring_accept) io_accept_stop();
     close(http_sock);
     close(https_sock);
     if (http6_sock  >= 0) close(http6_sock);
@@ -762,11 +1248,24 @@ int main(int argc, char** argv) {
     // Destroy thread pool
     printf("Destroying thread pool...\n");
     threadpool_destroy(g_thread_pool);
+
+    // Request workers are gone, so nothing can be waiting on a hash job
+    printf("Destroying crypto pool...\n");
+    crypto_pool_destroy();
+
+    timer_wheel_shutdown();
+    io_engine_shutdown();
+
+    // Workers are gone, so every slot is free
+    connection_table_destroy();
+    access_log_close();
+    trace_shutdown();
+    prefetch_shutdown();        // Returns its queued files to the fd cache
+    fd_cache_shutdown();
     
-    // Cleanup cache tree
+    // Cleanup cache trees and error pages
     printf("Freeing cache tree...\n");
-    cache_tree_free(g_cache_tree);
-    pthread_rwlock_destroy(&g_cache_rwlock);
+    vhost_shutdown();
     
     //Cleanup Mime Table
     printf("Destorying Mime Table\n");
@@ -783,12 +1282,9 @@ int main(int argc, char** argv) {
     // Cleanup session store
     session_store_destroy();
 
-    // Free error pages
-    error_pages_free();
-
     // Cleanup SSL
     printf("Cleaning up SSL...\n");
-    SSL_CTX_free(ssl_ctx);
+    ssl_context_shutdown();
     cleanup_openssl();
     
     // Cleanup config
@@ -0,0 +1,239 @@
+#include "connection.h"
+#include "request.h"
+#include "logger.h"
+#include "utils.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+
+/*
+ * The table is indexed directly by socket fd. The kernel hands out the
+ * lowest free descriptor, so the slots in use stay densely packed at the
+ * bottom of the table and a slot's read buffer is reused by whichever
+ * connection gets that fd next.
+ */
+static Connection* g_connections = NULL;
+static int         g_table_size  = 0;
+static int         g_high_water  = 0;   // One past the highest fd ever acquired
+static int         g_live        = 0;
+
+/**
+ * Allocates the fd-indexed connection table
+ *
+ * The table is sized to cover every fd the process can open, capped at
+ * max_connections. Slots are small and allocated up front; the large read
+ * buffers are only allocated the first time a slot serves a request.
+ *
+ * @param max_connections Upper bound on the number of slots
+ *
+ * @return 0 on success, -1 on allocation failure
+ *
+ * @see connection_acquire(), connection_table_destroy()
+ */
+int connection_table_init(int max_connections) {
+    int size = max_connections > 0 ? max_connections : 1024;
+
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY &&
+        rl.rlim_cur < (rlim_t)size) {
+        size = (int)rl.rlim_cur;
+    }
+
+    g_connections = calloc((size_t)size, sizeof(Connection));
+    if (!g_connections) {
+        log_message(LOG_ERROR, "Failed to allocate connection table (%d slots)", size);
+        return -1;
+    }
+
+    // A zeroed Client would look like it owns fd 0
+    for (int i = 0; i < size; i++) {
+        g_connections[i].client.fd = -1;
+    }
+
+    g_table_size = size;
+    g_high_water = 0;
+    g_live = 0;
+
+    log_message(LOG_INFO, "Connection table: %d slots", size);
+    return 0;
+}
+
+/**
+ * Frees the table and every slot's read buffer
+ *
+ * @warning Call only after all workers have stopped
+ */
+void connection_table_destroy(void) {
+    if (!g_connections) return;
+
+    for (int i = 0; i < g_high_water; i++) {
+        client_reset(&g_connections[i].client);
+        free(g_connections[i].read_buf);
+    }
+    free(g_connections);
+    g_connections = NULL;
+    g_table_size = 0;
+}
+
+/**
+ * Claims the slot for a newly accepted socket
+ *
+ * Resets the per-connection statistics and parser state but keeps the
+ * slot's read buffer. Called on the accept thread only.
+ *
+ * @param client_fd Accepted socket
+ *
+ * @return Slot for client_fd, or NULL if the fd does not fit in the table
+ */
+Connection* connection_acquire(int client_fd) {
+    if (!g_connections || client_fd < 0 || client_fd >= g_table_size) {
+        return NULL;
+    }
+
+    Connection* conn = &g_connections[client_fd];
+
+    conn->client_fd   = client_fd;
+    conn->ssl         = NULL;
+    conn->client_ip[0] = '\0';
+    conn->client_port = 0;
+    conn->buffered    = 0;
+    conn->tls_early   = 0;
+    conn->accepted_us = monotonic_us();
+    conn->bytes_in    = 0;
+    conn->bytes_out   = 0;
+    conn->requests    = 0;
+    conn->dequeued_us = 0;
+    conn->handshake_us = 0;
+    conn->response_total = 0;
+    conn->worker_tid  = 0;
+    conn->request_line[0] = '\0';
+    timer_init(&conn->timer, client_fd);
+
+    if (client_fd >= g_high_water) g_high_water = client_fd + 1;
+    __atomic_add_fetch(&g_live, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&conn->state, CONN_QUEUED, __ATOMIC_RELEASE);
+
+    return conn;
+}
+
+/**
+ * Returns a slot to the table
+ *
+ * Releases whatever the last request left in the embedded Client. The read
+ * buffer is kept for the next connection on this fd.
+ *
+ * @param conn Slot from connection_acquire()
+ *
+ * @warning Must be called before close(), otherwise the accept thread could
+ *          be handed the same fd and claim the slot while it is still in use
+ */
+void connection_release(Connection* conn) {
+    if (!conn) return;
+
+    client_reset(&conn->client);
+    conn->ssl = NULL;
+    conn->buffered = 0;
+
+    __atomic_store_n(&conn->state, CONN_FREE, __ATOMIC_RELEASE);
+    __atomic_sub_fetch(&g_live, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Ensures the slot has a read buffer
+ *
+ * @param conn Connection about to read its first request
+ *
+ * @return 0 on success, -1 on allocation failure
+ */
+int connection_alloc_buffer(Connection* conn) {
+    if (conn->read_buf) return 0;
+
+    conn->read_buf = malloc(CONNECTION_BUFFER_SIZE);
+    return conn->read_buf ? 0 : -1;
+}
+
+int connection_count(void) {
+    return __atomic_load_n(&g_live, __ATOMIC_RELAXED);
+}
+
+/* Copies one slot; the caller has checked it is live. Strings are copied
+ * with a terminator forced in, since the owner may be rewriting them. */
+static void fill_info(const Connection* conn, ConnState state, uint64_t now, ConnectionInfo* info) {
+    info->fd          = (int)(conn - g_connections);
+    memcpy(info->client_ip, conn->client_ip, sizeof(info->client_ip));
+    info->client_ip[sizeof(info->client_ip) - 1] = '\0';
+    info->client_port = conn->client_port;
+    info->is_ssl      = conn->ssl != NULL;
+    info->state       = state;
+    info->age_us      = now - conn->accepted_us;
+    info->bytes_in    = conn->bytes_in;
+    info->bytes_out   = conn->bytes_out;
+    info->requests    = conn->requests;
+    info->worker_tid  = conn->worker_tid;
+    memcpy(info->request_line, conn->request_line, sizeof(info->request_line));
+    info->request_line[sizeof(info->request_line) - 1] = '\0';
+
+    int in_request = state == CONN_PROCESSING || state == CONN_HASHING || state == CONN_WRITING;
+    uint64_t started = conn->request_start_us;
+    info->request_age_us = in_request && started && now > started ? now - started : 0;
+    info->response_sent  = in_request && conn->bytes_out > conn->request_bytes_out
+                         ? conn->bytes_out - conn->request_bytes_out : 0;
+    info->response_total = in_request ? conn->response_total : 0;
+}
+
+/**
+ * Copies the state of every live connection
+ *
+ * Reads are not synchronized with the owning workers, so counters may be a
+ * few bytes stale; that is fine for monitoring and keeps the hot path free
+ * of locks.
+ *
+ * @param out Destination array
+ * @param max Capacity of out
+ *
+ * @return Number of entries written
+ */
+int connection_snapshot(ConnectionInfo* out, int max) {
+    if (!g_connections || !out) return 0;
+
+    uint64_t now = monotonic_us();
+    int n = 0;
+    int limit = __atomic_load_n(&g_high_water, __ATOMIC_RELAXED);
+
+    for (int fd = 0; fd < limit && n < max; fd++) {
+        Connection* conn = &g_connections[fd];
+        ConnState state = __atomic_load_n(&conn->state, __ATOMIC_ACQUIRE);
+        if (state == CONN_FREE) continue;
+
+        fill_info(conn, state, now, &out[n++]);
+    }
+
+    return n;
+}
+
+int connection_describe(const Connection* conn, ConnectionInfo* info) {
+    if (!g_connections || !conn || conn < g_connections || conn >= g_connections + g_table_size) {
+        return -1;
+    }
+
+    ConnState state = __atomic_load_n(&conn->state, __ATOMIC_ACQUIRE);
+    if (state == CONN_FREE) return -1;
+
+    fill_info(conn, state, monotonic_us(), info);
+    return 0;
+}
+
+const char* connection_state_name(ConnState state) {
+    switch (state) {
+        case CONN_FREE:       return "free";
+        case CONN_QUEUED:     return "queued";
+        case CONN_HANDSHAKE:  return "handshake";
+        case CONN_IDLE:       return "idle";
+        case CONN_READING:    return "reading";
+        case CONN_PROCESSING: return "processing";
+        case CONN_HASHING:    return "hashing";
+        case CONN_WRITING:    return "writing";
+        default:              return "unknown";
+    }
+}
@@ -0,0 +1,605 @@
+#include "io_engine.h"
+#include "logger.h"
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+/*
+ * io_uring is driven with raw syscalls so the server does not depend on
+ * liburing. Workers keep the thread-per-connection model and use a small
+ * private ring each, one operation (or one linked chain) at a time; the
+ * savings come from batching, not from changing the concurrency model:
+ * a file chunk is read and sent with a single io_uring_enter(), and a
+ * single multishot accept keeps delivering connections without re-arming.
+ */
+
+#define WORKER_RING_ENTRIES 8
+#define ACCEPT_RING_ENTRIES 64
+#define MAX_LISTENERS       8
+
+typedef struct Ring {
+    int fd;
+    int enter_fd;               // Registered ring index, or fd
+    unsigned enter_flags;       // IORING_ENTER_REGISTERED_RING if registered
+
+    unsigned* sq_head;
+    unsigned* sq_tail;
+    unsigned* sq_array;
+    unsigned  sq_mask;
+    unsigned  sq_entries;
+    unsigned  sq_local_tail;    // SQEs prepared, published on enter
+    struct io_uring_sqe* sqes;
+
+    unsigned* cq_head;
+    unsigned* cq_tail;
+    unsigned  cq_mask;
+    struct io_uring_cqe* cqes;
+
+    void*  ring_map;
+    size_t ring_map_len;
+    size_t sqes_len;
+
+    char* buf;                  // Worker rings: file chunk buffer
+    int   buf_registered;       // buf is registered as fixed buffer 0
+} Ring;
+
+static IoEngineKind g_engine = IO_ENGINE_BLOCKING;
+static uint64_t     g_ops    = 0;
+static uint64_t     g_enters = 0;
+
+static pthread_key_t g_ring_key;
+static __thread Ring* t_ring = NULL;
+static __thread int   t_ring_failed = 0;
+
+// Accept ring; main thread only
+static Ring g_accept_ring = { .fd = -1 };
+static int  g_accept_fds[MAX_LISTENERS];
+static int  g_accept_count = 0;
+static int  g_accept_fixed = 0;
+static int  g_accept_rearm[MAX_LISTENERS];
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params* p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                              unsigned flags, const void* arg, size_t argsz) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int sys_io_uring_register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/**
+ * Creates a ring and maps its queues
+ *
+ * Setup flags are a hint: if the kernel rejects them the ring is created
+ * without. The ring fd is registered with the task when possible so that
+ * io_uring_enter() skips the fd lookup.
+ *
+ * @param ring Ring to initialize
+ * @param entries Submission queue size
+ * @param flags IORING_SETUP_* flags to try first
+ *
+ * @return 0 on success, -1 on failure (errno set)
+ */
+static int ring_init(Ring* ring, unsigned entries, unsigned flags) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    p.flags = flags;
+
+    int fd = sys_io_uring_setup(entries, &p);
+    if (fd < 0 && flags) {
+        memset(&p, 0, sizeof(p));
+        fd = sys_io_uring_setup(entries, &p);
+    }
+    if (fd < 0) return -1;
+
+    // Single shared SQ/CQ mapping exists since 5.4; older kernels use blocking
+    if (!(p.features & IORING_FEAT_SINGLE_MMAP)) {
+        close(fd);
+        errno = ENOSYS;
+        return -1;
+    }
+
+    size_t sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    size_t map_len = sq_len > cq_len ? sq_len : cq_len;
+
+    char* map = mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    size_t sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    void* sqes = mmap(NULL, sqes_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        munmap(map, map_len);
+        close(fd);
+        return -1;
+    }
+
+    memset(ring, 0, sizeof(*ring));
+    ring->fd           = fd;
+    ring->enter_fd     = fd;
+    ring->ring_map     = map;
+    ring->ring_map_len = map_len;
+    ring->sqes         = sqes;
+    ring->sqes_len     = sqes_len;
+
+    ring->sq_head    = (unsigned*)(map + p.sq_off.head);
+    ring->sq_tail    = (unsigned*)(map + p.sq_off.tail);
+    ring->sq_array   = (unsigned*)(map + p.sq_off.array);
+    ring->sq_mask    = *(unsigned*)(map + p.sq_off.ring_mask);
+    ring->sq_entries = p.sq_entries;
+    ring->sq_local_tail = *ring->sq_tail;
+
+    ring->cq_head = (unsigned*)(map + p.cq_off.head);
+    ring->cq_tail = (unsigned*)(map + p.cq_off.tail);
+    ring->cq_mask = *(unsigned*)(map + p.cq_off.ring_mask);
+    ring->cqes    = (struct io_uring_cqe*)(map + p.cq_off.cqes);
+
+    struct io_uring_rsrc_update reg = { .offset = -1U, .data = (uint64_t)fd };
+    if (sys_io_uring_register(fd, IORING_REGISTER_RING_FDS, &reg, 1) == 1) {
+        ring->enter_fd    = (int)reg.offset;
+        ring->enter_flags = IORING_ENTER_REGISTERED_RING;
+    }
+
+    return 0;
+}
+
+static void ring_free(Ring* ring) {
+    if (ring->fd < 0) return;
+
+    munmap(ring->sqes, ring->sqes_len);
+    munmap(ring->ring_map, ring->ring_map_len);
+    close(ring->fd);
+    ring->fd = -1;
+}
+
+/* Returns a zeroed SQE, or NULL if the submission queue is full. */
+static struct io_uring_sqe* ring_get_sqe(Ring* ring) {
+    unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sq_local_tail - head >= ring->sq_entries) return NULL;
+
+    unsigned index = ring->sq_local_tail & ring->sq_mask;
+    struct io_uring_sqe* sqe = &ring->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    ring->sq_array[index] = index;
+    ring->sq_local_tail++;
+    return sqe;
+}
+
+/**
+ * Submits prepared SQEs and waits for completions
+ *
+ * Signals interrupt the wait but not the submission. An untimed wait is
+ * resumed without resubmitting; a timed one returns -EINTR so the main loop
+ * can notice shutdown.
+ *
+ * @param ring Ring
+ * @param wait_nr Completions to wait for
+ * @param timeout_ms Maximum wait, or -1 to wait indefinitely
+ *
+ * @return 0 on success, -ETIME on timeout, other negative errno on failure
+ */
+static int ring_enter(Ring* ring, unsigned wait_nr, int timeout_ms) {
+    unsigned to_submit = ring->sq_local_tail - *ring->sq_tail;
+    __atomic_store_n(ring->sq_tail, ring->sq_local_tail, __ATOMIC_RELEASE);
+
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    unsigned flags = ring->enter_flags | (wait_nr ? IORING_ENTER_GETEVENTS : 0);
+    const void* argp = NULL;
+    size_t argsz = 0;
+
+    if (timeout_ms >= 0) {
+        ts.tv_sec  = timeout_ms / 1000;
+        ts.tv_nsec = (long long)(timeout_ms % 1000) * 1000000;
+        memset(&arg, 0, sizeof(arg));
+        arg.ts = (uint64_t)(uintptr_t)&ts;
+        argp  = &arg;
+        argsz = sizeof(arg);
+        flags |= IORING_ENTER_EXT_ARG;
+    }
+
+    __atomic_add_fetch(&g_ops, to_submit, __ATOMIC_RELAXED);
+
+    while (1) {
+        __atomic_add_fetch(&g_enters, 1, __ATOMIC_RELAXED);
+        int ret = sys_io_uring_enter(ring->enter_fd, to_submit, wait_nr, flags, argp, argsz);
+        if (ret >= 0) return 0;
+        if (errno == EINTR && wait_nr && timeout_ms < 0) {
+            to_submit = 0;
+            continue;
+        }
+        return -errno;
+    }
+}
+
+/* Next unconsumed completion, or NULL if the CQ is empty. */
+static struct io_uring_cqe* ring_peek_cqe(Ring* ring) {
+    unsigned head = *ring->cq_head;
+    unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+    return head == tail ? NULL : &ring->cqes[head & ring->cq_mask];
+}
+
+static void ring_cqe_seen(Ring* ring) {
+    __atomic_store_n(ring->cq_head, *ring->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+/* Waits for one completion and consumes it; returns its user_data and res. */
+static int ring_wait_one(Ring* ring, uint64_t* user_data, int* res) {
+    struct io_uring_cqe* cqe;
+    while ((cqe = ring_peek_cqe(ring)) == NULL) {
+        int ret = ring_enter(ring, 1, -1);
+        if (ret < 0) return ret;
+    }
+    *user_data = cqe->user_data;
+    *res = cqe->res;
+    ring_cqe_seen(ring);
+    return 0;
+}
+
+/* Submits the single prepared SQE and returns its result, read(2)-style. */
+static ssize_t ring_run_one(Ring* ring) {
+    int ret = ring_enter(ring, 1, -1);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+
+    uint64_t user_data;
+    int res;
+    ret = ring_wait_one(ring, &user_data, &res);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+    if (res < 0) {
+        errno = -res;
+        return -1;
+    }
+    return res;
+}
+
+static void worker_ring_destroy(void* arg) {
+    Ring* ring = (Ring*)arg;
+    ring_free(ring);
+    free(ring->buf);
+    free(ring);
+}
+
+/**
+ * Returns the calling thread's ring, creating it on first use
+ *
+ * The chunk buffer is registered with the ring so file reads use
+ * READ_FIXED and skip the per-call page pinning. A thread whose ring cannot
+ * be created falls back to blocking syscalls for its lifetime.
+ *
+ * @return Ring, or NULL if this thread uses blocking I/O
+ */
+static Ring* worker_ring(void) {
+    if (t_ring || t_ring_failed || g_engine != IO_ENGINE_URING) return t_ring;
+
+    Ring* ring = calloc(1, sizeof(Ring));
+    if (!ring || ring_init(ring, WORKER_RING_ENTRIES,
+                           IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_COOP_TASKRUN) < 0) {
+        log_message(LOG_WARN, "io_uring ring setup failed (%s), thread uses blocking I/O",
+                    strerror(errno));
+        free(ring);
+        t_ring_failed = 1;
+        return NULL;
+    }
+
+    ring->buf = aligned_alloc(4096, IO_ENGINE_CHUNK);
+    if (!ring->buf) {
+        ring_free(ring);
+        free(ring);
+        t_ring_failed = 1;
+        return NULL;
+    }
+
+    struct iovec iov = { .iov_base = ring->buf, .iov_len = IO_ENGINE_CHUNK };
+    ring->buf_registered =
+        sys_io_uring_register(ring->fd, IORING_REGISTER_BUFFERS, &iov, 1) == 0;
+
+    pthread_setspecific(g_ring_key, ring);
+    t_ring = ring;
+    return ring;
+}
+
+/**
+ * Selects the I/O engine
+ *
+ * For "io_uring" a throwaway ring is created to confirm the kernel allows
+ * it (io_uring may be compiled out or disabled by sysctl or seccomp); any
+ * failure falls back to the blocking engine.
+ *
+ * @param name Engine name from the configuration
+ *
+ * @return Engine actually in use
+ */
+IoEngineKind io_engine_init(const char* name) {
+    g_engine = IO_ENGINE_BLOCKING;
+
+    if (!name || strcmp(name, "io_uring") != 0) {
+        if (name && strcmp(name, "blocking") != 0) {
+            log_message(LOG_WARN, "Unknown io_engine '%s', using blocking", name);
+        }
+        return g_engine;
+    }
+
+    Ring probe;
+    if (ring_init(&probe, WORKER_RING_ENTRIES, 0) < 0) {
+        log_message(LOG_WARN, "io_uring unavailable (%s), using blocking I/O", strerror(errno));
+        return g_engine;
+    }
+    ring_free(&probe);
+
+    if (pthread_key_create(&g_ring_key, worker_ring_destroy) != 0) {
+        return g_engine;
+    }
+
+    g_engine = IO_ENGINE_URING;
+    log_message(LOG_INFO, "I/O engine: io_uring");
+    return g_engine;
+}
+
+IoEngineKind io_engine_kind(void) {
+    return g_engine;
+}
+
+const char* io_engine_name(void) {
+    return g_engine == IO_ENGINE_URING ? "io_uring" : "blocking";
+}
+
+/**
+ * Logs how many operations were batched per io_uring_enter()
+ *
+ * @note Worker rings are freed by their threads' key destructors
+ */
+void io_engine_shutdown(void) {
+    if (g_engine != IO_ENGINE_URING) return;
+
+    struct IoEngineStats stats;
+    io_engine_get_stats(&stats);
+    log_message(LOG_INFO, "io_uring: %llu ops in %llu io_uring_enter calls",
+                (unsigned long long)stats.ops, (unsigned long long)stats.enters);
+}
+
+void io_engine_get_stats(struct IoEngineStats* stats) {
+    stats->ops    = __atomic_load_n(&g_ops, __ATOMIC_RELAXED);
+    stats->enters = __atomic_load_n(&g_enters, __ATOMIC_RELAXED);
+}
+
+/**
+ * Receives from a plaintext socket
+ *
+ * @return Same as recv(2)
+ */
+ssize_t io_recv(int fd, void* buf, size_t len) {
+    Ring* ring = worker_ring();
+    if (!ring) return recv(fd, buf, len, 0);
+
+    struct io_uring_sqe* sqe = ring_get_sqe(ring);
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd     = fd;
+    sqe->addr   = (uint64_t)(uintptr_t)buf;
+    sqe->len    = (uint32_t)len;
+    return ring_run_one(ring);
+}
+
+/**
+ * Sends on a plaintext socket without raising SIGPIPE
+ *
+ * @return Same as send(2); may be a partial write
+ */
+ssize_t io_send(int fd, const void* buf, size_t len) {
+    Ring* ring = worker_ring();
+    if (!ring) return send(fd, buf, len, MSG_NOSIGNAL);
+
+    struct io_uring_sqe* sqe = ring_get_sqe(ring);
+    sqe->opcode    = IORING_OP_SEND;
+    sqe->fd        = fd;
+    sqe->addr      = (uint64_t)(uintptr_t)buf;
+    sqe->len       = (uint32_t)len;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    return ring_run_one(ring);
+}
+
+int io_uring_ready(void) {
+    return worker_ring() != NULL;
+}
+
+/**
+ * Moves one chunk of a file to a socket with a linked read->send chain
+ *
+ * Both operations go to the kernel in one io_uring_enter(). The read is
+ * positioned like pread(2) and leaves the file offset alone, so the fd
+ * can be shared by workers (see fd_cache.h). If the read comes up short
+ * the kernel cancels the linked send, and the bytes that were read are
+ * sent separately.
+ *
+ * @param file_fd File opened for reading
+ * @param sock_fd Connected plaintext socket
+ * @param offset File offset to read from
+ * @param len Bytes to move, at most IO_ENGINE_CHUNK
+ *
+ * @return Bytes sent, 0 at EOF or on read error, -1 on send error (errno set)
+ *
+ * @warning Call only when io_uring_ready() is nonzero
+ */
+ssize_t io_file_to_socket(int file_fd, int sock_fd, off_t offset, size_t len) {
+    Ring* ring = worker_ring();
+    if (len > IO_ENGINE_CHUNK) len = IO_ENGINE_CHUNK;
+
+    struct io_uring_sqe* rd = ring_get_sqe(ring);
+    rd->opcode    = ring->buf_registered ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    rd->fd        = file_fd;
+    rd->off       = (uint64_t)offset;
+    rd->addr      = (uint64_t)(uintptr_t)ring->buf;
+    rd->len       = (uint32_t)len;
+    rd->buf_index = 0;
+    rd->flags     = IOSQE_IO_LINK;
+    rd->user_data = 1;
+
+    struct io_uring_sqe* wr = ring_get_sqe(ring);
+    wr->opcode    = IORING_OP_SEND;
+    wr->fd        = sock_fd;
+    wr->addr      = (uint64_t)(uintptr_t)ring->buf;
+    wr->len       = (uint32_t)len;
+    wr->msg_flags = MSG_NOSIGNAL | MSG_WAITALL;
+    wr->user_data = 2;
+
+    int ret = ring_enter(ring, 2, -1);
+    if (ret < 0) {
+        errno = -ret;
+        return -1;
+    }
+
+    int read_res = 0, send_res = 0;
+    for (int i = 0; i < 2; i++) {
+        uint64_t user_data;
+        int res;
+        ret = ring_wait_one(ring, &user_data, &res);
+        if (ret < 0) {
+            errno = -ret;
+            return -1;
+        }
+        if (user_data == 1) read_res = res;
+        else                send_res = res;
+    }
+
+    if (read_res <= 0) return 0;
+    if (send_res == -ECANCELED) send_res = 0;   // Short read broke the link
+    if (send_res < 0) {
+        errno = -send_res;
+        return -1;
+    }
+
+    size_t sent = (size_t)send_res;
+    while (sent < (size_t)read_res) {
+        ssize_t n = io_send(sock_fd, ring->buf + sent, (size_t)read_res - sent);
+        if (n < 0) return -1;
+        sent += (size_t)n;
+    }
+    return read_res;
+}
+
+/* Queues a multishot accept for listener index i. */
+static int accept_arm(int i) {
+    struct io_uring_sqe* sqe = ring_get_sqe(&g_accept_ring);
+    if (!sqe) return -1;
+
+    sqe->opcode    = IORING_OP_ACCEPT;
+    sqe->fd        = g_accept_fixed ? i : g_accept_fds[i];
+    sqe->flags     = g_accept_fixed ? IOSQE_FIXED_FILE : 0;
+    sqe->ioprio    = IORING_ACCEPT_MULTISHOT;
+    sqe->user_data = (uint64_t)i;
+    g_accept_rearm[i] = 0;
+    return 0;
+}
+
+/**
+ * Starts multishot accepts on the listening sockets
+ *
+ * The listeners are registered as fixed files. Peer addresses are not
+ * collected (one multishot request shares a single address buffer), so the
+ * caller uses getpeername().
+ *
+ * @param listen_fds Listening sockets
+ * @param count Number of sockets (at most MAX_LISTENERS)
+ *
+ * @return 0 on success, -1 if the io_uring engine is not in use
+ */
+int io_accept_start(const int* listen_fds, int count) {
+    if (g_engine != IO_ENGINE_URING || count <= 0 || count > MAX_LISTENERS) return -1;
+
+    if (ring_init(&g_accept_ring, ACCEPT_RING_ENTRIES, IORING_SETUP_SINGLE_ISSUER) < 0) {
+        log_message(LOG_WARN, "io_uring accept ring failed: %s", strerror(errno));
+        return -1;
+    }
+
+    memcpy(g_accept_fds, listen_fds, sizeof(int) * (size_t)count);
+    g_accept_count = count;
+    g_accept_fixed = sys_io_uring_register(g_accept_ring.fd, IORING_REGISTER_FILES,
+                                           g_accept_fds, (unsigned)count) == 0;
+
+    for (int i = 0; i < count; i++) {
+        accept_arm(i);
+    }
+
+    log_message(LOG_INFO, "Multishot accept on %d listeners%s", count,
+                g_accept_fixed ? " (registered)" : "");
+    return 0;
+}
+
+/**
+ * Collects accepted connections
+ *
+ * Submits any re-arms, waits up to timeout_ms for the first completion and
+ * then drains what is ready. A multishot request ends when the kernel
+ * clears IORING_CQE_F_MORE (e.g. after EMFILE); it is re-armed on the next
+ * call.
+ *
+ * @param events Output array
+ * @param max Capacity of events
+ * @param timeout_ms Maximum wait
+ *
+ * @return Number of events, or -1 if multishot accept is unsupported
+ */
+int io_accept_wait(IoAcceptEvent* events, int max, int timeout_ms) {
+    for (int i = 0; i < g_accept_count; i++) {
+        if (g_accept_rearm[i]) accept_arm(i);
+    }
+
+    int n = 0;
+    if (!ring_peek_cqe(&g_accept_ring)) {
+        int ret = ring_enter(&g_accept_ring, 1, timeout_ms);
+        if (ret < 0 && ret != -ETIME && ret != -EINTR) {
+            log_message(LOG_ERROR, "io_uring_enter (accept): %s", strerror(-ret));
+            return -1;
+        }
+    }
+
+    struct io_uring_cqe* cqe;
+    while (n < max && (cqe = ring_peek_cqe(&g_accept_ring)) != NULL) {
+        int listener = (int)cqe->user_data;
+        int res = cqe->res;
+        int more = cqe->flags & IORING_CQE_F_MORE;
+        ring_cqe_seen(&g_accept_ring);
+
+        if (!more) g_accept_rearm[listener] = 1;
+
+        if (res >= 0 || res == -EMFILE || res == -ENFILE) {
+            events[n].listener = listener;
+            events[n].fd = res;
+            n++;
+        } else if (res == -EINVAL) {
+            // Pre-5.19 kernel: no multishot accept
+            return -1;
+        } else if (res != -EAGAIN && res != -EINTR) {
+            log_message(LOG_ERROR, "accept(): %s", strerror(-res));
+        }
+    }
+
+    return n;
+}
+
+void io_accept_stop(void) {
+    ring_free(&g_accept_ring);
+    g_accept_count = 0;
+}
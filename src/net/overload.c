@@ -0,0 +1,128 @@
+#include "overload.h"
+#include "logger.h"
+#include "utils.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+static char   g_503_response[256];
+static size_t g_503_len = 0;
+
+static unsigned long g_accept_shed = 0;
+static unsigned long g_codel_shed  = 0;
+
+// Last state reported by overload_monitor(); main thread only
+static uint64_t g_last_report_us = 0;
+static int g_reported_overload = 0;
+static int g_last_rejected = 0;
+static int g_last_shed = 0;
+
+/**
+ * Prepares the canned 503 response sent to shed connections
+ *
+ * The response is formatted once so that rejecting a connection costs a
+ * single non-blocking send() and no allocation, formatting or date lookup.
+ *
+ * @param retry_after Seconds to advertise in the Retry-After header
+ */
+void overload_init(int retry_after) {
+    static const char body[] = "503 Service Unavailable\n";
+
+    int len = snprintf(g_503_response, sizeof(g_503_response),
+        "HTTP/1.1 503 Service Unavailable\r\n"
+        "Content-Type: text/plain\r\n"
+        "Content-Length: %zu\r\n"
+        "Retry-After: %d\r\n"
+        "Connection: close\r\n"
+        "\r\n"
+        "%s",
+        sizeof(body) - 1, retry_after, body);
+
+    g_503_len = (len > 0 && (size_t)len < sizeof(g_503_response)) ? (size_t)len : 0;
+}
+
+/**
+ * Sends the canned 503 on a plaintext socket and closes it
+ *
+ * Uses MSG_DONTWAIT so a slow or hostile peer can never stall the caller.
+ * The write side is shut down and any request bytes already received are
+ * drained before close(), otherwise the kernel answers unread data with an
+ * RST and the client may never see the 503.
+ *
+ * @param client_fd Accepted client socket (closed on return)
+ */
+void overload_reject(int client_fd) {
+    if (g_503_len > 0) {
+        send(client_fd, g_503_response, g_503_len, MSG_DONTWAIT | MSG_NOSIGNAL);
+    }
+    shutdown(client_fd, SHUT_WR);
+
+    char drain[1024];
+    while (recv(client_fd, drain, sizeof(drain), MSG_DONTWAIT) > 0) { }
+
+    close(client_fd);
+}
+
+/**
+ * Closes an HTTPS connection that cannot be admitted
+ *
+ * A 503 can only be delivered after a full TLS handshake, which is exactly
+ * the work we cannot afford under overload, so the socket is closed before
+ * SSL_accept() is ever called.
+ *
+ * @param client_fd Accepted client socket (closed on return)
+ */
+void overload_reject_tls(int client_fd) {
+    close(client_fd);
+}
+
+void overload_note_codel_shed(void) {
+    __atomic_fetch_add(&g_codel_shed, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Logs overload transitions and shed counts
+ *
+ * Called from the main loop after every accept wakeup, but reports at most
+ * once a second. Individual rejections are not logged (that would add a log
+ * line per refused connection exactly when the server can least afford it);
+ * instead this reports the totals accumulated over the interval.
+ *
+ * @param pool Request thread pool to sample
+ */
+void overload_monitor(struct ThreadPool* pool) {
+    struct ThreadPoolStats stats;
+    threadpool_get_stats(pool, &stats);
+
+    __atomic_store_n(&g_accept_shed, (unsigned long)stats.rejected_work, __ATOMIC_RELAXED);
+
+    uint64_t now = monotonic_us();
+    if (now - g_last_report_us < 1000000) return;
+    g_last_report_us = now;
+
+    int rejected = stats.rejected_work - g_last_rejected;
+    int shed     = stats.shed_work - g_last_shed;
+    g_last_rejected = stats.rejected_work;
+    g_last_shed     = stats.shed_work;
+
+    int overloaded = stats.dropping || rejected > 0 || shed > 0;
+
+    if (overloaded) {
+        log_message(LOG_WARN,
+                    "Overload: queue=%d active=%d avg_wait=%lluus rejected=%d shed=%d",
+                    stats.queued_work, stats.active_threads,
+                    (unsigned long long)stats.avg_wait_us, rejected, shed);
+    } else if (g_reported_overload) {
+        log_message(LOG_INFO, "Overload cleared: queue=%d avg_wait=%lluus",
+                    stats.queued_work, (unsigned long long)stats.avg_wait_us);
+    }
+    g_reported_overload = overloaded;
+}
+
+void overload_get_stats(struct OverloadStats* stats) {
+    if (!stats) return;
+    stats->accept_shed = __atomic_load_n(&g_accept_shed, __ATOMIC_RELAXED);
+    stats->codel_shed  = __atomic_load_n(&g_codel_shed, __ATOMIC_RELAXED);
+}
@@ -1,5 +1,93 @@
 #include "ssl_handler.h"
 #include "config.h"
+#include "logger.h"
+#include "metrics.h"
+#include "utils.h"
+
+#include <pthread.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <openssl/rand.h>
+#include <openssl/evp.h>
+#include <openssl/core_names.h>
+#include <openssl/params.h>
+
+#if defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#define TICKET_KEY_NAME_LEN 16
+
+// One session ticket key: name (sent in the clear), AES and HMAC secrets
+typedef struct {
+    unsigned char name[TICKET_KEY_NAME_LEN];
+    unsigned char aes_key[32];
+    unsigned char hmac_key[32];
+    time_t        created;
+    int           valid;
+} TicketKey;
+
+/* New tickets are sealed with the current key; tickets sealed with the
+ * previous key are still accepted (and reissued) for one more rotation. */
+static TicketKey        g_ticket_current;
+static TicketKey        g_ticket_previous;
+static pthread_rwlock_t g_ticket_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+/* Context for new connections. Each SSL holds its own reference to the
+ * context it was created from, so replacing this pointer never pulls a
+ * context out from under a live connection. */
+static SSL_CTX*        g_ssl_ctx = NULL;
+static pthread_mutex_t g_ctx_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t       g_reload_thread;
+static int             g_reload_started = 0;   // g_reload_thread needs joining
+static int             g_reload_running = 0;
+
+/* Certificates of the virtual hosts, picked by SNI. The table hangs off the
+ * default context as ex_data and is freed with it, so a reload replaces
+ * the default context and every host context in one swap. */
+typedef struct {
+    int         count;
+    const char* names[MAX_VHOSTS];   // Point into g_config.vhosts
+    SSL_CTX*    ctxs[MAX_VHOSTS];
+} SniTable;
+
+static int g_sni_index = -1;
+static int g_handshake_start_index = -1;    // SSL ex_data: monotonic_us() at ssl_handshake_begin()
+
+static unsigned long g_tickets_issued     = 0;
+static unsigned long g_tickets_accepted   = 0;
+static unsigned long g_tickets_renewed    = 0;
+static unsigned long g_tickets_rejected   = 0;
+static unsigned long g_key_rotations      = 0;
+static unsigned long g_early_served       = 0;
+static unsigned long g_early_too_early    = 0;
+static unsigned long g_reloads            = 0;
+static unsigned long g_reload_failures    = 0;
+
+/* ex_data free callback: releases the SNI table and its per-vhost contexts. */
+static void sni_table_free(void* parent, void* ptr, CRYPTO_EX_DATA* ad,
+                           int idx, long argl, void* argp) {
+    (void)parent; (void)ad; (void)idx; (void)argl; (void)argp;
+    SniTable* table = ptr;
+    if (!table) return;
+
+    for (int i = 0; i < table->count; i++) {
+        SSL_CTX_free(table->ctxs[i]);
+    }
+    free(table);
+}
+
+/* Text of the earliest queued OpenSSL error (the root cause) for a log
+ * line. Clears the thread's error queue. */
+static const char* ssl_error_reason(char* buf, size_t len) {
+    unsigned long err = ERR_peek_error();
+    if (err) ERR_error_string_n(err, buf, len);
+    else snprintf(buf, len, "no OpenSSL error queued");
+    ERR_clear_error();
+    return buf;
+}
 
 /**
  * Initializes the OpenSSL library
@@ -15,6 +103,169 @@
  */
 void init_openssl() {
     OPENSSL_init_ssl(OPENSSL_INIT_LOAD_SSL_STRINGS | OPENSSL_INIT_LOAD_CRYPTO_STRINGS, NULL);
+    g_sni_index = SSL_CTX_get_ex_new_index(0, NULL, NULL, NULL, sni_table_free);
+    g_handshake_start_index = SSL_get_ex_new_index(0, NULL, NULL, NULL, NULL);
+}
+
+/* Generates a fresh ticket key. Returns 0 on success, -1 if RAND fails. */
+static int ticket_key_generate(TicketKey* key) {
+    if (RAND_bytes(key->name, sizeof(key->name)) != 1 ||
+        RAND_priv_bytes(key->aes_key, sizeof(key->aes_key)) != 1 ||
+        RAND_priv_bytes(key->hmac_key, sizeof(key->hmac_key)) != 1) {
+        return -1;
+    }
+    key->created = time(NULL);
+    key->valid = 1;
+    return 0;
+}
+
+/**
+ * Retires the current ticket key if it is older than the rotation period
+ *
+ * Called whenever a ticket is sealed or opened, so rotation needs no timer
+ * of its own. The retired key keeps decrypting for one more period.
+ */
+static void ticket_keys_maybe_rotate(void) {
+    extern struct ServerConfig g_config;
+    time_t now = time(NULL);
+
+    pthread_rwlock_rdlock(&g_ticket_lock);
+    int due = !g_ticket_current.valid ||
+              now - g_ticket_current.created >= g_config.tls_ticket_rotation;
+    pthread_rwlock_unlock(&g_ticket_lock);
+    if (!due) return;
+
+    TicketKey fresh;
+    if (ticket_key_generate(&fresh) < 0) {
+        log_message(LOG_ERROR, "Failed to generate session ticket key");
+        return;
+    }
+
+    pthread_rwlock_wrlock(&g_ticket_lock);
+    // Another thread may have rotated while we generated
+    if (!g_ticket_current.valid ||
+        now - g_ticket_current.created >= g_config.tls_ticket_rotation) {
+        OPENSSL_cleanse(&g_ticket_previous, sizeof(g_ticket_previous));
+        g_ticket_previous = g_ticket_current;
+        g_ticket_current = fresh;
+        __atomic_add_fetch(&g_key_rotations, 1, __ATOMIC_RELAXED);
+    }
+    pthread_rwlock_unlock(&g_ticket_lock);
+
+    OPENSSL_cleanse(&fresh, sizeof(fresh));
+}
+
+/* Loads a key's secrets into the cipher and MAC contexts. */
+static int ticket_key_apply(const TicketKey* key, const unsigned char* iv,
+                            EVP_CIPHER_CTX* cctx, EVP_MAC_CTX* hctx, int enc) {
+    OSSL_PARAM params[3];
+    params[0] = OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY,
+                    (void*)key->hmac_key, sizeof(key->hmac_key));
+    params[1] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, "SHA256", 0);
+    params[2] = OSSL_PARAM_construct_end();
+
+    if (!EVP_MAC_CTX_set_params(hctx, params)) return 0;
+    if (enc) {
+        return EVP_EncryptInit_ex(cctx, EVP_aes_256_cbc(), NULL, key->aes_key, iv);
+    }
+    return EVP_DecryptInit_ex(cctx, EVP_aes_256_cbc(), NULL, key->aes_key, iv);
+}
+
+/**
+ * Session ticket key callback (stateless resumption)
+ *
+ * Seals new tickets with the current key and opens tickets sealed with the
+ * current or previous key. Tickets from the previous key are renewed so
+ * clients migrate before that key is discarded.
+ *
+ * @return 1 ok, 2 ok and renew (decrypt only), 0 unknown key (full
+ *         handshake), -1 error
+ */
+static int ticket_key_callback(SSL* ssl, unsigned char key_name[16], unsigned char* iv,
+                               EVP_CIPHER_CTX* cctx, EVP_MAC_CTX* hctx, int enc) {
+    (void)ssl;
+
+    ticket_keys_maybe_rotate();
+
+    if (enc) {
+        if (RAND_bytes(iv, EVP_CIPHER_get_iv_length(EVP_aes_256_cbc())) != 1) return -1;
+
+        pthread_rwlock_rdlock(&g_ticket_lock);
+        memcpy(key_name, g_ticket_current.name, TICKET_KEY_NAME_LEN);
+        int ok = ticket_key_apply(&g_ticket_current, iv, cctx, hctx, 1);
+        pthread_rwlock_unlock(&g_ticket_lock);
+
+        if (!ok) return -1;
+        __atomic_add_fetch(&g_tickets_issued, 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+
+    int result = 0;
+    pthread_rwlock_rdlock(&g_ticket_lock);
+    if (g_ticket_current.valid &&
+        memcmp(key_name, g_ticket_current.name, TICKET_KEY_NAME_LEN) == 0) {
+        result = ticket_key_apply(&g_ticket_current, iv, cctx, hctx, 0) ? 1 : -1;
+    } else if (g_ticket_previous.valid &&
+               memcmp(key_name, g_ticket_previous.name, TICKET_KEY_NAME_LEN) == 0) {
+        result = ticket_key_apply(&g_ticket_previous, iv, cctx, hctx, 0) ? 2 : -1;
+    }
+    pthread_rwlock_unlock(&g_ticket_lock);
+
+    if (result == 1)      __atomic_add_fetch(&g_tickets_accepted, 1, __ATOMIC_RELAXED);
+    else if (result == 2) __atomic_add_fetch(&g_tickets_renewed, 1, __ATOMIC_RELAXED);
+    else if (result == 0) __atomic_add_fetch(&g_tickets_rejected, 1, __ATOMIC_RELAXED);
+    return result;
+}
+
+/**
+ * Enables session resumption on a context
+ *
+ * Resumption skips the certificate signature and key exchange, which is
+ * where nearly all handshake CPU goes. Two mechanisms are enabled:
+ * a server-side session cache (TLS 1.2 session IDs), shared by all worker
+ * threads, and stateless session tickets (TLS 1.2 and 1.3) sealed with keys
+ * generated at startup and rotated every tls_ticket_rotation seconds.
+ *
+ * @param ctx Context to configure
+ */
+static void configure_session_resumption(SSL_CTX* ctx) {
+    extern struct ServerConfig g_config;
+
+    // Binds cached sessions to this server so they are not offered elsewhere
+    static const unsigned char sid_ctx[] = "snap";
+    SSL_CTX_set_session_id_context(ctx, sid_ctx, sizeof(sid_ctx) - 1);
+
+    if (g_config.tls_session_cache_size > 0) {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER);
+        SSL_CTX_sess_set_cache_size(ctx, g_config.tls_session_cache_size);
+    } else {
+        SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_OFF);
+    }
+    SSL_CTX_set_timeout(ctx, g_config.tls_session_timeout);
+
+    if (g_config.tls_ticket_rotation > 0) {
+        ticket_keys_maybe_rotate();
+        SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, ticket_key_callback);
+    } else {
+        SSL_CTX_set_options(ctx, SSL_OP_NO_TICKET);
+    }
+
+    /* 0-RTT: OpenSSL's anti-replay check lets each ticket carry early data
+     * only once, and it keeps that record in the session cache. */
+    if (g_config.tls_early_data > 0) {
+        if (g_config.tls_session_cache_size > 0) {
+            SSL_CTX_set_max_early_data(ctx, (uint32_t)g_config.tls_early_data);
+            SSL_CTX_set_recv_max_early_data(ctx, (uint32_t)g_config.tls_early_data);
+            log_message(LOG_INFO, "TLS 1.3 early data: up to %d bytes", g_config.tls_early_data);
+        } else {
+            log_message(LOG_WARN, "TLS early data needs the session cache for anti-replay; disabled");
+        }
+    }
+
+    log_message(LOG_INFO, "TLS resumption: cache %d sessions, tickets %s, lifetime %ds",
+                g_config.tls_session_cache_size,
+                g_config.tls_ticket_rotation > 0 ? "on" : "off",
+                g_config.tls_session_timeout);
 }
 
 /**
@@ -22,72 +273,377 @@ void init_openssl() {
  *
  * Creates a new SSL_CTX structure for managing SSL/TLS connections. Uses
  * SSLv23_server_method() to support multiple protocol versions while
- * allowing negotiation with clients.
+ * allowing negotiation with clients. Session caching and ticket keys are
+ * configured here as well.
  *
- * @return Pointer to initialized SSL_CTX structure
+ * @return Pointer to initialized SSL_CTX structure, NULL on failure
  *
- * @note Exits program with error message if context creation fails
  * @warning Caller must free context with SSL_CTX_free() when done
  *
- * @see configure_ssl_context(), cleanup_openssl()
+ * @see configure_ssl_context(), ssl_context_build()
  */
 SSL_CTX* create_ssl_context() {
     const SSL_METHOD *method;
     SSL_CTX *ctx;
 
     method = TLS_server_method();
+    char reason[256];
     ctx = SSL_CTX_new(method);
     if (!ctx) {
-        perror("Unable to create SSL context");
-        ERR_print_errors_fp(stderr);
-        exit(1);
+        log_message(LOG_ERROR, "Unable to create SSL context: %s",
+                    ssl_error_reason(reason, sizeof(reason)));
+        return NULL;
     }
 
     /* Reject TLS 1.0 and 1.1 — require TLS 1.2 or higher. */
     if (SSL_CTX_set_min_proto_version(ctx, TLS1_2_VERSION) != 1) {
-        fprintf(stderr, "Failed to set minimum TLS version\n");
+        log_message(LOG_ERROR, "Failed to set minimum TLS version: %s",
+                    ssl_error_reason(reason, sizeof(reason)));
         SSL_CTX_free(ctx);
-        exit(1);
+        return NULL;
     }
 
+    configure_session_resumption(ctx);
+
     return ctx;
 }
 
+/* Nonzero if the CPU has AES instructions (AES-GCM is then faster than ChaCha20). */
+static int cpu_has_aes(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_cpu_supports("aes");
+#elif defined(__aarch64__)
+    return (getauxval(AT_HWCAP) & HWCAP_AES) != 0;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Sets cipher, cipher suite and key exchange group preferences
+ *
+ * Only AEAD suites with forward secrecy are offered. With hardware AES the
+ * AES-GCM suites come first; without it ChaCha20-Poly1305 does. Either way
+ * SSL_OP_PRIORITIZE_CHACHA lets a client that lists ChaCha20 first (phones
+ * without AES instructions) get it. X25519 is the preferred group: it is
+ * the cheapest key exchange for both sides. Each list can be overridden in
+ * the configuration.
+ *
+ * @param ctx Context to configure
+ *
+ * @return 0 on success, -1 if a list is rejected by OpenSSL
+ */
+static int configure_cipher_preferences(SSL_CTX* ctx) {
+    static const char aes_first_12[] =
+        "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:"
+        "ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384:"
+        "ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305";
+    static const char chacha_first_12[] =
+        "ECDHE-ECDSA-CHACHA20-POLY1305:ECDHE-RSA-CHACHA20-POLY1305:"
+        "ECDHE-ECDSA-AES128-GCM-SHA256:ECDHE-RSA-AES128-GCM-SHA256:"
+        "ECDHE-ECDSA-AES256-GCM-SHA384:ECDHE-RSA-AES256-GCM-SHA384";
+    static const char aes_first_13[] =
+        "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384:TLS_CHACHA20_POLY1305_SHA256";
+    static const char chacha_first_13[] =
+        "TLS_CHACHA20_POLY1305_SHA256:TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384";
+
+    int aes = cpu_has_aes();
+    const char* ciphers = g_config.tls_ciphers && *g_config.tls_ciphers
+                          ? g_config.tls_ciphers : (aes ? aes_first_12 : chacha_first_12);
+    const char* suites  = g_config.tls_ciphersuites && *g_config.tls_ciphersuites
+                          ? g_config.tls_ciphersuites : (aes ? aes_first_13 : chacha_first_13);
+    const char* groups  = g_config.tls_groups && *g_config.tls_groups
+                          ? g_config.tls_groups : "X25519:P-256:P-384";
+
+    char reason[256];
+    if (SSL_CTX_set_cipher_list(ctx, ciphers) != 1) {
+        log_message(LOG_ERROR, "Invalid tls_ciphers %s: %s", ciphers,
+                    ssl_error_reason(reason, sizeof(reason)));
+        return -1;
+    }
+    if (SSL_CTX_set_ciphersuites(ctx, suites) != 1) {
+        log_message(LOG_ERROR, "Invalid tls_ciphersuites %s: %s", suites,
+                    ssl_error_reason(reason, sizeof(reason)));
+        return -1;
+    }
+    if (SSL_CTX_set1_groups_list(ctx, groups) != 1) {
+        log_message(LOG_ERROR, "Invalid tls_groups %s: %s", groups,
+                    ssl_error_reason(reason, sizeof(reason)));
+        return -1;
+    }
+    SSL_CTX_set_options(ctx, SSL_OP_CIPHER_SERVER_PREFERENCE | SSL_OP_PRIORITIZE_CHACHA);
+
+    log_message(LOG_INFO, "TLS preferences: %s first (hardware AES %s), groups %s",
+                aes ? "AES-GCM" : "ChaCha20", aes ? "yes" : "no", groups);
+    return 0;
+}
+
+/**
+ * Loads one certificate and its private key into the context
+ *
+ * OpenSSL keeps one certificate per key type, so calling this for an RSA
+ * and an ECDSA pair leaves both installed; the handshake then picks the
+ * one the client's signature algorithms allow, preferring ECDSA.
+ *
+ * @param ctx Context to load into
+ * @param cert_path PEM certificate (leaf first, then any intermediates)
+ * @param key_path PEM private key
+ *
+ * @return 0 on success, -1 on failure (reason logged, with the OpenSSL error)
+ */
+static int load_certificate_pair(SSL_CTX* ctx, const char* cert_path, const char* key_path) {
+    char reason[256];
+
+    if (SSL_CTX_use_certificate_chain_file(ctx, cert_path) <= 0) {
+        log_message(LOG_ERROR, "Cannot load certificate %s: %s", cert_path,
+                    ssl_error_reason(reason, sizeof(reason)));
+        return -1;
+    }
+
+    if (SSL_CTX_use_PrivateKey_file(ctx, key_path, SSL_FILETYPE_PEM) <= 0) {
+        log_message(LOG_ERROR, "Cannot load private key %s: %s", key_path,
+                    ssl_error_reason(reason, sizeof(reason)));
+        return -1;
+    }
+
+    if (!SSL_CTX_check_private_key(ctx)) {
+        log_message(LOG_ERROR, "Private key %s does not match the certificate %s: %s",
+                    key_path, cert_path, ssl_error_reason(reason, sizeof(reason)));
+        return -1;
+    }
+
+    // An expired certificate loads fine but fails every handshake
+    X509* cert = SSL_CTX_get0_certificate(ctx);
+    if (cert && X509_cmp_current_time(X509_get0_notAfter(cert)) <= 0) {
+        log_message(LOG_ERROR, "Certificate %s has expired", cert_path);
+        return -1;
+    }
+
+    log_message(LOG_INFO, "Loaded certificate %s", cert_path);
+    return 0;
+}
+
 /**
- * Configures SSL context with certificate and private key
+ * Configures SSL context with certificates, private keys and preferences
  *
- * Loads the server's SSL certificate and private key from PEM files located
- * in the SERVER_PATH/etc/ssl/ directory. Validates that the private key matches
- * the public certificate to ensure proper SSL configuration.
+ * Loads the RSA certificate and key (cert_path/key_path, by default in
+ * SERVER_PATH/etc/ssl/) and, if configured, an ECDSA pair
+ * (ecdsa_cert_path/ecdsa_key_path). With both installed, clients that
+ * support ECDSA get the much cheaper ECDSA signature and the rest fall back
+ * to RSA. Either pair may be left out by setting its paths to empty.
  *
  * @param ctx Pointer to SSL_CTX structure to configure
  *
- * @note Expects cert.pem and key.pem in {SERVER_PATH}/etc/ssl/ directory
- * @note Exits program if certificate/key loading or validation fails
+ * @return 0 on success, -1 if a certificate or key fails to load or validate
+ *
+ * @see create_ssl_context(), configure_cipher_preferences()
+ */
+int configure_ssl_context(SSL_CTX *ctx) {
+    int loaded = 0;
+
+    if (g_config.cert_path && *g_config.cert_path) {
+        if (load_certificate_pair(ctx, g_config.cert_path, g_config.key_path) < 0) return -1;
+        loaded++;
+    }
+
+    if (g_config.ecdsa_cert_path && *g_config.ecdsa_cert_path) {
+        if (load_certificate_pair(ctx, g_config.ecdsa_cert_path, g_config.ecdsa_key_path) < 0) return -1;
+        loaded++;
+    }
+
+    if (!loaded) {
+        log_message(LOG_ERROR, "No TLS certificate configured");
+        return -1;
+    }
+
+    return configure_cipher_preferences(ctx);
+}
+
+/**
+ * Switches the handshake to the context of the virtual host named by SNI
+ *
+ * Hosts without their own certificate, unknown names and clients that send
+ * no SNI stay on the default context. Content is selected separately from
+ * the Host header (see vhost_lookup()).
+ */
+static int sni_callback(SSL* ssl, int* alert, void* arg) {
+    (void)alert; (void)arg;
+
+    const char* name = SSL_get_servername(ssl, TLSEXT_NAMETYPE_host_name);
+    if (!name) return SSL_TLSEXT_ERR_OK;
+
+    const SniTable* table = SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), g_sni_index);
+    if (!table) return SSL_TLSEXT_ERR_OK;
+
+    for (int i = 0; i < table->count; i++) {
+        if (strcasecmp(table->names[i], name) == 0) {
+            SSL_set_SSL_CTX(ssl, table->ctxs[i]);
+            break;
+        }
+    }
+    return SSL_TLSEXT_ERR_OK;
+}
+
+/* Context of one virtual host: same resumption and cipher setup as the
+ * default context, with the host's own certificate. */
+static SSL_CTX* build_host_context(const VhostConfig* vh) {
+    SSL_CTX* ctx = create_ssl_context();
+    if (!ctx) return NULL;
+
+    if (load_certificate_pair(ctx, vh->cert_path, vh->key_path) < 0 ||
+        configure_cipher_preferences(ctx) < 0) {
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    return ctx;
+}
+
+/**
+ * Builds a complete server context from the current configuration
+ *
+ * Virtual hosts with their own certificate get a context each, attached to
+ * the default context and selected by sni_callback(). Any certificate that
+ * fails to load fails the whole build.
+ *
+ * @return New context (one reference owned by the caller), NULL on failure
+ *
+ * @see ssl_context_install()
+ */
+SSL_CTX* ssl_context_build(void) {
+    extern struct ServerConfig g_config;
+
+    SSL_CTX* ctx = create_ssl_context();
+    if (!ctx) return NULL;
+
+    if (configure_ssl_context(ctx) < 0) {
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+
+    SniTable* table = NULL;
+    for (int i = 0; i < g_config.vhost_count; i++) {
+        const VhostConfig* vh = &g_config.vhosts[i];
+        if (!vh->cert_path) continue;
+
+        if (!table) {
+            table = calloc(1, sizeof(*table));
+            if (!table || !SSL_CTX_set_ex_data(ctx, g_sni_index, table)) {
+                free(table);
+                SSL_CTX_free(ctx);
+                return NULL;
+            }
+        }
+
+        SSL_CTX* host_ctx = build_host_context(vh);
+        if (!host_ctx) {
+            log_message(LOG_ERROR, "Cannot set up TLS for virtual host %s", vh->name);
+            SSL_CTX_free(ctx);  // Frees the table and the host contexts so far
+            return NULL;
+        }
+        table->names[table->count] = vh->name;
+        table->ctxs[table->count++] = host_ctx;
+    }
+
+    if (table) {
+        SSL_CTX_set_tlsext_servername_callback(ctx, sni_callback);
+        log_message(LOG_INFO, "TLS: %d virtual host certificate(s) selected by SNI", table->count);
+    }
+    return ctx;
+}
+
+/**
+ * Makes ctx the context for new connections
+ *
+ * Takes over the caller's reference. The previous context is released;
+ * OpenSSL frees it once the last connection created from it is gone.
+ *
+ * @param ctx Context from ssl_context_build()
+ */
+void ssl_context_install(SSL_CTX* ctx) {
+    pthread_mutex_lock(&g_ctx_lock);
+    SSL_CTX* old = g_ssl_ctx;
+    g_ssl_ctx = ctx;
+    pthread_mutex_unlock(&g_ctx_lock);
+
+    SSL_CTX_free(old);
+}
+
+/**
+ * Creates the SSL object for a new connection from the current context
+ *
+ * @return New SSL, or NULL if no context is installed or allocation failed
+ */
+SSL* ssl_context_new_connection(void) {
+    pthread_mutex_lock(&g_ctx_lock);
+    SSL* ssl = g_ssl_ctx ? SSL_new(g_ssl_ctx) : NULL;
+    pthread_mutex_unlock(&g_ctx_lock);
+    return ssl;
+}
+
+static void* reload_thread(void* arg) {
+    (void)arg;
+    log_message(LOG_INFO, "TLS reload: building new context");
+
+    SSL_CTX* ctx = ssl_context_build();
+    if (ctx) {
+        ssl_context_install(ctx);
+        __atomic_add_fetch(&g_reloads, 1, __ATOMIC_RELAXED);
+        log_message(LOG_INFO, "TLS reload: new context installed, existing connections keep the old one");
+    } else {
+        ERR_clear_error();
+        __atomic_add_fetch(&g_reload_failures, 1, __ATOMIC_RELAXED);
+        log_message(LOG_ERROR, "TLS reload failed (see the errors above), keeping the current context");
+    }
+
+    __atomic_store_n(&g_reload_running, 0, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/**
+ * Reloads certificates and keys without a restart
+ *
+ * The new context is built and validated on a background thread, so the
+ * accept loop never waits on file I/O or key parsing. If anything fails the
+ * current context stays in place. Ticket keys live outside the context, so
+ * tickets issued before the reload still resume; the session ID cache
+ * starts empty.
+ *
+ * @return 0 if the reload was started, -1 if one is already running
  *
- * @see create_ssl_context()
+ * @note Called from the main loop on SIGUSR2
  */
-void configure_ssl_context(SSL_CTX *ctx) {
-    const char* cert_path = g_config.cert_path;
-    const char* key_path  = g_config.key_path;
+int ssl_reload_start(void) {
+    if (__atomic_exchange_n(&g_reload_running, 1, __ATOMIC_ACQ_REL)) {
+        log_message(LOG_WARN, "TLS reload already in progress");
+        return -1;
+    }
 
-    if (SSL_CTX_use_certificate_file(ctx, cert_path, SSL_FILETYPE_PEM) <= 0) 
-    {
-        ERR_print_errors_fp(stderr);
-        exit(1);
+    // The previous reload has finished; reap its thread
+    if (g_reload_started) {
+        pthread_join(g_reload_thread, NULL);
+        g_reload_started = 0;
     }
 
-    if (SSL_CTX_use_PrivateKey_file(ctx, key_path, SSL_FILETYPE_PEM) <= 0) 
-    {
-        ERR_print_errors_fp(stderr);
-        exit(1);
+    if (pthread_create(&g_reload_thread, NULL, reload_thread, NULL) != 0) {
+        __atomic_store_n(&g_reload_running, 0, __ATOMIC_RELEASE);
+        log_message(LOG_ERROR, "TLS reload: cannot start thread");
+        return -1;
     }
+    g_reload_started = 1;
+    return 0;
+}
 
-    if (!SSL_CTX_check_private_key(ctx)) 
-    {
-        fprintf(stderr, "Private key does not match the public certificate\n");
-        exit(1);
-    }  
+/**
+ * Waits for a running reload and releases the current context
+ *
+ * @note Call after the workers have stopped, before cleanup_openssl()
+ */
+void ssl_context_shutdown(void) {
+    if (g_reload_started) {
+        pthread_join(g_reload_thread, NULL);
+        g_reload_started = 0;
+    }
+    ssl_context_install(NULL);
 }
 
 /**
@@ -107,37 +663,140 @@ void cleanup_openssl() {
 }
 
 /**
- * Accepts an SSL/TLS connection on a client socket
+ * Reads application data, including TLS 1.3 early data
  *
- * Creates a new SSL structure for a client connection and performs the
- * SSL/TLS handshake. Binds the SSL structure to the provided socket file
- * descriptor and completes server-side handshake negotiation.
+ * While *in_early is set the handshake has not completed: data comes from
+ * SSL_read_early_data(). Once the client ends its early data (or sent none,
+ * or it was rejected) the handshake is completed here and reads continue
+ * with SSL_read().
  *
- * @param ctx Pointer to configured SSL_CTX structure
- * @param client_fd File descriptor of accepted client socket
+ * @param ssl Connection
+ * @param in_early Nonzero until the early-data phase ends (updated)
+ * @param buf Destination
+ * @param len Capacity of buf
  *
- * @return Pointer to SSL structure on success, NULL on failure
+ * @return Bytes read, 0 on close, negative on error (as SSL_read)
+ */
+int ssl_read_data(SSL* ssl, int* in_early, void* buf, int len) {
+    while (*in_early) {
+        size_t got = 0;
+        int status = SSL_read_early_data(ssl, buf, (size_t)len, &got);
+
+        if (status == SSL_READ_EARLY_DATA_ERROR) {
+            *in_early = 0;
+            ssl_record_handshake(ssl, 0);
+            ERR_clear_error();
+            return -1;
+        }
+        if (status == SSL_READ_EARLY_DATA_SUCCESS) {
+            if (got > 0) return (int)got;
+            continue;
+        }
+
+        // SSL_READ_EARLY_DATA_FINISH: complete the handshake
+        *in_early = 0;
+        int ok = SSL_accept(ssl) > 0;
+        ssl_record_handshake(ssl, ok);
+        if (!ok) {
+            ERR_clear_error();
+            return -1;
+        }
+        if (got > 0) return (int)got;
+    }
+
+    return SSL_read(ssl, buf, len);
+}
+
+/**
+ * Writes application data, as 0.5-RTT data if the handshake is pending
  *
- * @note Prints OpenSSL errors to stderr if handshake fails
- * @warning Caller must free returned SSL structure with SSL_free()
- * @warning On failure, the SSL structure is automatically freed
+ * A response to a request that arrived as early data goes out before the
+ * client's Finished, which is where 0-RTT saves the round trip.
  *
- * @see create_ssl_context(), configure_ssl_context()
+ * @return Bytes written, or <= 0 on error (as SSL_write)
  */
-SSL* accept_ssl_connection(SSL_CTX* ctx, int client_fd) {
-    SSL* ssl = SSL_new(ctx);
-    if (!ssl) return NULL;
-    
-    SSL_set_fd(ssl, client_fd);
-    
-    if (SSL_accept(ssl) <= 0) {
-        /* Discard client-side alerts (e.g. unknown CA, certificate unknown).
-         * These are normal when using self-signed certs and do not indicate a
-         * server-side fault; the NULL return is sufficient for the caller. */
-        ERR_clear_error();
-        SSL_free(ssl);
-        return NULL;
+int ssl_write_data(SSL* ssl, const void* buf, int len) {
+    if (SSL_is_init_finished(ssl)) {
+        return SSL_write(ssl, buf, len);
     }
-    
-    return ssl;
-}
\ No newline at end of file
+
+    size_t written = 0;
+    if (SSL_write_early_data(ssl, buf, (size_t)len, &written) != 1) return -1;
+    return (int)written;
+}
+
+/**
+ * Counts a request that arrived as early data
+ *
+ * @param served Nonzero if it was served, zero if answered 425 Too Early
+ */
+void ssl_record_early_request(int served) {
+    if (served) __atomic_add_fetch(&g_early_served, 1, __ATOMIC_RELAXED);
+    else        __atomic_add_fetch(&g_early_too_early, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Marks the start of the server-side handshake, for its duration metric
+ *
+ * @param ssl Connection about to run SSL_accept() (or read early data)
+ */
+void ssl_handshake_begin(SSL* ssl) {
+    SSL_set_ex_data(ssl, g_handshake_start_index, (void*)(uintptr_t)monotonic_us());
+}
+
+/**
+ * Records the outcome of a server-side handshake
+ *
+ * Counted in the calling thread's metrics shard, so concurrent handshakes
+ * do not contend on a shared counter.
+ *
+ * @param ssl Connection after SSL_accept()
+ * @param ok Nonzero if SSL_accept() succeeded
+ */
+void ssl_record_handshake(SSL* ssl, int ok) {
+    uintptr_t start = (uintptr_t)SSL_get_ex_data(ssl, g_handshake_start_index);
+    uint64_t duration = start ? monotonic_us() - (uint64_t)start : 0;
+
+    if (!ok) {
+        metrics_record_handshake(METRICS_HANDSHAKE_FAILED, duration);
+    } else if (SSL_session_reused(ssl)) {
+        metrics_record_handshake(METRICS_HANDSHAKE_RESUMED, duration);
+    } else {
+        metrics_record_handshake(METRICS_HANDSHAKE_FULL, duration);
+    }
+}
+
+/**
+ * Collects handshake, session cache and ticket counters
+ *
+ * @param stats Destination
+ */
+void ssl_get_stats(struct TlsStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+
+    unsigned long handshakes[METRICS_HANDSHAKE_KINDS];
+    metrics_handshake_totals(handshakes);
+    stats->full_handshakes    = handshakes[METRICS_HANDSHAKE_FULL];
+    stats->resumed_handshakes = handshakes[METRICS_HANDSHAKE_RESUMED];
+    stats->failed_handshakes  = handshakes[METRICS_HANDSHAKE_FAILED];
+    stats->tickets_issued     = __atomic_load_n(&g_tickets_issued, __ATOMIC_RELAXED);
+    stats->tickets_accepted   = __atomic_load_n(&g_tickets_accepted, __ATOMIC_RELAXED);
+    stats->tickets_renewed    = __atomic_load_n(&g_tickets_renewed, __ATOMIC_RELAXED);
+    stats->tickets_rejected   = __atomic_load_n(&g_tickets_rejected, __ATOMIC_RELAXED);
+    stats->key_rotations      = __atomic_load_n(&g_key_rotations, __ATOMIC_RELAXED);
+    stats->early_served       = __atomic_load_n(&g_early_served, __ATOMIC_RELAXED);
+    stats->early_too_early    = __atomic_load_n(&g_early_too_early, __ATOMIC_RELAXED);
+    stats->reloads            = __atomic_load_n(&g_reloads, __ATOMIC_RELAXED);
+    stats->reload_failures    = __atomic_load_n(&g_reload_failures, __ATOMIC_RELAXED);
+
+    // Cache counters are per context and restart from zero after a reload
+    pthread_mutex_lock(&g_ctx_lock);
+    if (g_ssl_ctx) {
+        stats->cache_entries  = SSL_CTX_sess_number(g_ssl_ctx);
+        stats->cache_hits     = SSL_CTX_sess_hits(g_ssl_ctx);
+        stats->cache_misses   = SSL_CTX_sess_misses(g_ssl_ctx);
+        stats->cache_timeouts = SSL_CTX_sess_timeouts(g_ssl_ctx);
+        stats->cache_full     = SSL_CTX_sess_cache_full(g_ssl_ctx);
+    }
+    pthread_mutex_unlock(&g_ctx_lock);
+}
@@ -1,4 +1,5 @@
 #include "thread_pool.h"
+#include "utils.h"
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
@@ -6,7 +7,9 @@
 // Work queue node
 struct WorkItem {
     work_func_t func;
+    work_func_t shed;       // Runs instead of func when CoDel drops the item
     void* arg;
+    uint64_t enqueued_us;   // Monotonic time the item entered the queue
     struct WorkItem* next;
 };
 
@@ -33,8 +36,104 @@ struct ThreadPool {
     // Statistics
     int completed_work;
     int rejected_work;
+    int shed_work;
+    uint64_t avg_wait_us;
+
+    // CoDel state (RFC 8289), protected by queue_mutex
+    uint32_t codel_target_us;
+    uint32_t codel_interval_us;
+    uint64_t codel_first_above_us;
+    uint64_t codel_drop_next_us;
+    uint32_t codel_count;
+    uint32_t codel_last_count;
+    bool codel_dropping;
+
+    // What each worker is running, protected by queue_mutex
+    struct ThreadPoolWorker* workers;
+    int workers_started;
 };
 
+static uint32_t isqrt(uint32_t n) {
+    uint32_t root = 0;
+    uint32_t bit = 1u << 30;
+    while (bit > n) bit >>= 2;
+    while (bit) {
+        if (n >= root + bit) {
+            n -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+/**
+ * CoDel control law: next drop time shrinks as interval / sqrt(count)
+ */
+static uint64_t codel_control_law(struct ThreadPool* pool, uint64_t t) {
+    uint32_t root = isqrt(pool->codel_count);
+    return t + pool->codel_interval_us / (root ? root : 1);
+}
+
+/**
+ * Decides whether a dequeued item should be shed
+ *
+ * Implements the CoDel dequeue logic from RFC 8289 using queue sojourn time.
+ * A standing queue (every item waiting longer than target for at least one
+ * interval) puts the pool into the dropping state, where items are shed at
+ * an increasing rate until the queue delay falls below target again. Bursts
+ * shorter than one interval are absorbed without drops.
+ *
+ * @param pool Thread pool (queue_mutex must be held)
+ * @param now Current monotonic time in microseconds
+ * @param sojourn How long the item sat in the queue
+ *
+ * @return true if the item should be shed instead of executed
+ */
+static bool codel_should_drop(struct ThreadPool* pool, uint64_t now, uint64_t sojourn) {
+    if (pool->codel_target_us == 0) return false;
+
+    bool ok_to_drop = false;
+    if (sojourn < pool->codel_target_us || pool->queue_size == 0) {
+        pool->codel_first_above_us = 0;
+    } else if (pool->codel_first_above_us == 0) {
+        pool->codel_first_above_us = now + pool->codel_interval_us;
+    } else if (now >= pool->codel_first_above_us) {
+        ok_to_drop = true;
+    }
+
+    if (pool->codel_dropping) {
+        if (!ok_to_drop) {
+            pool->codel_dropping = false;
+            return false;
+        }
+        if (now >= pool->codel_drop_next_us) {
+            pool->codel_count++;
+            pool->codel_drop_next_us = codel_control_law(pool, pool->codel_drop_next_us);
+            return true;
+        }
+        return false;
+    }
+
+    if (ok_to_drop) {
+        pool->codel_dropping = true;
+        // Resume near the previous drop rate if we left dropping state recently
+        uint32_t delta = pool->codel_count - pool->codel_last_count;
+        if (delta > 1 && now - pool->codel_drop_next_us < 16ULL * pool->codel_interval_us) {
+            pool->codel_count = delta;
+        } else {
+            pool->codel_count = 1;
+        }
+        pool->codel_drop_next_us = codel_control_law(pool, now);
+        pool->codel_last_count = pool->codel_count;
+        return true;
+    }
+
+    return false;
+}
+
 /**
  * Worker thread main loop - processes work items from queue
  *
@@ -55,6 +154,12 @@ struct ThreadPool {
  */
 static void* worker_thread(void* arg) {
     struct ThreadPool* pool = (struct ThreadPool*)arg;
+
+    pthread_mutex_lock(&pool->queue_mutex);
+    struct ThreadPoolWorker* self = &pool->workers[pool->workers_started++];
+    self->tid = current_tid();
+    self->since_us = monotonic_us();
+    pthread_mutex_unlock(&pool->queue_mutex);
     
     while (1) {
         pthread_mutex_lock(&pool->queue_mutex);
@@ -72,6 +177,7 @@ static void* worker_thread(void* arg) {
         
         // Get work item from queue
         struct WorkItem* item = pool->work_queue_head;
+        bool shed = false;
         if (item) {
             pool->work_queue_head = item->next;
             if (pool->work_queue_tail == item) {
@@ -79,17 +185,38 @@ static void* worker_thread(void* arg) {
             }
             pool->queue_size--;
             pool->active_workers++;
+
+            uint64_t now = monotonic_us();
+            uint64_t sojourn = now - item->enqueued_us;
+            // EWMA with 1/8 weight, same smoothing TCP uses for SRTT
+            pool->avg_wait_us = pool->avg_wait_us - (pool->avg_wait_us >> 3) + (sojourn >> 3);
+
+            if (item->shed && codel_should_drop(pool, now, sojourn)) {
+                shed = true;
+                pool->shed_work++;
+            }
+
+            self->busy = true;
+            self->arg = item->arg;
+            self->since_us = now;
         }
         
         pthread_mutex_unlock(&pool->queue_mutex);
         
         // Execute work (outside of lock to allow other threads to run)
         if (item) {
-            item->func(item->arg);
+            if (shed) {
+                item->shed(item->arg);
+            } else {
+                item->func(item->arg);
+            }
             free(item);
             
             // Update statistics
             pthread_mutex_lock(&pool->queue_mutex);
+            self->busy = false;
+            self->arg = NULL;
+            self->since_us = monotonic_us();
             pool->active_workers--;
             pool->completed_work++;
             pthread_cond_signal(&pool->work_done);
@@ -139,6 +266,8 @@ struct ThreadPool* threadpool_create(struct ThreadPoolConfig config) {
     pool->active_workers = 0;
     pool->completed_work = 0;
     pool->rejected_work = 0;
+    pool->codel_target_us = config.codel_target_us;
+    pool->codel_interval_us = config.codel_interval_us;
     
     // Initialize synchronization primitives
     if (pthread_mutex_init(&pool->queue_mutex, NULL) != 0) {
@@ -164,8 +293,11 @@ struct ThreadPool* threadpool_create(struct ThreadPoolConfig config) {
     
     // Create worker threads
     pool->threads = calloc(pool->num_threads, sizeof(pthread_t));
-    if (!pool->threads) {
+    pool->workers = calloc(pool->num_threads, sizeof(struct ThreadPoolWorker));
+    if (!pool->threads || !pool->workers) {
         perror("Failed to allocate thread array");
+        free(pool->threads);
+        free(pool->workers);
         pthread_cond_destroy(&pool->work_done);
         pthread_cond_destroy(&pool->work_available);
         pthread_mutex_destroy(&pool->queue_mutex);
@@ -185,6 +317,7 @@ struct ThreadPool* threadpool_create(struct ThreadPoolConfig config) {
             }
             
             free(pool->threads);
+            free(pool->workers);
             pthread_cond_destroy(&pool->work_done);
             pthread_cond_destroy(&pool->work_available);
             pthread_mutex_destroy(&pool->queue_mutex);
@@ -218,6 +351,27 @@ struct ThreadPool* threadpool_create(struct ThreadPoolConfig config) {
  * @see threadpool_create(), threadpool_wait()
  */
 int threadpool_add_work(struct ThreadPool* pool, work_func_t func, void* arg) {
+    return threadpool_add_work_sheddable(pool, func, NULL, arg);
+}
+
+/**
+ * Adds a work item that CoDel is allowed to shed
+ *
+ * Same as threadpool_add_work(), but when the pool's CoDel controller
+ * decides to drop the item at dequeue time, shed(arg) is called in place of
+ * func(arg). The shed callback owns arg and must release it.
+ *
+ * @param pool Pointer to ThreadPool structure
+ * @param func Function pointer to execute normally
+ * @param shed Function to run instead when the item is dropped (NULL = never drop)
+ * @param arg Argument passed to whichever function runs
+ *
+ * @return 0 on success, -1 on failure (same conditions as threadpool_add_work)
+ *
+ * @see threadpool_add_work()
+ */
+int threadpool_add_work_sheddable(struct ThreadPool* pool, work_func_t func,
+                                  work_func_t shed, void* arg) {
     if (!pool || !func) {
         return -1;
     }
@@ -229,7 +383,9 @@ int threadpool_add_work(struct ThreadPool* pool, work_func_t func, void* arg) {
     }
     
     item->func = func;
+    item->shed = shed;
     item->arg = arg;
+    item->enqueued_us = monotonic_us();
     item->next = NULL;
     
     pthread_mutex_lock(&pool->queue_mutex);
@@ -243,10 +399,9 @@ int threadpool_add_work(struct ThreadPool* pool, work_func_t func, void* arg) {
     
     // Check queue size limit
     if (pool->max_queue_size > 0 && pool->queue_size >= pool->max_queue_size) {
-        pthread_mutex_unlock(&pool->queue_mutex);
         pool->rejected_work++;
+        pthread_mutex_unlock(&pool->queue_mutex);
         free(item);
-        fprintf(stderr, "Work queue full, rejecting work\n");
         return -1;
     }
     
@@ -337,12 +492,13 @@ void threadpool_destroy(struct ThreadPool* pool) {
     
     // Cleanup
     free(pool->threads);
+    free(pool->workers);
     pthread_cond_destroy(&pool->work_done);
     pthread_cond_destroy(&pool->work_available);
     pthread_mutex_destroy(&pool->queue_mutex);
     
-    printf("Thread pool destroyed. Completed: %d, Rejected: %d\n",
-           pool->completed_work, pool->rejected_work);
+    printf("Thread pool destroyed. Completed: %d, Rejected: %d, Shed: %d\n",
+           pool->completed_work, pool->rejected_work, pool->shed_work);
     
     free(pool);
 }
@@ -363,6 +519,9 @@ void threadpool_destroy(struct ThreadPool* pool) {
  *       - queued_work: Items waiting in queue
  *       - completed_work: Total tasks completed since creation
  *       - rejected_work: Tasks rejected due to full queue
+ *       - shed_work: Tasks dropped by CoDel at dequeue
+ *       - avg_wait_us: Smoothed queue wait time
+ *       - dropping: Whether CoDel is currently shedding
  * @note Thread-safe - uses mutex to ensure consistent snapshot
  *
  * @see threadpool_create(), threadpool_add_work()
@@ -375,5 +534,31 @@ void threadpool_get_stats(struct ThreadPool* pool, struct ThreadPoolStats* stats
     stats->queued_work = pool->queue_size;
     stats->completed_work = pool->completed_work;
     stats->rejected_work = pool->rejected_work;
+    stats->shed_work = pool->shed_work;
+    stats->avg_wait_us = pool->avg_wait_us;
+    stats->dropping = pool->codel_dropping;
+    pthread_mutex_unlock(&pool->queue_mutex);
+}
+
+/**
+ * Copies what each worker is doing right now
+ *
+ * @param pool Pointer to ThreadPool structure
+ * @param out Array receiving one entry per started worker
+ * @param max Capacity of out
+ *
+ * @return Number of entries written
+ *
+ * @note arg is only an identity: the work item may finish (and its arg be
+ *       reused or freed) as soon as the lock is released
+ */
+int threadpool_worker_snapshot(struct ThreadPool* pool, struct ThreadPoolWorker* out, int max) {
+    if (!pool || !out) return 0;
+
+    pthread_mutex_lock(&pool->queue_mutex);
+    int n = pool->workers_started < max ? pool->workers_started : max;
+    memcpy(out, pool->workers, (size_t)n * sizeof(*out));
     pthread_mutex_unlock(&pool->queue_mutex);
-}
\ No newline at end of file
+
+    return n;
+}
@@ -0,0 +1,279 @@
+#include "timer_wheel.h"
+#include "logger.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sys/socket.h>
+
+/*
+ * Three-level hierarchical timing wheel (Varghese & Lauck).
+ *
+ * Level 0 has one slot per tick; each slot of level N covers a full
+ * revolution of level N-1. With a 100 ms tick that is 25.6 s, 27 min and
+ * 29 h per level. Arming and cancelling are O(1) list operations; entries in
+ * the upper levels are cascaded down once per revolution of the level below.
+ */
+#define L0_BITS   8
+#define LN_BITS   6
+#define L0_SIZE   (1 << L0_BITS)
+#define LN_SIZE   (1 << LN_BITS)
+#define L0_MASK   (L0_SIZE - 1)
+#define LN_MASK   (LN_SIZE - 1)
+#define MAX_DELTA ((uint64_t)1 << (L0_BITS + 2 * LN_BITS))
+
+static TimerEntry* g_level0[L0_SIZE];
+static TimerEntry* g_level1[LN_SIZE];
+static TimerEntry* g_level2[LN_SIZE];
+
+static pthread_mutex_t g_wheel_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t       g_wheel_thread;
+static bool            g_wheel_running = false;
+static unsigned        g_tick_ms = 100;
+static uint64_t        g_current_tick = 0;
+static struct timespec g_start;
+
+static void wheel_link(TimerEntry** slot, TimerEntry* timer) {
+    timer->next = *slot;
+    if (*slot) (*slot)->pprev = &timer->next;
+    *slot = timer;
+    timer->pprev = slot;
+}
+
+static void wheel_unlink(TimerEntry* timer) {
+    if (!timer->pprev) return;
+    *timer->pprev = timer->next;
+    if (timer->next) timer->next->pprev = timer->pprev;
+    timer->next = NULL;
+    timer->pprev = NULL;
+}
+
+/**
+ * Places an armed entry in the slot matching its distance from now
+ *
+ * @param timer Entry with expires already set (wheel mutex held)
+ */
+static void wheel_insert(TimerEntry* timer) {
+    uint64_t delta = timer->expires > g_current_tick ? timer->expires - g_current_tick : 0;
+
+    if (delta >= MAX_DELTA) {
+        timer->expires = g_current_tick + MAX_DELTA - 1;
+        delta = MAX_DELTA - 1;
+    }
+
+    if (delta < L0_SIZE) {
+        // Already due: fire on the next tick rather than in a past slot
+        uint64_t when = delta == 0 ? g_current_tick + 1 : timer->expires;
+        wheel_link(&g_level0[when & L0_MASK], timer);
+    } else if (delta < ((uint64_t)1 << (L0_BITS + LN_BITS))) {
+        wheel_link(&g_level1[(timer->expires >> L0_BITS) & LN_MASK], timer);
+    } else {
+        wheel_link(&g_level2[(timer->expires >> (L0_BITS + LN_BITS)) & LN_MASK], timer);
+    }
+}
+
+/**
+ * Re-inserts every entry of an upper-level slot into a lower level
+ */
+static void wheel_cascade(TimerEntry** slot) {
+    TimerEntry* timer = *slot;
+    *slot = NULL;
+
+    while (timer) {
+        TimerEntry* next = timer->next;
+        timer->next = NULL;
+        timer->pprev = NULL;
+        wheel_insert(timer);
+        timer = next;
+    }
+}
+
+/**
+ * Expires the entries of one level-0 slot
+ *
+ * Read deadlines shut down only the read side so the blocked recv() returns
+ * 0 and the worker closes normally; a write stall needs SHUT_RDWR to break
+ * a send() blocked on a full socket buffer.
+ */
+static void wheel_expire(TimerEntry** slot) {
+    TimerEntry* timer = *slot;
+    *slot = NULL;
+
+    while (timer) {
+        TimerEntry* next = timer->next;
+        timer->next = NULL;
+        timer->pprev = NULL;
+
+        timer->fired = timer->kind;
+        shutdown(timer->fd, timer->kind == TIMER_WRITE ? SHUT_RDWR : SHUT_RD);
+
+        timer = next;
+    }
+}
+
+static uint64_t wheel_now_tick(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    uint64_t elapsed_ms = (uint64_t)(now.tv_sec - g_start.tv_sec) * 1000 +
+                          (now.tv_nsec - g_start.tv_nsec) / 1000000;
+    return elapsed_ms / g_tick_ms;
+}
+
+/**
+ * Tick thread: advances the wheel to the current time
+ *
+ * Sleeps until the next tick boundary, then processes every tick that has
+ * elapsed (more than one if the thread was delayed), cascading the upper
+ * levels whenever the level below wraps.
+ *
+ * @param arg Unused
+ *
+ * @return NULL when timer_wheel_shutdown() is called
+ */
+static void* wheel_thread(void* arg) {
+    (void)arg;
+
+    while (1) {
+        struct timespec next = g_start;
+        uint64_t target_ms = (g_current_tick + 1) * g_tick_ms;
+        next.tv_sec  += target_ms / 1000;
+        next.tv_nsec += (target_ms % 1000) * 1000000;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL) == EINTR) { }
+
+        uint64_t now = wheel_now_tick();
+
+        pthread_mutex_lock(&g_wheel_mutex);
+        if (!g_wheel_running) {
+            pthread_mutex_unlock(&g_wheel_mutex);
+            break;
+        }
+        while (g_current_tick < now) {
+            g_current_tick++;
+
+            if ((g_current_tick & L0_MASK) == 0) {
+                uint64_t l1 = g_current_tick >> L0_BITS;
+                if ((l1 & LN_MASK) == 0) {
+                    wheel_cascade(&g_level2[(l1 >> LN_BITS) & LN_MASK]);
+                }
+                wheel_cascade(&g_level1[l1 & LN_MASK]);
+            }
+            wheel_expire(&g_level0[g_current_tick & L0_MASK]);
+        }
+        pthread_mutex_unlock(&g_wheel_mutex);
+    }
+
+    return NULL;
+}
+
+/**
+ * Starts the timer wheel
+ *
+ * @param tick_ms Resolution of the wheel in milliseconds
+ *
+ * @return 0 on success, -1 if the tick thread cannot be started
+ *
+ * @see timer_arm(), timer_wheel_shutdown()
+ */
+int timer_wheel_init(unsigned tick_ms) {
+    g_tick_ms = tick_ms ? tick_ms : 100;
+    g_current_tick = 0;
+    clock_gettime(CLOCK_MONOTONIC, &g_start);
+
+    memset(g_level0, 0, sizeof(g_level0));
+    memset(g_level1, 0, sizeof(g_level1));
+    memset(g_level2, 0, sizeof(g_level2));
+
+    g_wheel_running = true;
+    if (pthread_create(&g_wheel_thread, NULL, wheel_thread, NULL) != 0) {
+        g_wheel_running = false;
+        log_message(LOG_ERROR, "Failed to start timer wheel thread");
+        return -1;
+    }
+
+    log_message(LOG_INFO, "Timer wheel started (%u ms tick)", g_tick_ms);
+    return 0;
+}
+
+/**
+ * Stops the tick thread. Armed entries are left unfired.
+ */
+void timer_wheel_shutdown(void) {
+    pthread_mutex_lock(&g_wheel_mutex);
+    bool was_running = g_wheel_running;
+    g_wheel_running = false;
+    pthread_mutex_unlock(&g_wheel_mutex);
+
+    if (was_running) {
+        pthread_join(g_wheel_thread, NULL);
+    }
+}
+
+/**
+ * Prepares an entry for use with a connection socket
+ *
+ * @param timer Entry to initialize
+ * @param fd Socket to shut down when a deadline expires
+ */
+void timer_init(TimerEntry* timer, int fd) {
+    memset(timer, 0, sizeof(*timer));
+    timer->fd = fd;
+}
+
+/**
+ * Arms (or re-arms) a connection deadline
+ *
+ * @param timer Connection's entry
+ * @param kind Which deadline this is, reported back by timer_cancel()
+ * @param timeout_ms Time from now until expiry (rounded up to a tick)
+ */
+void timer_arm(TimerEntry* timer, TimerKind kind, unsigned timeout_ms) {
+    pthread_mutex_lock(&g_wheel_mutex);
+
+    wheel_unlink(timer);
+    timer->kind = kind;
+    timer->fired = TIMER_NONE;
+    timer->expires = g_current_tick + (timeout_ms + g_tick_ms - 1) / g_tick_ms;
+    wheel_insert(timer);
+
+    pthread_mutex_unlock(&g_wheel_mutex);
+}
+
+/**
+ * Disarms a connection deadline
+ *
+ * Because expiry runs under the wheel mutex, once this returns the wheel
+ * will not touch the entry or its fd again, so the caller may close the
+ * socket safely.
+ *
+ * @param timer Connection's entry
+ *
+ * @return Kind of the deadline that expired, or TIMER_NONE
+ */
+TimerKind timer_cancel(TimerEntry* timer) {
+    pthread_mutex_lock(&g_wheel_mutex);
+
+    wheel_unlink(timer);
+    TimerKind fired = timer->fired;
+    timer->fired = TIMER_NONE;
+    timer->kind = TIMER_NONE;
+
+    pthread_mutex_unlock(&g_wheel_mutex);
+    return fired;
+}
+
+const char* timer_kind_name(TimerKind kind) {
+    switch (kind) {
+        case TIMER_IDLE:   return "keep-alive idle";
+        case TIMER_HEADER: return "header read";
+        case TIMER_BODY:   return "body read";
+        case TIMER_WRITE:  return "write stall";
+        default:           return "none";
+    }
+}
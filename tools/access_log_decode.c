@@ -0,0 +1,213 @@
+/*
+ * Binary access log decoder
+ *
+ * Prints the records of one or more access.bin files (see access_log.h)
+ * as JSON lines or CSV:
+ *
+ *   make tools
+ *   ./bin/access_log_decode var/log/access.bin
+ *   ./bin/access_log_decode -f csv var/log/access.bin.* > access.csv
+ *
+ * Each file carries its own path definitions, so rotated files decode
+ * independently.
+ */
+#define ACCESS_LOG_NO_WRITER
+#include "access_log.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    uint64_t    id;
+    const char* path;       // Points into the mapping (not NUL-terminated)
+    uint16_t    length;
+} PathDef;
+
+static PathDef* g_defs = NULL;
+static size_t   g_def_count = 0;
+static size_t   g_def_cap = 0;
+
+static const char* const method_names[] = {
+    "OTHER", "GET", "HEAD", "POST", "PUT", "DELETE", "OPTIONS"
+};
+
+static void add_def(uint64_t id, const char* path, uint16_t length) {
+    if (g_def_count == g_def_cap) {
+        g_def_cap = g_def_cap ? g_def_cap * 2 : 256;
+        g_defs = realloc(g_defs, g_def_cap * sizeof(PathDef));
+        if (!g_defs) {
+            perror("realloc");
+            exit(1);
+        }
+    }
+    g_defs[g_def_count++] = (PathDef){ id, path, length };
+}
+
+static const PathDef* find_def(uint64_t id) {
+    for (size_t i = g_def_count; i > 0; i--) {
+        if (g_defs[i - 1].id == id) return &g_defs[i - 1];
+    }
+    return NULL;
+}
+
+/* Slots a path definition of this length occupies. */
+static uint64_t def_slots(uint16_t length) {
+    if (length <= ACCESS_PATH_INLINE) return 1;
+    return 1 + (length - ACCESS_PATH_INLINE + ACCESS_LOG_SLOT - 1) / ACCESS_LOG_SLOT;
+}
+
+/* Writes s with JSON (or CSV) quoting. */
+static void print_quoted(const char* s, size_t len, int csv) {
+    putchar('"');
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        if (csv) {
+            if (c == '"') putchar('"');
+            putchar(c);
+        } else if (c == '"' || c == '\\') {
+            printf("\\%c", c);
+        } else if (c < 0x20) {
+            printf("\\u%04x", c);
+        } else {
+            putchar(c);
+        }
+    }
+    putchar('"');
+}
+
+static int decode_file(const char* file, int csv) {
+    int fd = open(file, O_RDONLY);
+    if (fd < 0) {
+        perror(file);
+        return -1;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < ACCESS_LOG_SLOT) {
+        fprintf(stderr, "%s: too short\n", file);
+        close(fd);
+        return -1;
+    }
+
+    const unsigned char* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (base == MAP_FAILED) {
+        perror("mmap");
+        return -1;
+    }
+
+    const AccessLogHeader* header = (const AccessLogHeader*)base;
+    if (memcmp(header->magic, ACCESS_LOG_MAGIC, 8) != 0 ||
+        header->slot_size != ACCESS_LOG_SLOT || header->version != ACCESS_LOG_VERSION) {
+        fprintf(stderr, "%s: not an access log (or unsupported version)\n", file);
+        munmap((void*)base, (size_t)st.st_size);
+        return -1;
+    }
+
+    uint64_t slots = (uint64_t)st.st_size / ACCESS_LOG_SLOT;
+
+    // Pass 1: path definitions (a record may precede its definition)
+    g_def_count = 0;
+    for (uint64_t i = 1; i < slots; i++) {
+        const unsigned char* slot = base + i * ACCESS_LOG_SLOT;
+        if (slot[0] != ACCESS_REC_PATH) continue;
+
+        const AccessPathRecord* def = (const AccessPathRecord*)slot;
+        if (i + def_slots(def->length) > slots) break;
+        add_def(def->path_id, (const char*)slot + offsetof(AccessPathRecord, path), def->length);
+        i += def_slots(def->length) - 1;
+    }
+
+    // Pass 2: requests
+    for (uint64_t i = 1; i < slots; i++) {
+        const unsigned char* slot = base + i * ACCESS_LOG_SLOT;
+        if (slot[0] == ACCESS_REC_PATH) {
+            i += def_slots(((const AccessPathRecord*)slot)->length) - 1;
+            continue;
+        }
+        if (slot[0] != ACCESS_REC_REQUEST) continue;
+
+        const AccessRecord* rec = (const AccessRecord*)slot;
+
+        char ip[INET6_ADDRSTRLEN];
+        inet_ntop((rec->flags & ACCESS_FLAG_IPV6) ? AF_INET6 : AF_INET, rec->client_ip, ip, sizeof(ip));
+
+        time_t secs = (time_t)(rec->timestamp_us / 1000000);
+        struct tm tm;
+        char when[32];
+        strftime(when, sizeof(when), "%Y-%m-%dT%H:%M:%S", gmtime_r(&secs, &tm));
+
+        const PathDef* def = find_def(rec->path_id);
+        char unknown[24];
+        const char* path = def ? def->path : unknown;
+        size_t path_len = def ? def->length
+                              : (size_t)snprintf(unknown, sizeof(unknown), "#%016" PRIx64, rec->path_id);
+        const char* method = rec->method < sizeof(method_names) / sizeof(method_names[0])
+                             ? method_names[rec->method] : "OTHER";
+
+        if (csv) {
+            printf("%s.%06" PRIu64 "Z,%s,%u,%s,", when, rec->timestamp_us % 1000000, ip,
+                   rec->client_port, method);
+            print_quoted(path, path_len, 1);
+            printf(",%u,%" PRIu64 ",%u,%d,%d,%d\n", rec->status, rec->bytes, rec->latency_us,
+                   !!(rec->flags & ACCESS_FLAG_TLS), !!(rec->flags & ACCESS_FLAG_EARLY_DATA),
+                   !!(rec->flags & ACCESS_FLAG_KEEP_ALIVE));
+        } else {
+            printf("{\"time\":\"%s.%06" PRIu64 "Z\",\"client\":\"%s\",\"port\":%u,\"method\":\"%s\",\"path\":",
+                   when, rec->timestamp_us % 1000000, ip, rec->client_port, method);
+            print_quoted(path, path_len, 0);
+            printf(",\"status\":%u,\"bytes\":%" PRIu64 ",\"latency_us\":%u,\"tls\":%s,\"early_data\":%s,\"keep_alive\":%s}\n",
+                   rec->status, rec->bytes, rec->latency_us,
+                   (rec->flags & ACCESS_FLAG_TLS) ? "true" : "false",
+                   (rec->flags & ACCESS_FLAG_EARLY_DATA) ? "true" : "false",
+                   (rec->flags & ACCESS_FLAG_KEEP_ALIVE) ? "true" : "false");
+        }
+    }
+
+    munmap((void*)base, (size_t)st.st_size);
+    return 0;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr, "Usage: %s [-f json|csv] <access.bin>...\n", prog);
+}
+
+int main(int argc, char** argv) {
+    int csv = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "f:")) != -1) {
+        switch (opt) {
+            case 'f':
+                if (strcmp(optarg, "csv") == 0) csv = 1;
+                else if (strcmp(optarg, "json") == 0) csv = 0;
+                else { usage(argv[0]); return 1; }
+                break;
+            default:
+                usage(argv[0]);
+                return 1;
+        }
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (csv) printf("time,client,port,method,path,status,bytes,latency_us,tls,early_data,keep_alive\n");
+
+    int failed = 0;
+    for (int i = optind; i < argc; i++) {
+        if (decode_file(argv[i], csv) < 0) failed = 1;
+    }
+
+    free(g_defs);
+    return failed;
+}